@@ -0,0 +1,107 @@
+#include "alias_table.hpp"
+#include "dice_exception.hpp"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+AliasTable::AliasTable(const Distribution &distribution)
+    : offset{distribution.offset},
+      entries(distribution.probabilities.size())
+{
+  std::size_t size = entries.size();
+
+  double total = 0;
+  for (double probability : distribution.probabilities)
+  {
+    total += probability;
+  }
+
+  // Each column holds 1 / size of the mass: its own outcome's share scaled
+  // up by `size`, topped up from an outcome with more than its share.
+  std::vector<double> scaled(size);
+  std::vector<std::uint32_t> small;
+  std::vector<std::uint32_t> large;
+  for (std::size_t i = 0; i < size; i++)
+  {
+    scaled[i] = distribution.probabilities[i] / total *
+                static_cast<double>(size);
+    (scaled[i] < 1 ? small : large).push_back(static_cast<std::uint32_t>(i));
+  }
+
+  while (!small.empty() && !large.empty())
+  {
+    std::uint32_t under = small.back();
+    small.pop_back();
+    std::uint32_t over = large.back();
+
+    entries[under] = {
+        .threshold = static_cast<std::uint32_t>(
+            std::ldexp(std::max(0.0, scaled[under]), 32)
+        ),
+        .alias = over,
+    };
+
+    scaled[over] -= 1 - scaled[under];
+    if (scaled[over] < 1)
+    {
+      large.pop_back();
+      small.push_back(over);
+    }
+  }
+
+  // Whatever is left is full up to rounding, so it aliases itself and the
+  // threshold never matters.
+  for (auto *remaining : {&small, &large})
+  {
+    for (std::uint32_t i : *remaining)
+    {
+      entries[i] = {.threshold = UINT32_MAX, .alias = i};
+    }
+  }
+}
+
+void AliasTable::sampleMany(std::mt19937 &rng, std::span<long> results) const
+{
+  for (long &result : results)
+  {
+    std::uint64_t high = rng();
+    result = sample(high << 32 | rng());
+  }
+}
+
+std::optional<AliasTable>
+build_alias_table(const Tree &tree, std::size_t memoryBudget)
+{
+  std::size_t maxSupport = memoryBudget / sizeof(AliasEntry);
+  if (maxSupport == 0)
+  {
+    return std::nullopt;
+  }
+
+  try
+  {
+    // The bounds rule most expressions out before their distribution is
+    // computed. Unbounded ones (exploding dice) are truncated by the
+    // distribution, so only its actual size can tell.
+    auto analysis = tree.analyze();
+    unsigned long range = static_cast<unsigned long>(analysis.max) -
+                          static_cast<unsigned long>(analysis.min);
+    if (analysis.max != LONG_MAX && range >= maxSupport)
+    {
+      return std::nullopt;
+    }
+
+    auto distribution = tree.distribution();
+    if (distribution.probabilities.size() > maxSupport ||
+        distribution.probabilities.size() > UINT32_MAX)
+    {
+      return std::nullopt;
+    }
+
+    return AliasTable(distribution);
+  }
+  catch (const DiceException &)
+  {
+    return std::nullopt;
+  }
+}
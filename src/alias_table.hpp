@@ -0,0 +1,53 @@
+#pragma once
+
+#include "distribution.hpp"
+#include "parser.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <span>
+#include <vector>
+
+// Alias tables built for sampling take at most this many bytes by default.
+constexpr std::size_t defaultAliasTableBudget = 1 << 20;
+
+// One column of an alias table: its own outcome is taken when the low half
+// of the random word is below `threshold`, and `alias` otherwise.
+struct AliasEntry
+{
+  std::uint32_t threshold;
+  std::uint32_t alias;
+};
+
+// Walker's alias method over a distribution, built with Vose's O(n)
+// algorithm. Each sample takes one 64-bit random word and one table lookup,
+// however the distribution arose.
+class AliasTable
+{
+private:
+  long offset;
+  std::vector<AliasEntry> entries;
+
+public:
+  explicit AliasTable(const Distribution &distribution);
+
+  long sample(std::uint64_t word) const
+  {
+    // The high half picks a column by multiply-shift, the low half decides
+    // between the column and its alias.
+    std::uint64_t column = ((word >> 32) * entries.size()) >> 32;
+    const AliasEntry &entry = entries[column];
+    std::uint32_t coin = static_cast<std::uint32_t>(word);
+    return offset +
+           static_cast<long>(coin < entry.threshold ? column : entry.alias);
+  }
+
+  void sampleMany(std::mt19937 &rng, std::span<long> results) const;
+};
+
+// Builds an alias table over `tree`'s exact distribution, or returns
+// std::nullopt when the table would take more than `memoryBudget` bytes or
+// the distribution is too large to compute.
+std::optional<AliasTable>
+build_alias_table(const Tree &tree, std::size_t memoryBudget);
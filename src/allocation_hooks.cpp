@@ -0,0 +1,81 @@
+// Replacements for the global operator new and delete which count every
+// allocation with record_allocation(). Only linked into the executable, and
+// only when configured with -DDICE_ALLOCATION_STATS=ON, so that neither
+// ordinary builds nor programs loading the shared library pay for them. The
+// nothrow and array forms of operator new call these in libstdc++ and libc++.
+#include "allocation_stats.hpp"
+#include <cstdlib>
+#include <new>
+
+void *allocate_counted(std::size_t size)
+{
+  record_allocation(size);
+  void *memory = std::malloc(size == 0 ? 1 : size);
+  if (memory == nullptr)
+  {
+    throw std::bad_alloc();
+  }
+  return memory;
+}
+
+void *allocate_counted_aligned(std::size_t size, std::align_val_t alignment)
+{
+  record_allocation(size);
+  auto align = static_cast<std::size_t>(alignment);
+  // aligned_alloc() needs a size which is a multiple of the alignment.
+  std::size_t padded = (size + align - 1) / align * align;
+  void *memory = std::aligned_alloc(align, padded == 0 ? align : padded);
+  if (memory == nullptr)
+  {
+    throw std::bad_alloc();
+  }
+  return memory;
+}
+
+void *operator new(std::size_t size) { return allocate_counted(size); }
+
+void *operator new[](std::size_t size) { return allocate_counted(size); }
+
+void *operator new(std::size_t size, std::align_val_t alignment)
+{
+  return allocate_counted_aligned(size, alignment);
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment)
+{
+  return allocate_counted_aligned(size, alignment);
+}
+
+void operator delete(void *memory) noexcept { std::free(memory); }
+
+void operator delete[](void *memory) noexcept { std::free(memory); }
+
+void operator delete(void *memory, std::size_t) noexcept
+{
+  std::free(memory);
+}
+
+void operator delete[](void *memory, std::size_t) noexcept
+{
+  std::free(memory);
+}
+
+void operator delete(void *memory, std::align_val_t) noexcept
+{
+  std::free(memory);
+}
+
+void operator delete[](void *memory, std::align_val_t) noexcept
+{
+  std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t, std::align_val_t) noexcept
+{
+  std::free(memory);
+}
+
+void operator delete[](void *memory, std::size_t, std::align_val_t) noexcept
+{
+  std::free(memory);
+}
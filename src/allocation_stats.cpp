@@ -0,0 +1,66 @@
+#include "allocation_stats.hpp"
+#include <array>
+#include <atomic>
+#include <format>
+
+struct AtomicAllocationCounts
+{
+  std::atomic<std::uint64_t> allocations{0};
+  std::atomic<std::uint64_t> bytes{0};
+};
+
+std::array<AtomicAllocationCounts, allocationPhaseCount> allocationCounts;
+std::atomic<AllocationPhase> currentAllocationPhase{AllocationPhase::Other};
+
+bool allocation_stats_enabled()
+{
+#ifdef DICE_ALLOCATION_STATS
+  return true;
+#else
+  return false;
+#endif
+}
+
+void record_allocation(std::size_t bytes)
+{
+  auto &counts = allocationCounts[static_cast<std::size_t>(
+      currentAllocationPhase.load(std::memory_order_relaxed)
+  )];
+  counts.allocations.fetch_add(1, std::memory_order_relaxed);
+  counts.bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+AllocationCounts allocation_counts(AllocationPhase phase)
+{
+  const auto &counts = allocationCounts[static_cast<std::size_t>(phase)];
+  return {
+      .allocations = counts.allocations.load(std::memory_order_relaxed),
+      .bytes = counts.bytes.load(std::memory_order_relaxed),
+  };
+}
+
+std::string format_allocation_stats()
+{
+  auto lex = allocation_counts(AllocationPhase::Lex);
+  auto parse = allocation_counts(AllocationPhase::Parse);
+  auto execute = allocation_counts(AllocationPhase::Execute);
+  return std::format(
+      "allocations: lex={} ({}B) parse={} ({}B) execute={} ({}B)",
+      lex.allocations,
+      lex.bytes,
+      parse.allocations,
+      parse.bytes,
+      execute.allocations,
+      execute.bytes
+  );
+}
+
+AllocationPhaseScope::AllocationPhaseScope(AllocationPhase phase)
+    : previous{currentAllocationPhase.exchange(phase)}
+{
+}
+
+AllocationPhaseScope::~AllocationPhaseScope()
+{
+  currentAllocationPhase.store(previous);
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// The phases of evaluating an expression, which allocations are attributed
+// to. Other covers everything outside of them, such as reading input.
+enum class AllocationPhase : std::uint32_t
+{
+  Other,
+  Lex,
+  Parse,
+  Execute
+};
+
+constexpr std::size_t allocationPhaseCount = 4;
+
+struct AllocationCounts
+{
+  std::uint64_t allocations;
+  std::uint64_t bytes;
+};
+
+// Whether this build replaces the global operator new, so that allocations
+// are counted at all. Configure with -DDICE_ALLOCATION_STATS=ON to turn it
+// on; it costs two atomic increments per allocation.
+bool allocation_stats_enabled();
+
+// Attributes an allocation of `bytes` to the current phase. Called by the
+// replacement operator new, so it must never allocate itself.
+void record_allocation(std::size_t bytes);
+
+// The allocations attributed to `phase` so far.
+AllocationCounts allocation_counts(AllocationPhase phase);
+
+// One line such as "allocations: lex=3 (96B) parse=7 (412B) execute=0 (0B)".
+std::string format_allocation_stats();
+
+// Attributes allocations to `phase` for its lifetime, then restores the
+// previous phase. The phase is process-wide, so that allocations made by
+// the shared thread pool during execution count towards it, and scopes must
+// not overlap across threads.
+class AllocationPhaseScope
+{
+private:
+  AllocationPhase previous;
+
+public:
+  explicit AllocationPhaseScope(AllocationPhase phase);
+  ~AllocationPhaseScope();
+
+  AllocationPhaseScope(const AllocationPhaseScope &) = delete;
+  AllocationPhaseScope &operator=(const AllocationPhaseScope &) = delete;
+};
+
+// Calls `body` with allocations attributed to `phase`, returning its result.
+template <typename Body>
+auto in_allocation_phase(AllocationPhase phase, Body body)
+{
+  AllocationPhaseScope scope(phase);
+  return body();
+}
@@ -0,0 +1,585 @@
+#include "analysis.hpp"
+#include "dice_exception.hpp"
+#include "distribution.hpp"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <vector>
+
+// Above this many binomial terms the keep pool moments switch from the exact
+// order statistic method to the large pool approximation.
+constexpr double maxExactKeepPoolTerms = 1e7;
+
+long saturating_add(long a, long b)
+{
+  long result;
+  if (__builtin_add_overflow(a, b, &result))
+  {
+    return a < 0 ? LONG_MIN : LONG_MAX;
+  }
+
+  return result;
+}
+
+long saturating_subtract(long a, long b)
+{
+  long result;
+  if (__builtin_sub_overflow(a, b, &result))
+  {
+    return a < 0 ? LONG_MIN : LONG_MAX;
+  }
+
+  return result;
+}
+
+long saturating_multiply(long a, long b)
+{
+  long result;
+  if (__builtin_mul_overflow(a, b, &result))
+  {
+    return (a < 0) == (b < 0) ? LONG_MAX : LONG_MIN;
+  }
+
+  return result;
+}
+
+long saturating_from_unsigned(unsigned long value)
+{
+  return value > LONG_MAX ? LONG_MAX : static_cast<long>(value);
+}
+
+TreeAnalysis analyze_constant(long value)
+{
+  return {
+      .mean = static_cast<double>(value),
+      .variance = 0,
+      .min = value,
+      .max = value,
+      .exact = true,
+  };
+}
+
+TreeAnalysis analyze_uniform_pool(unsigned long die, unsigned long faces)
+{
+  if (faces < 1 || die < 1)
+  {
+    return analyze_constant(0);
+  }
+
+  double n = static_cast<double>(die);
+  double f = static_cast<double>(faces);
+
+  return {
+      .mean = n * (f + 1) / 2,
+      .variance = n * (f * f - 1) / 12,
+      .min = saturating_from_unsigned(die),
+      .max = saturating_multiply(
+          saturating_from_unsigned(die), saturating_from_unsigned(faces)
+      ),
+      .exact = true,
+  };
+}
+
+struct KeepPoolMoments
+{
+  double mean;
+  double variance;
+};
+
+// Moments of T = sum_i max(0, k - B_i), where B_i ~ Binomial(n, p_i) counts
+// the dice landing in nested sets of faces with p_i = (faces - i - shift) /
+// faces. The keep-highest sum is faces * k - T (B_i counts the dice showing
+// at least face faces - i) and the keep-lowest sum is T (B_i counts the dice
+// showing less than face faces - i). Because the sets are nested, conditional
+// on B_i = a the count for any smaller set is Binomial(a, p_j / p_i), which
+// turns every pairwise product moment into a closed form over a < k.
+KeepPoolMoments keep_pool_deficit_moments(
+    unsigned long die,
+    unsigned long faces,
+    unsigned long keep,
+    unsigned long shift
+)
+{
+  double n = static_cast<double>(die);
+  double k = static_cast<double>(keep);
+  double f = static_cast<double>(faces);
+
+  std::vector<double> probabilities;
+  std::vector<double> deficitMeans;  // E[max(0, k - B_i)]
+  std::vector<double> crossMoments;  // E[B_i * max(0, k - B_i)]
+  std::vector<double> squareMoments; // E[max(0, k - B_i)^2]
+
+  for (unsigned long i = 0; i < faces; i++)
+  {
+    double p = static_cast<double>(faces - i - shift) / f;
+    double deficitMean = 0;
+    double crossMoment = 0;
+    double squareMoment = 0;
+
+    if (p <= 0)
+    {
+      deficitMean = k;
+      squareMoment = k * k;
+    }
+    else if (p < 1)
+    {
+      double logRatio = std::log(p) - std::log1p(-p);
+      double logPmf = n * std::log1p(-p);
+      for (unsigned long a = 0; a < keep; a++)
+      {
+        double pmf = std::exp(logPmf);
+        double deficit = k - static_cast<double>(a);
+        deficitMean += pmf * deficit;
+        crossMoment += pmf * static_cast<double>(a) * deficit;
+        squareMoment += pmf * deficit * deficit;
+
+        logPmf += std::log((n - a) / (a + 1)) + logRatio;
+      }
+    }
+
+    probabilities.push_back(p);
+    deficitMeans.push_back(deficitMean);
+    crossMoments.push_back(crossMoment);
+    squareMoments.push_back(squareMoment);
+  }
+
+  double mean = 0;
+  double secondMoment = 0;
+  double smallerProbabilitySum = 0;
+  // Walk from the smallest set to the largest so that every pair (i, j > i)
+  // is seen once from the larger set i.
+  for (unsigned long i = faces; i-- > 0;)
+  {
+    double p = probabilities.at(i);
+    double smallerCount = static_cast<double>(faces - 1 - i);
+
+    double crossSum = k * deficitMeans.at(i) * smallerCount;
+    if (p > 0)
+    {
+      crossSum -= crossMoments.at(i) * smallerProbabilitySum / p;
+    }
+
+    mean += deficitMeans.at(i);
+    secondMoment += squareMoments.at(i) + 2 * crossSum;
+    smallerProbabilitySum += p;
+  }
+
+  return {
+      .mean = mean,
+      .variance = std::max(0.0, secondMoment - mean * mean),
+  };
+}
+
+// For large pools the kept sum is, up to O(1) ties around the cut-off face t,
+// k * t +/- sum_i max(0, +/-(X_i - t)), which is a sum of independent terms.
+KeepPoolMoments keep_pool_large_pool_moments(
+    unsigned long die,
+    unsigned long faces,
+    unsigned long keep,
+    bool keepHighest
+)
+{
+  double n = static_cast<double>(die);
+  double k = static_cast<double>(keep);
+  double f = static_cast<double>(faces);
+
+  double m = std::floor(k / n * f);
+  double firstMoment = m * (m + 1) / (2 * f);
+  double secondMoment = m * (m + 1) * (2 * m + 1) / (6 * f);
+  double variance = n * (secondMoment - firstMoment * firstMoment);
+
+  if (keepHighest)
+  {
+    return {
+        .mean = k * (f - m) + n * firstMoment,
+        .variance = variance,
+    };
+  }
+
+  return {
+      .mean = k * (m + 1) - n * firstMoment,
+      .variance = variance,
+  };
+}
+
+TreeAnalysis analyze_keep_pool(
+    unsigned long die,
+    unsigned long faces,
+    unsigned long keep,
+    bool keepHighest
+)
+{
+  if (faces < 1 || die < 1 || keep == 0)
+  {
+    return analyze_constant(0);
+  }
+  if (keep >= die)
+  {
+    return analyze_uniform_pool(die, faces);
+  }
+
+  bool exact = static_cast<double>(faces) * static_cast<double>(keep) <=
+               maxExactKeepPoolTerms;
+
+  KeepPoolMoments moments;
+  if (!exact)
+  {
+    moments = keep_pool_large_pool_moments(die, faces, keep, keepHighest);
+  }
+  else if (keepHighest)
+  {
+    moments = keep_pool_deficit_moments(die, faces, keep, 0);
+    moments.mean = static_cast<double>(faces) * static_cast<double>(keep) -
+                   moments.mean;
+  }
+  else
+  {
+    moments = keep_pool_deficit_moments(die, faces, keep, 1);
+  }
+
+  return {
+      .mean = moments.mean,
+      .variance = moments.variance,
+      .min = saturating_from_unsigned(keep),
+      .max = saturating_multiply(
+          saturating_from_unsigned(keep), saturating_from_unsigned(faces)
+      ),
+      .exact = exact,
+  };
+}
+
+TreeAnalysis analyze_exploding_pool(unsigned long die, unsigned long faces)
+{
+  if (faces < 1 || die < 1)
+  {
+    return analyze_constant(0);
+  }
+
+  // Each die is faces * K + R with K ~ Geometric((faces - 1) / faces)
+  // explosions and R uniform over 1 .. faces - 1.
+  double n = static_cast<double>(die);
+  double f = static_cast<double>(faces);
+
+  return {
+      .mean = n * (f / (f - 1) + f / 2),
+      .variance =
+          n * (f * f * f / ((f - 1) * (f - 1)) + ((f - 1) * (f - 1) - 1) / 12),
+      .min = saturating_from_unsigned(die),
+      .max = LONG_MAX,
+      .exact = true,
+  };
+}
+
+// Adds the terms first, first + 1, ..., last, each with probability `p`, to
+// the running sums of a variable and of its square.
+void add_consecutive_terms(
+    double first,
+    double last,
+    double p,
+    double &sum,
+    double &square
+)
+{
+  if (last < first)
+  {
+    return;
+  }
+
+  auto squares = [](double m) { return m * (m + 1) * (2 * m + 1) / 6; };
+  sum += p * (first + last) * (last - first + 1) / 2;
+  square += p * (squares(last) - squares(first - 1));
+}
+
+// The large pool approximation of keep_pool_large_pool_moments() for dice
+// exploding on `faces`. Each die is faces * j + r with probability
+// faces^-(j + 1) for r in 1 .. faces - 1, so the cut-off t and the moments
+// of each die's distance past it are summed a level of explosions at a time.
+// Levels beyond a probability of 1e-18 are dropped, so this takes at most a
+// few dozen steps.
+KeepPoolMoments exploding_keep_pool_moments(
+    unsigned long die,
+    unsigned long faces,
+    unsigned long keep,
+    bool keepHighest
+)
+{
+  constexpr double negligibleLevel = 1e-18;
+  double n = static_cast<double>(die);
+  double k = static_cast<double>(keep);
+  double f = static_cast<double>(faces);
+  double p = k / n;
+
+  // P(X > f j + r) = f^-j (f - r) / f for r in 0 .. f - 1.
+  double level = 0;
+  double levelSurvival = 1;
+  double t = 0;
+  double sum = 0;
+  double square = 0;
+  if (keepHighest)
+  {
+    // The smallest t with P(X > t) <= k / n; about k dice land above it.
+    while (levelSurvival / f > p)
+    {
+      levelSurvival /= f;
+      level++;
+    }
+    t = f * level + std::clamp(std::ceil(f - p * f / levelSurvival), 0.0, f);
+
+    for (double j = level, mass = levelSurvival / f; mass > negligibleLevel;
+         j++, mass /= f)
+    {
+      add_consecutive_terms(
+          std::max(1.0, f * j + 1 - t), f * j + f - 1 - t, mass, sum, square
+      );
+    }
+  }
+  else
+  {
+    // One past the largest u with P(X > u) >= 1 - k / n; about k dice land
+    // below it.
+    while (levelSurvival / f >= 1 - p && levelSurvival / f > negligibleLevel)
+    {
+      levelSurvival /= f;
+      level++;
+    }
+    t = f * level +
+        std::clamp(std::floor(f - (1 - p) * f / levelSurvival), 0.0, f - 1) +
+        1;
+
+    for (double j = 0, mass = 1 / f; f * j + 1 < t && mass > 0;
+         j++, mass /= f)
+    {
+      add_consecutive_terms(
+          t - std::min(f * j + f - 1, t - 1), t - (f * j + 1), mass, sum, square
+      );
+    }
+  }
+
+  double variance = n * std::max(0.0, square - sum * sum);
+  return {
+      .mean = keepHighest ? k * t + n * sum : k * t - n * sum,
+      .variance = variance,
+  };
+}
+
+TreeAnalysis analyze_exploding_keep_pool(
+    unsigned long die,
+    unsigned long faces,
+    unsigned long keep,
+    bool keepHighest
+)
+{
+  if (faces < 1 || die < 1 || keep == 0)
+  {
+    return analyze_constant(0);
+  }
+  if (keep >= die)
+  {
+    return analyze_exploding_pool(die, faces);
+  }
+
+  // There is no closed form, and the exact distribution is far too costly
+  // for an analysis, so the moments are approximated.
+  auto moments = exploding_keep_pool_moments(die, faces, keep, keepHighest);
+  return {
+      .mean = moments.mean,
+      .variance = moments.variance,
+      .min = saturating_from_unsigned(keep),
+      .max = LONG_MAX,
+      .exact = false,
+  };
+}
+
+TreeAnalysis
+analyze_success_count(unsigned long die, double successProbability)
+{
+  double n = static_cast<double>(die);
+
+  return {
+      .mean = n * successProbability,
+      .variance = n * successProbability * (1 - successProbability),
+      .min = successProbability >= 1 ? saturating_from_unsigned(die) : 0,
+      .max = successProbability <= 0 ? 0 : saturating_from_unsigned(die),
+      .exact = true,
+  };
+}
+
+TreeAnalysis analyze_sum(const TreeAnalysis &left, const TreeAnalysis &right)
+{
+  return {
+      .mean = left.mean + right.mean,
+      .variance = left.variance + right.variance,
+      .min = saturating_add(left.min, right.min),
+      .max = saturating_add(left.max, right.max),
+      .exact = left.exact && right.exact,
+  };
+}
+
+TreeAnalysis
+analyze_difference(const TreeAnalysis &left, const TreeAnalysis &right)
+{
+  return {
+      .mean = left.mean - right.mean,
+      .variance = left.variance + right.variance,
+      .min = saturating_subtract(left.min, right.max),
+      .max = saturating_subtract(left.max, right.min),
+      .exact = left.exact && right.exact,
+  };
+}
+
+TreeAnalysis
+analyze_product(const TreeAnalysis &left, const TreeAnalysis &right)
+{
+  long corners[] = {
+      saturating_multiply(left.min, right.min),
+      saturating_multiply(left.min, right.max),
+      saturating_multiply(left.max, right.min),
+      saturating_multiply(left.max, right.max),
+  };
+
+  return {
+      .mean = left.mean * right.mean,
+      .variance = left.variance * right.variance +
+                  left.variance * right.mean * right.mean +
+                  right.variance * left.mean * left.mean,
+      .min = *std::min_element(std::begin(corners), std::end(corners)),
+      .max = *std::max_element(std::begin(corners), std::end(corners)),
+      .exact = left.exact && right.exact,
+  };
+}
+
+// Integer division has no closed form moments, so this bounds the result
+// instead: truncating division is monotonic in each operand on either side of
+// a zero divisor, so the extremes lie on the corners of the operand ranges.
+// The mean and variance are first order estimates clamped to those bounds.
+TreeAnalysis
+analyze_quotient(const TreeAnalysis &left, const TreeAnalysis &right)
+{
+  if (right.min == 0 && right.max == 0)
+  {
+    throw DiceException("Division by zero is not allowed.");
+  }
+
+  std::vector<long> divisors = {right.min, right.max};
+  if (right.min <= -1 && right.max >= -1)
+  {
+    divisors.push_back(-1);
+  }
+  if (right.min <= 1 && right.max >= 1)
+  {
+    divisors.push_back(1);
+  }
+
+  long min = LONG_MAX;
+  long max = LONG_MIN;
+  for (long divisor : divisors)
+  {
+    if (divisor == 0)
+    {
+      continue;
+    }
+
+    for (long dividend : {left.min, left.max})
+    {
+      // LONG_MIN / -1 is the one quotient which does not fit in a long.
+      long quotient = dividend == LONG_MIN && divisor == -1
+                          ? LONG_MAX
+                          : dividend / divisor;
+      min = std::min(min, quotient);
+      max = std::max(max, quotient);
+    }
+  }
+
+  double mean = (static_cast<double>(min) + static_cast<double>(max)) / 2;
+  double variance = 0;
+  if (right.mean != 0)
+  {
+    double rightMeanSquared = right.mean * right.mean;
+    mean = left.mean / right.mean;
+    variance = left.variance / rightMeanSquared + left.mean * left.mean *
+                                                      right.variance /
+                                                      (rightMeanSquared *
+                                                       rightMeanSquared);
+  }
+
+  double range = static_cast<double>(max) - static_cast<double>(min);
+  bool exactDivisor = right.min == right.max && (right.min == 1 ||
+                                                 right.min == -1);
+
+  return {
+      .mean = std::clamp(
+          mean, static_cast<double>(min), static_cast<double>(max)
+      ),
+      .variance = std::min(variance, range * range / 4),
+      .min = min,
+      .max = max,
+      .exact = exactDivisor && left.exact,
+  };
+}
+
+// Normal approximation, with a continuity correction, of the chance that an
+// integer expression with moments `analysis` is at most `value`.
+double approximate_at_most(const TreeAnalysis &analysis, long value)
+{
+  if (value == LONG_MAX)
+  {
+    return 1;
+  }
+  if (value == LONG_MIN)
+  {
+    return 0;
+  }
+
+  double deviation = std::sqrt(analysis.variance);
+  double distance = static_cast<double>(value) + 0.5 - analysis.mean;
+  if (deviation == 0)
+  {
+    return distance >= 0 ? 1 : 0;
+  }
+
+  return 0.5 * std::erfc(-distance / (deviation * std::sqrt(2.0)));
+}
+
+// Whether a bound of `analysis` was clamped to the range of long, in which
+// case evaluation may wrap around and produce results outside the bounds.
+bool bounds_saturated(const TreeAnalysis &analysis)
+{
+  return analysis.min == LONG_MIN || analysis.min == LONG_MAX ||
+         analysis.max == LONG_MIN || analysis.max == LONG_MAX;
+}
+
+TreeAnalysis analyze_difference_within(
+    const TreeAnalysis &left,
+    const TreeAnalysis &right,
+    long low,
+    long high
+)
+{
+  auto difference = analyze_difference(left, right);
+  // Only bounds which did not saturate prove the outcome of every
+  // comparison; otherwise a wrapped result may land on either side.
+  bool bounded = !bounds_saturated(left) && !bounds_saturated(right) &&
+                 !bounds_saturated(difference);
+  if (bounded && difference.min >= low && difference.max <= high)
+  {
+    return analyze_constant(1);
+  }
+  if (bounded && (difference.max < low || difference.min > high))
+  {
+    return analyze_constant(0);
+  }
+
+  double p = std::clamp(
+      approximate_at_most(difference, high) -
+          approximate_at_most(difference, low == LONG_MIN ? low : low - 1),
+      0.0,
+      1.0
+  );
+  return {
+      .mean = p,
+      .variance = p * (1 - p),
+      .min = 0,
+      .max = 1,
+      .exact = false,
+  };
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+// Closed form summary statistics of an expression. `min` and `max` are always
+// exact bounds. `exact` is false when the mean/variance had to be
+// approximated (division, or keep pools too large for the exact method).
+struct TreeAnalysis
+{
+  double mean;
+  double variance;
+  long min;
+  long max;
+  bool exact;
+};
+
+TreeAnalysis analyze_constant(long value);
+
+// Sum of `die` rolls of a `faces`-sided die.
+TreeAnalysis analyze_uniform_pool(unsigned long die, unsigned long faces);
+
+// Sum of the `keep` highest (or lowest) of `die` rolls of a `faces`-sided die.
+TreeAnalysis analyze_keep_pool(
+    unsigned long die,
+    unsigned long faces,
+    unsigned long keep,
+    bool keepHighest
+);
+
+// Sum of `die` exploding rolls of a `faces`-sided die (`faces` > 1).
+TreeAnalysis analyze_exploding_pool(unsigned long die, unsigned long faces);
+
+// Sum of the `keep` highest (or lowest) of `die` exploding rolls of a
+// `faces`-sided die (`faces` > 1). Its moments are approximated in a few
+// dozen steps, so it is never exact.
+TreeAnalysis analyze_exploding_keep_pool(
+    unsigned long die,
+    unsigned long faces,
+    unsigned long keep,
+    bool keepHighest
+);
+
+// Number of successes among `die` dice which each succeed with probability
+// `successProbability`.
+TreeAnalysis
+analyze_success_count(unsigned long die, double successProbability);
+
+// The following assume that both operands are independent.
+TreeAnalysis analyze_sum(const TreeAnalysis &left, const TreeAnalysis &right);
+TreeAnalysis
+analyze_difference(const TreeAnalysis &left, const TreeAnalysis &right);
+TreeAnalysis
+analyze_product(const TreeAnalysis &left, const TreeAnalysis &right);
+TreeAnalysis
+analyze_quotient(const TreeAnalysis &left, const TreeAnalysis &right);
+
+// 1 when `left` minus an independent `right` lies in [low, high], and 0
+// otherwise. Unless the bounds of the difference decide it, which saturated
+// bounds never do, its chance comes from a normal approximation of the
+// difference and is not exact.
+TreeAnalysis analyze_difference_within(
+    const TreeAnalysis &left,
+    const TreeAnalysis &right,
+    long low,
+    long high
+);
@@ -0,0 +1,159 @@
+#include "catalog.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include <cstring>
+#include <format>
+#include <vector>
+
+constexpr char catalogMagic[8] = {'D', 'I', 'C', 'E', 'C', 'T', 'L', 'G'};
+// Version 2 added the source offset of each compiled node.
+constexpr std::uint32_t catalogVersion = 2;
+
+struct CatalogHeader
+{
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t entryCount;
+  std::uint64_t nodeCount;
+  std::uint64_t reserved;
+};
+
+struct CatalogEntry
+{
+  std::uint64_t firstNode;
+  std::uint32_t nodeCount;
+  std::uint32_t stackDepth;
+};
+
+static_assert(sizeof(CatalogHeader) == 32);
+static_assert(sizeof(CatalogEntry) == 16);
+
+std::string compile_catalog(std::string_view source)
+{
+  std::vector<CatalogEntry> entries;
+  std::vector<CompiledNode> nodes;
+
+  std::size_t lineNumber = 0;
+  while (!source.empty())
+  {
+    lineNumber++;
+    std::size_t end = source.find('\n');
+    std::string_view line = source.substr(0, end);
+    source.remove_prefix(
+        end == std::string_view::npos ? source.size() : end + 1
+    );
+    if (!line.empty() && line.back() == '\r')
+    {
+      line.remove_suffix(1);
+    }
+
+    try
+    {
+      auto tree = parse(tokenize(std::string(line)));
+
+      std::size_t firstNode = nodes.size();
+      tree->compile(nodes);
+      std::span<const CompiledNode> program(
+          nodes.data() + firstNode, nodes.size() - firstNode
+      );
+
+      entries.push_back({
+          .firstNode = firstNode,
+          .nodeCount = static_cast<std::uint32_t>(program.size()),
+          .stackDepth =
+              static_cast<std::uint32_t>(validate_program(program).value()),
+      });
+    }
+    catch (DiceException &e)
+    {
+      throw DiceException(std::format("Line {}: {}", lineNumber, e.what()));
+    }
+  }
+
+  CatalogHeader header = {};
+  std::memcpy(header.magic, catalogMagic, sizeof(catalogMagic));
+  header.version = catalogVersion;
+  header.entryCount = static_cast<std::uint32_t>(entries.size());
+  header.nodeCount = nodes.size();
+
+  std::string catalog;
+  catalog.append(reinterpret_cast<const char *>(&header), sizeof(header));
+  catalog.append(
+      reinterpret_cast<const char *>(entries.data()),
+      entries.size() * sizeof(CatalogEntry)
+  );
+  catalog.append(
+      reinterpret_cast<const char *>(nodes.data()),
+      nodes.size() * sizeof(CompiledNode)
+  );
+  return catalog;
+}
+
+Catalog::Catalog(const std::string &path) : file{path}
+{
+  auto contents = file.contents();
+  auto invalid = DiceException(
+      std::format("Catalog '{}' is not a valid catalog file.", path)
+  );
+
+  CatalogHeader header = {};
+  if (contents.size() < sizeof(header))
+  {
+    throw invalid;
+  }
+  std::memcpy(&header, contents.data(), sizeof(header));
+
+  std::uint64_t expectedSize = sizeof(CatalogHeader) +
+                               header.entryCount * sizeof(CatalogEntry) +
+                               header.nodeCount * sizeof(CompiledNode);
+  if (std::memcmp(header.magic, catalogMagic, sizeof(catalogMagic)) != 0 ||
+      header.version != catalogVersion ||
+      header.nodeCount > contents.size() / sizeof(CompiledNode) ||
+      contents.size() != expectedSize)
+  {
+    throw invalid;
+  }
+
+  // The mapping is page aligned and the header and index are multiples of
+  // 16 bytes, so both arrays are suitably aligned.
+  entryCount = header.entryCount;
+  entries = reinterpret_cast<const CatalogEntry *>(
+      contents.data() + sizeof(CatalogHeader)
+  );
+  nodes = reinterpret_cast<const CompiledNode *>(
+      contents.data() + sizeof(CatalogHeader) +
+      entryCount * sizeof(CatalogEntry)
+  );
+
+  for (std::size_t i = 0; i < entryCount; i++)
+  {
+    const CatalogEntry &entry = entries[i];
+    if (entry.firstNode > header.nodeCount ||
+        entry.nodeCount > header.nodeCount - entry.firstNode)
+    {
+      throw invalid;
+    }
+
+    auto depth = validate_program({nodes + entry.firstNode, entry.nodeCount});
+    if (!depth.has_value() || depth.value() > entry.stackDepth)
+    {
+      throw invalid;
+    }
+  }
+}
+
+std::size_t Catalog::size() const { return entryCount; }
+
+std::expected<long, DiceError>
+Catalog::evaluate(std::size_t index, const EvaluationContext &context) const
+{
+  if (index >= entryCount)
+  {
+    throw DiceException(std::format("Catalog has no entry {}.", index));
+  }
+
+  const CatalogEntry &entry = entries[index];
+  return evaluate_program(
+      {nodes + entry.firstNode, entry.nodeCount}, entry.stackDepth, context
+  );
+}
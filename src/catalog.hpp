@@ -0,0 +1,38 @@
+#pragma once
+
+#include "dice_exception.hpp"
+#include "mapped_file.hpp"
+#include "program.hpp"
+#include <cstddef>
+#include <expected>
+#include <string>
+#include <string_view>
+
+struct CatalogEntry;
+
+// Compiles each line of `source` into a catalog entry, returning the bytes of
+// the catalog file. Throws a DiceException naming the first line which is
+// not a valid expression.
+std::string compile_catalog(std::string_view source);
+
+// A catalog file of compiled expressions, used in place through a read-only
+// mapping. The file is a fixed header, an index of entries and then every
+// entry's program back to back; every program is validated once on load, so
+// evaluating one does no further checking, lexing or allocation.
+class Catalog
+{
+private:
+  MappedFile file;
+  const CatalogEntry *entries = nullptr;
+  const CompiledNode *nodes = nullptr;
+  std::size_t entryCount = 0;
+
+public:
+  explicit Catalog(const std::string &path);
+
+  std::size_t size() const;
+  // Evaluates entry `index`, which must be less than size(). The catalog is
+  // only read, so any number of threads may evaluate it at once.
+  std::expected<long, DiceError>
+  evaluate(std::size_t index, const EvaluationContext &context) const;
+};
@@ -0,0 +1,342 @@
+#include "convolution.hpp"
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <numbers>
+
+// Below this much work (left size * right size) direct convolution beats the
+// FFT's setup cost.
+constexpr std::size_t directConvolutionLimit = 1 << 14;
+
+// Three NTT-friendly primes (c * 2^k + 1, primitive root 3). Their product is
+// a little over 2^86, which bounds the integer counts they can reconstruct.
+constexpr std::uint64_t nttPrimes[] = {998244353, 167772161, 469762049};
+constexpr std::uint64_t nttPrimitiveRoot = 3;
+constexpr std::size_t maxNttLength = std::size_t{1} << 23;
+constexpr double maxExactCountBits = 85;
+
+std::size_t transform_length(std::size_t resultSize)
+{
+  std::size_t length = 1;
+  while (length < resultSize)
+  {
+    length <<= 1;
+  }
+
+  return length;
+}
+
+std::vector<double> convolve_direct(
+    const std::vector<double> &left,
+    const std::vector<double> &right
+)
+{
+  std::vector<double> result(left.size() + right.size() - 1, 0.0);
+  for (std::size_t i = 0; i < left.size(); i++)
+  {
+    if (left[i] == 0)
+    {
+      continue;
+    }
+
+    for (std::size_t j = 0; j < right.size(); j++)
+    {
+      result[i + j] += left[i] * right[j];
+    }
+  }
+
+  return result;
+}
+
+void fft(std::vector<std::complex<double>> &values, bool inverse)
+{
+  std::size_t length = values.size();
+
+  for (std::size_t i = 1, j = 0; i < length; i++)
+  {
+    std::size_t bit = length >> 1;
+    for (; j & bit; bit >>= 1)
+    {
+      j ^= bit;
+    }
+    j ^= bit;
+
+    if (i < j)
+    {
+      std::swap(values[i], values[j]);
+    }
+  }
+
+  // Roots are computed directly rather than by repeated multiplication so the
+  // rounding error does not grow with the transform length.
+  std::vector<std::complex<double>> roots(length / 2);
+  double sign = inverse ? 1.0 : -1.0;
+  for (std::size_t i = 0; i < roots.size(); i++)
+  {
+    roots[i] = std::polar(
+        1.0, sign * 2 * std::numbers::pi * static_cast<double>(i) /
+                 static_cast<double>(length)
+    );
+  }
+
+  for (std::size_t half = 1; half < length; half <<= 1)
+  {
+    std::size_t stride = length / (half * 2);
+    for (std::size_t start = 0; start < length; start += half * 2)
+    {
+      for (std::size_t k = 0; k < half; k++)
+      {
+        auto even = values[start + k];
+        auto odd = values[start + k + half] * roots[k * stride];
+        values[start + k] = even + odd;
+        values[start + k + half] = even - odd;
+      }
+    }
+  }
+
+  if (inverse)
+  {
+    for (auto &value : values)
+    {
+      value /= static_cast<double>(length);
+    }
+  }
+}
+
+std::vector<double>
+convolve_fft(const std::vector<double> &left, const std::vector<double> &right)
+{
+  std::size_t resultSize = left.size() + right.size() - 1;
+  std::size_t length = transform_length(resultSize);
+
+  std::vector<std::complex<double>> leftValues(left.begin(), left.end());
+  leftValues.resize(length);
+  fft(leftValues, false);
+
+  std::vector<std::complex<double>> rightValues(right.begin(), right.end());
+  rightValues.resize(length);
+  fft(rightValues, false);
+
+  for (std::size_t i = 0; i < length; i++)
+  {
+    leftValues[i] *= rightValues[i];
+  }
+  fft(leftValues, true);
+
+  // Probabilities are never negative; anything below zero is rounding noise.
+  std::vector<double> result(resultSize);
+  for (std::size_t i = 0; i < resultSize; i++)
+  {
+    result[i] = std::max(0.0, leftValues[i].real());
+  }
+
+  return result;
+}
+
+std::vector<double>
+convolve(const std::vector<double> &left, const std::vector<double> &right)
+{
+  if (left.empty() || right.empty())
+  {
+    return {};
+  }
+
+  std::size_t length = transform_length(left.size() + right.size() - 1);
+  double fftCost = 8.0 * static_cast<double>(length) *
+                   std::log2(static_cast<double>(length) + 1);
+  double directCost = static_cast<double>(left.size()) *
+                      static_cast<double>(right.size());
+
+  if (directCost <= directConvolutionLimit || directCost <= fftCost)
+  {
+    return convolve_direct(left, right);
+  }
+
+  return convolve_fft(left, right);
+}
+
+std::vector<double>
+convolve_power(const std::vector<double> &base, unsigned long exponent)
+{
+  std::vector<double> result = {1.0};
+  std::vector<double> square = base;
+
+  while (exponent > 0)
+  {
+    if (exponent & 1)
+    {
+      result = convolve(result, square);
+    }
+
+    exponent >>= 1;
+    if (exponent > 0)
+    {
+      square = convolve(square, square);
+    }
+  }
+
+  return result;
+}
+
+std::uint64_t
+power_mod(std::uint64_t base, unsigned long exponent, std::uint64_t mod)
+{
+  std::uint64_t result = 1;
+  base %= mod;
+
+  while (exponent > 0)
+  {
+    if (exponent & 1)
+    {
+      result = result * base % mod;
+    }
+    base = base * base % mod;
+    exponent >>= 1;
+  }
+
+  return result;
+}
+
+void ntt(std::vector<std::uint64_t> &values, bool inverse, std::uint64_t mod)
+{
+  std::size_t length = values.size();
+
+  for (std::size_t i = 1, j = 0; i < length; i++)
+  {
+    std::size_t bit = length >> 1;
+    for (; j & bit; bit >>= 1)
+    {
+      j ^= bit;
+    }
+    j ^= bit;
+
+    if (i < j)
+    {
+      std::swap(values[i], values[j]);
+    }
+  }
+
+  for (std::size_t half = 1; half < length; half <<= 1)
+  {
+    std::uint64_t root =
+        power_mod(nttPrimitiveRoot, (mod - 1) / (half * 2), mod);
+    if (inverse)
+    {
+      root = power_mod(root, mod - 2, mod);
+    }
+
+    for (std::size_t start = 0; start < length; start += half * 2)
+    {
+      std::uint64_t twiddle = 1;
+      for (std::size_t k = 0; k < half; k++)
+      {
+        std::uint64_t even = values[start + k];
+        std::uint64_t odd = values[start + k + half] * twiddle % mod;
+        values[start + k] = even + odd < mod ? even + odd : even + odd - mod;
+        values[start + k + half] = even >= odd ? even - odd : even + mod - odd;
+        twiddle = twiddle * root % mod;
+      }
+    }
+  }
+
+  if (inverse)
+  {
+    std::uint64_t lengthInverse = power_mod(length % mod, mod - 2, mod);
+    for (auto &value : values)
+    {
+      value = value * lengthInverse % mod;
+    }
+  }
+}
+
+// Counts recombined from their residues modulo the three primes take up to
+// 86 bits. __extension__ keeps -Wpedantic quiet about the GCC/Clang type.
+__extension__ using GarnerCount = unsigned __int128;
+
+std::optional<std::vector<double>> convolve_power_exact(
+    const std::vector<unsigned long> &weights,
+    unsigned long exponent
+)
+{
+  if (weights.empty())
+  {
+    return std::nullopt;
+  }
+
+  unsigned long total = 0;
+  for (auto weight : weights)
+  {
+    total += weight;
+  }
+  if (total == 0)
+  {
+    return std::nullopt;
+  }
+
+  // Every count is at most total^exponent, which must fit under the CRT
+  // modulus for the reconstruction to be exact.
+  double countBits =
+      static_cast<double>(exponent) * std::log2(static_cast<double>(total));
+  double resultSize =
+      static_cast<double>(exponent) * static_cast<double>(weights.size() - 1) +
+      1;
+  if (countBits > maxExactCountBits || resultSize > maxNttLength)
+  {
+    return std::nullopt;
+  }
+
+  std::size_t size = static_cast<std::size_t>(resultSize);
+  std::size_t length = transform_length(size);
+
+  // A power of a polynomial is a pointwise power of its transform, so each
+  // residue needs one forward and one inverse transform.
+  std::vector<std::vector<std::uint64_t>> residues;
+  for (std::uint64_t mod : nttPrimes)
+  {
+    std::vector<std::uint64_t> values(length, 0);
+    for (std::size_t i = 0; i < weights.size(); i++)
+    {
+      values[i] = weights[i] % mod;
+    }
+
+    ntt(values, false, mod);
+    for (auto &value : values)
+    {
+      value = power_mod(value, exponent, mod);
+    }
+    ntt(values, true, mod);
+
+    residues.push_back(std::move(values));
+  }
+
+  std::uint64_t m0 = nttPrimes[0];
+  std::uint64_t m1 = nttPrimes[1];
+  std::uint64_t m2 = nttPrimes[2];
+  std::uint64_t m0InverseMod1 = power_mod(m0, m1 - 2, m1);
+  std::uint64_t m0m1InverseMod2 = power_mod(m0 * m1 % m2, m2 - 2, m2);
+  long double totalCount = std::pow(
+      static_cast<long double>(total), static_cast<long double>(exponent)
+  );
+
+  std::vector<double> result(size);
+  for (std::size_t i = 0; i < size; i++)
+  {
+    // Garner's algorithm: count = x0 + x1 * m0 + x2 * m0 * m1.
+    std::uint64_t x0 = residues[0][i];
+    std::uint64_t x1 =
+        (residues[1][i] + m1 - x0 % m1) % m1 * m0InverseMod1 % m1;
+    std::uint64_t partial = (x0 + x1 * m0) % m2;
+    std::uint64_t x2 =
+        (residues[2][i] + m2 - partial) % m2 * m0m1InverseMod2 % m2;
+
+    GarnerCount count = static_cast<GarnerCount>(x0) +
+                        static_cast<GarnerCount>(x1) * m0 +
+                        static_cast<GarnerCount>(x2) * m0 * m1;
+
+    result[i] =
+        static_cast<double>(static_cast<long double>(count) / totalCount);
+  }
+
+  return result;
+}
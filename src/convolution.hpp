@@ -0,0 +1,23 @@
+#pragma once
+
+#include <optional>
+#include <vector>
+
+// Discrete convolution of two sequences. Small inputs are convolved directly,
+// larger ones with a double precision FFT in O(S log S).
+std::vector<double>
+convolve(const std::vector<double> &left, const std::vector<double> &right);
+
+// `base` convolved with itself `exponent` times, by repeated squaring.
+std::vector<double>
+convolve_power(const std::vector<double> &base, unsigned long exponent);
+
+// Exact distribution of the sum of `exponent` independent draws where outcome
+// i has probability weights[i] / sum(weights). The integer counts are
+// computed with number theoretic transforms modulo three primes and
+// reconstructed with the CRT, so even the far tails are exact. Returns
+// std::nullopt when the counts are too large to be represented that way.
+std::optional<std::vector<double>> convolve_power_exact(
+    const std::vector<unsigned long> &weights,
+    unsigned long exponent
+);
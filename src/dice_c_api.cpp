@@ -0,0 +1,257 @@
+#include "dice_c_api.h"
+#include "dice_exception.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "random.hpp"
+#include <memory>
+#include <new>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+struct DiceExpression
+{
+  std::unique_ptr<Tree> tree;
+  EvaluationLimits limits;
+};
+
+struct DiceGenerator
+{
+  std::mt19937 rng;
+};
+
+// Results are written straight into the caller's buffer.
+static_assert(std::is_same_v<int64_t, long>);
+static_assert(
+    DICE_TOO_MANY_DICE == static_cast<int>(DiceErrorCode::TooManyDice) + 1,
+    "Expression statuses must follow DiceErrorCode."
+);
+
+static int32_t dice_status(DiceErrorCode code)
+{
+  return static_cast<int32_t>(code) + 1;
+}
+
+// Runs `body`, turning any exception into a status, since none may cross
+// into the caller's language.
+template <typename Body> static int32_t guard_c_call(Body body)
+{
+  try
+  {
+    return body();
+  }
+  catch (const std::bad_alloc &)
+  {
+    return DICE_OUT_OF_MEMORY;
+  }
+  catch (...)
+  {
+    return DICE_INTERNAL_ERROR;
+  }
+}
+
+const char *dice_status_message(int32_t status)
+{
+  switch (status)
+  {
+  case DICE_OK:
+    return "Success.";
+  case DICE_UNEXPECTED_CHARACTER:
+    return "The expression contains an unexpected character.";
+  case DICE_INTEGER_TOO_LARGE:
+    return "The expression contains an integer which is too large.";
+  case DICE_EMPTY_INPUT:
+    return "The expression is empty.";
+  case DICE_INVALID_EXPRESSION:
+    return "The expression is not valid.";
+  case DICE_UNCLOSED_PARENTHETICAL:
+    return "The expression has an unclosed parenthesis.";
+  case DICE_NESTED_TOO_DEEPLY:
+    return "The expression is nested too deeply.";
+  case DICE_EXPRESSION_TOO_LONG:
+    return "The expression is too long.";
+  case DICE_DIVISION_BY_ZERO:
+    return "Division by zero is not allowed.";
+  case DICE_TOO_MANY_DICE:
+    return "The expression rolls too many dice at once.";
+  case DICE_INVALID_ARGUMENT:
+    return "An argument is not valid.";
+  case DICE_OUT_OF_MEMORY:
+    return "Out of memory.";
+  case DICE_INTERNAL_ERROR:
+    return "An unexpected error has occurred.";
+  }
+
+  return "Unknown status.";
+}
+
+int32_t dice_compile(
+    const char *expression,
+    size_t length,
+    DiceExpression **compiled,
+    size_t *errorOffset
+)
+{
+  if (compiled == nullptr || (expression == nullptr && length > 0))
+  {
+    return DICE_INVALID_ARGUMENT;
+  }
+  *compiled = nullptr;
+
+  return guard_c_call([&]() -> int32_t {
+    auto fail = [&](const DiceError &error) {
+      if (errorOffset != nullptr)
+      {
+        *errorOffset = error.offset;
+      }
+      return dice_status(error.code);
+    };
+
+    auto tokens = try_tokenize(std::string_view(expression, length));
+    if (!tokens.has_value())
+    {
+      return fail(tokens.error());
+    }
+    auto tree = try_parse(tokens.value());
+    if (!tree.has_value())
+    {
+      return fail(tree.error());
+    }
+
+    *compiled = new DiceExpression{
+        .tree = std::move(tree.value()),
+        .limits = {},
+    };
+    return DICE_OK;
+  });
+}
+
+void dice_expression_free(DiceExpression *expression) { delete expression; }
+
+int32_t
+dice_expression_set_max_dice(DiceExpression *expression, uint64_t maxDice)
+{
+  if (expression == nullptr)
+  {
+    return DICE_INVALID_ARGUMENT;
+  }
+
+  expression->limits.maxDicePerRoll = maxDice;
+  return DICE_OK;
+}
+
+DiceGenerator *dice_generator_create(uint64_t seed)
+{
+  std::seed_seq seeds{
+      static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32)
+  };
+  return new (std::nothrow) DiceGenerator{.rng = std::mt19937(seeds)};
+}
+
+void dice_generator_free(DiceGenerator *generator) { delete generator; }
+
+// Evaluates one result, recording its status if the caller asked for them.
+static int32_t evaluate_c_result(
+    const DiceExpression &expression,
+    std::mt19937 &rng,
+    int64_t &result,
+    int32_t *status
+)
+{
+  auto value =
+      expression.tree->tryExecute({.rng = rng, .limits = expression.limits});
+  result = value.has_value() ? value.value() : 0;
+  int32_t code =
+      value.has_value() ? DICE_OK : dice_status(value.error().code);
+  if (status != nullptr)
+  {
+    *status = code;
+  }
+  return code;
+}
+
+int32_t dice_evaluate_many(
+    const DiceExpression *expression,
+    DiceGenerator *generator,
+    size_t count,
+    int64_t *results,
+    int32_t *statuses
+)
+{
+  if (expression == nullptr || (results == nullptr && count > 0))
+  {
+    return DICE_INVALID_ARGUMENT;
+  }
+
+  return guard_c_call([&]() -> int32_t {
+    std::mt19937 &rng = generator != nullptr ? generator->rng : Random::mt;
+    // The whole batch is evaluated a node at a time in one pass, with each
+    // sample's error recorded at its index rather than failing the batch.
+    std::vector<std::optional<DiceErrorCode>> errors(count);
+    EvaluationContext context = {
+        .rng = rng,
+        .trace = nullptr,
+        .limits = expression->limits,
+        .sampleErrors = errors,
+    };
+    expression->tree->executeMany(context, std::span<long>(results, count));
+
+    int32_t first = DICE_OK;
+    for (size_t i = 0; i < count; i++)
+    {
+      int32_t status = DICE_OK;
+      if (errors[i].has_value())
+      {
+        status = dice_status(errors[i].value());
+        results[i] = 0;
+      }
+      if (statuses != nullptr)
+      {
+        statuses[i] = status;
+      }
+      first = first == DICE_OK ? status : first;
+    }
+    return first;
+  });
+}
+
+int32_t dice_evaluate_batch(
+    const DiceExpression *const *expressions,
+    DiceGenerator *generator,
+    size_t count,
+    int64_t *results,
+    int32_t *statuses
+)
+{
+  if (count > 0 && (expressions == nullptr || results == nullptr))
+  {
+    return DICE_INVALID_ARGUMENT;
+  }
+
+  return guard_c_call([&]() -> int32_t {
+    std::mt19937 &rng = generator != nullptr ? generator->rng : Random::mt;
+
+    int32_t first = DICE_OK;
+    for (size_t i = 0; i < count; i++)
+    {
+      int32_t *status = statuses != nullptr ? statuses + i : nullptr;
+      int32_t code = DICE_INVALID_ARGUMENT;
+      if (expressions[i] == nullptr)
+      {
+        results[i] = 0;
+        if (status != nullptr)
+        {
+          *status = code;
+        }
+      }
+      else
+      {
+        code = evaluate_c_result(*expressions[i], rng, results[i], status);
+      }
+      first = first == DICE_OK ? code : first;
+    }
+    return first;
+  });
+}
@@ -0,0 +1,110 @@
+/*
+ * C interface to the dice algebra calculator, for calling it from other
+ * languages through their foreign function interfaces. Expressions are
+ * compiled once into opaque handles and evaluated in batches, writing into
+ * buffers owned by the caller, so that one call can produce any number of
+ * results.
+ *
+ * Once configured, compiled expressions are immutable and may be evaluated by
+ * any number of threads at once. A generator may only be used by one thread at
+ * a time.
+ * No function lets an exception escape.
+ */
+#ifndef DICE_C_API_H
+#define DICE_C_API_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Marks the functions exported by the shared library, which hides every
+ * other symbol. */
+#if defined(__GNUC__)
+#define DICE_API __attribute__((visibility("default")))
+#else
+#define DICE_API
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* The outcome of a call, or of evaluating one result. The errors from
+ * DICE_UNEXPECTED_CHARACTER to DICE_TOO_MANY_DICE are errors in the
+ * expression, and the others are errors in the call. */
+enum
+{
+  DICE_OK = 0,
+  DICE_UNEXPECTED_CHARACTER = 1,
+  DICE_INTEGER_TOO_LARGE = 2,
+  DICE_EMPTY_INPUT = 3,
+  DICE_INVALID_EXPRESSION = 4,
+  DICE_UNCLOSED_PARENTHETICAL = 5,
+  DICE_NESTED_TOO_DEEPLY = 6,
+  DICE_EXPRESSION_TOO_LONG = 7,
+  DICE_DIVISION_BY_ZERO = 8,
+  DICE_TOO_MANY_DICE = 9,
+  DICE_INVALID_ARGUMENT = 100,
+  DICE_OUT_OF_MEMORY = 101,
+  DICE_INTERNAL_ERROR = 102
+};
+
+typedef struct DiceExpression DiceExpression;
+typedef struct DiceGenerator DiceGenerator;
+
+/* A static, human readable description of a status. */
+DICE_API const char *dice_status_message(int32_t status);
+
+/* Compiles the `length` bytes of `expression` into `*compiled`, which must
+ * be released with dice_expression_free(). On failure `*compiled` is set to
+ * NULL and, if `errorOffset` is not NULL, the byte offset of the offending
+ * token is written to it. */
+DICE_API int32_t dice_compile(
+    const char *expression,
+    size_t length,
+    DiceExpression **compiled,
+    size_t *errorOffset
+);
+
+DICE_API void dice_expression_free(DiceExpression *expression);
+
+/* Rolls of a single die with more dice than this fail with
+ * DICE_TOO_MANY_DICE. Unlimited by default; set a limit when evaluating
+ * untrusted expressions. This is the only function which modifies a compiled
+ * expression: call it right after dice_compile, before the handle is shared or
+ * evaluated, and never while another thread may be using it. */
+DICE_API int32_t
+dice_expression_set_max_dice(DiceExpression *expression, uint64_t maxDice);
+
+/* A random number generator, seeded deterministically. */
+DICE_API DiceGenerator *dice_generator_create(uint64_t seed);
+DICE_API void dice_generator_free(DiceGenerator *generator);
+
+/* Evaluates `expression` `count` times into `results`. If `statuses` is not
+ * NULL the status of each result is written to it; failed results are 0.
+ * A NULL `generator` uses a generator private to the calling thread and
+ * seeded unpredictably. Returns DICE_OK if every result succeeded, and
+ * otherwise the status of the first which failed. */
+DICE_API int32_t dice_evaluate_many(
+    const DiceExpression *expression,
+    DiceGenerator *generator,
+    size_t count,
+    int64_t *results,
+    int32_t *statuses
+);
+
+/* As dice_evaluate_many(), evaluating each of the `count` expressions in
+ * `expressions` once. */
+DICE_API int32_t dice_evaluate_batch(
+    const DiceExpression *const *expressions,
+    DiceGenerator *generator,
+    size_t count,
+    int64_t *results,
+    int32_t *statuses
+);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,8 +1,37 @@
+#pragma once
+
+#include <cstddef>
 #include <stdexcept>
 #include <string>
 
+enum class DiceErrorCode
+{
+  UnexpectedCharacter,
+  IntegerTooLarge,
+  EmptyInput,
+  InvalidExpression,
+  UnclosedParenthetical,
+  NestedTooDeeply,
+  ExpressionTooLong,
+  DivisionByZero,
+  TooManyDice
+};
+
+// An error in a user's expression, with the byte offset into the expression
+// of the token which caused it.
+struct DiceError
+{
+  DiceErrorCode code;
+  std::string message;
+  std::size_t offset;
+};
+
 class DiceException : public std::runtime_error
 {
 public:
   DiceException(std::string msg) : std::runtime_error(msg) {}
+  explicit DiceException(const DiceError &error)
+      : std::runtime_error(error.message)
+  {
+  }
 };
@@ -0,0 +1,556 @@
+#include "distribution.hpp"
+#include "convolution.hpp"
+#include "dice_exception.hpp"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <functional>
+
+// Largest number of distinct outcomes a distribution may have.
+constexpr double maxDistributionSupport = 1 << 24;
+// Largest number of state updates made computing a keep pool.
+constexpr double maxKeepPoolOperations = 1e10;
+// Largest number of operand pairs combined for products and quotients.
+constexpr double maxPairwiseOutcomes = 1 << 26;
+// Exploding dice are cut off once the chance of exploding again is below this.
+constexpr double explodingTailProbability = 1e-15;
+
+void validate_distribution_size(double size)
+{
+  if (size > maxDistributionSupport)
+  {
+    throw DiceException(
+        "Expression is too large to compute an exact distribution."
+    );
+  }
+}
+
+Distribution point_distribution(long value)
+{
+  return {
+      .offset = value,
+      .probabilities = {1.0},
+  };
+}
+
+Distribution uniform_distribution(unsigned long faces)
+{
+  if (faces < 1)
+  {
+    return point_distribution(0);
+  }
+  validate_distribution_size(static_cast<double>(faces));
+
+  return {
+      .offset = 1,
+      .probabilities =
+          std::vector<double>(faces, 1.0 / static_cast<double>(faces)),
+  };
+}
+
+Distribution uniform_pool_distribution(unsigned long die, unsigned long faces)
+{
+  if (faces < 1 || die < 1)
+  {
+    return point_distribution(0);
+  }
+  validate_distribution_size(
+      static_cast<double>(die) * static_cast<double>(faces - 1) + 1
+  );
+
+  auto exact =
+      convolve_power_exact(std::vector<unsigned long>(faces, 1), die);
+  if (exact.has_value())
+  {
+    return {
+        .offset = static_cast<long>(die),
+        .probabilities = std::move(exact.value()),
+    };
+  }
+
+  return {
+      .offset = static_cast<long>(die),
+      .probabilities =
+          convolve_power(uniform_distribution(faces).probabilities, die),
+  };
+}
+
+Distribution exploding_distribution(unsigned long faces)
+{
+  // After k explosions the die shows faces * k + r for r = 1 .. faces - 1,
+  // each with probability faces^-(k + 1).
+  double f = static_cast<double>(faces);
+  unsigned long levels = static_cast<unsigned long>(
+      std::ceil(-std::log(explodingTailProbability) / std::log(f))
+  );
+  validate_distribution_size(static_cast<double>(levels) * f);
+
+  std::vector<double> probabilities(levels * faces - 1, 0.0);
+  double probability = 1 / f;
+  for (unsigned long k = 0; k < levels; k++)
+  {
+    std::fill_n(probabilities.begin() + k * faces, faces - 1, probability);
+    probability /= f;
+  }
+
+  return {
+      .offset = 1,
+      .probabilities = std::move(probabilities),
+  };
+}
+
+Distribution
+exploding_pool_distribution(unsigned long die, unsigned long faces)
+{
+  if (faces < 1 || die < 1)
+  {
+    return point_distribution(0);
+  }
+
+  auto single = exploding_distribution(faces);
+  validate_distribution_size(
+      static_cast<double>(die) *
+          static_cast<double>(single.probabilities.size() - 1) +
+      1
+  );
+
+  return {
+      .offset = static_cast<long>(die),
+      .probabilities = convolve_power(single.probabilities, die),
+  };
+}
+
+Distribution keep_pool_distribution(
+    unsigned long die,
+    unsigned long faces,
+    unsigned long keep,
+    bool keepHighest
+)
+{
+  if (faces < 1 || die < 1 || keep == 0)
+  {
+    return point_distribution(0);
+  }
+  if (keep >= die)
+  {
+    return uniform_pool_distribution(die, faces);
+  }
+
+  return keep_pool_distribution(
+      uniform_distribution(faces), die, keep, keepHighest
+  );
+}
+
+// Log of the binomial probability mass C(n, c) p^c (1 - p)^(n - c) for
+// c = 0, 1, ..., count - 1, with 0 < p < 1.
+std::vector<double> binomial_log_masses(double n, double p, unsigned long count)
+{
+  std::vector<double> logMasses(count);
+  double logRatio = std::log(p) - std::log1p(-p);
+  double logMass = n * std::log1p(-p);
+
+  for (unsigned long c = 0; c < count; c++)
+  {
+    logMasses[c] = logMass;
+    logMass += std::log((n - static_cast<double>(c)) / (c + 1)) + logRatio;
+  }
+
+  return logMasses;
+}
+
+// The dice are assigned to values from the most to the least favoured
+// (highest first when keeping the highest). Until `keep` dice have been
+// assigned every assigned die is kept, so the state is just (dice assigned
+// and kept, kept sum). Given that the remaining dice all lie at or below the
+// current value, the number landing exactly on it is binomial. Once `keep`
+// dice are assigned the rest cannot change the kept sum, so that whole tail
+// is folded into the result at once. This is O(values^2 * keep^3) instead of
+// the values^die of enumerating every roll.
+Distribution keep_pool_distribution(
+    const Distribution &single,
+    unsigned long die,
+    unsigned long keep,
+    bool keepHighest
+)
+{
+  if (die < 1 || keep == 0)
+  {
+    return point_distribution(0);
+  }
+  if (keep >= die)
+  {
+    return {
+        .offset = single.offset * static_cast<long>(die),
+        .probabilities = convolve_power(single.probabilities, die),
+    };
+  }
+
+  std::size_t span = single.probabilities.size() - 1;
+  double keptSums = static_cast<double>(keep) * static_cast<double>(span) + 1;
+  double operations = static_cast<double>(span + 1) *
+                      static_cast<double>(keep) * static_cast<double>(keep) *
+                      keptSums;
+  validate_distribution_size(keptSums);
+  if (operations > maxKeepPoolOperations)
+  {
+    throw DiceException(
+        "Expression is too large to compute an exact distribution."
+    );
+  }
+
+  std::size_t sums = static_cast<std::size_t>(keptSums);
+  // states[j][s]: probability that the j most favoured dice are assigned,
+  // their sum is s (relative to j * lowest value) and the rest are no more
+  // favoured than the current value.
+  std::vector<std::vector<double>> states(keep, std::vector<double>(sums, 0.0));
+  states[0][0] = 1;
+  std::vector<double> result(sums, 0.0);
+
+  double remainingMass = 0;
+  for (double probability : single.probabilities)
+  {
+    remainingMass += probability;
+  }
+
+  std::size_t lastStep = 0;
+  for (std::size_t step = 0; step <= span; step++)
+  {
+    if (single.probabilities[keepHighest ? span - step : step] > 0)
+    {
+      lastStep = step;
+    }
+  }
+
+  double n = static_cast<double>(die);
+  for (std::size_t step = 0; step <= lastStep; step++)
+  {
+    std::size_t index = keepHighest ? span - step : step;
+    double probability = single.probabilities[index];
+    if (probability <= 0)
+    {
+      continue;
+    }
+
+    // Conditional probability that a remaining die shows this value.
+    double p = step == lastStep ? 1.0
+                                : std::min(1.0, probability / remainingMass);
+    remainingMass -= probability;
+
+    for (unsigned long j = keep; j-- > 0;)
+    {
+      unsigned long needed = keep - j;
+      double remaining = n - static_cast<double>(j);
+      std::vector<double> masses(needed, 0.0);
+      if (p < 1)
+      {
+        auto logMasses = binomial_log_masses(remaining, p, needed);
+        for (unsigned long c = 0; c < needed; c++)
+        {
+          masses[c] = std::exp(logMasses[c]);
+        }
+      }
+
+      double tail = 1;
+      for (double mass : masses)
+      {
+        tail -= mass;
+      }
+      tail = std::max(0.0, tail);
+
+      auto &from = states[j];
+      for (std::size_t s = 0; s < sums; s++)
+      {
+        double mass = from[s];
+        if (mass == 0)
+        {
+          continue;
+        }
+
+        // At least `needed` dice land here: the pool's kept dice are done.
+        result[s + needed * index] += mass * tail;
+
+        for (unsigned long c = 1; c < needed; c++)
+        {
+          states[j + c][s + c * index] += mass * masses[c];
+        }
+        from[s] = mass * masses[0];
+      }
+    }
+  }
+
+  return {
+      .offset = single.offset * static_cast<long>(keep),
+      .probabilities = std::move(result),
+  };
+}
+
+Distribution
+success_count_distribution(unsigned long die, double successProbability)
+{
+  if (die < 1 || successProbability <= 0)
+  {
+    return point_distribution(0);
+  }
+  if (successProbability >= 1)
+  {
+    return point_distribution(static_cast<long>(die));
+  }
+  validate_distribution_size(static_cast<double>(die) + 1);
+
+  auto probabilities = binomial_log_masses(
+      static_cast<double>(die), successProbability, die + 1
+  );
+  for (double &probability : probabilities)
+  {
+    probability = std::exp(probability);
+  }
+
+  return {
+      .offset = 0,
+      .probabilities = std::move(probabilities),
+  };
+}
+
+Distribution
+sum_distribution(const Distribution &left, const Distribution &right)
+{
+  validate_distribution_size(
+      static_cast<double>(left.probabilities.size()) +
+      static_cast<double>(right.probabilities.size())
+  );
+
+  return {
+      .offset = left.offset + right.offset,
+      .probabilities = convolve(left.probabilities, right.probabilities),
+  };
+}
+
+Distribution
+difference_distribution(const Distribution &left, const Distribution &right)
+{
+  validate_distribution_size(
+      static_cast<double>(left.probabilities.size()) +
+      static_cast<double>(right.probabilities.size())
+  );
+
+  // left - right is left + (-right), and negating a distribution reverses it.
+  std::vector<double> negated(
+      right.probabilities.rbegin(), right.probabilities.rend()
+  );
+  long negatedOffset =
+      -(right.offset + static_cast<long>(right.probabilities.size()) - 1);
+
+  return {
+      .offset = left.offset + negatedOffset,
+      .probabilities = convolve(left.probabilities, negated),
+  };
+}
+
+// Combines every pair of outcomes with `combine`, which may map distinct
+// pairs onto the same value. The result range is bounded by `combine` applied
+// to the corners of the operand ranges.
+Distribution combine_distributions(
+    const Distribution &left,
+    const Distribution &right,
+    const std::function<long(long, long)> &combine
+)
+{
+  double pairs = static_cast<double>(left.probabilities.size()) *
+                 static_cast<double>(right.probabilities.size());
+  if (pairs > maxPairwiseOutcomes)
+  {
+    throw DiceException(
+        "Expression is too large to compute an exact distribution."
+    );
+  }
+
+  long leftMax = left.offset + static_cast<long>(left.probabilities.size()) - 1;
+  long rightMax =
+      right.offset + static_cast<long>(right.probabilities.size()) - 1;
+
+  long min = combine(left.offset, right.offset);
+  long max = min;
+  for (long leftValue : {left.offset, leftMax})
+  {
+    for (long rightValue : {right.offset, rightMax})
+    {
+      long value = combine(leftValue, rightValue);
+      min = std::min(min, value);
+      max = std::max(max, value);
+    }
+  }
+  validate_distribution_size(
+      static_cast<double>(max) - static_cast<double>(min) + 1
+  );
+
+  std::vector<double> probabilities(max - min + 1, 0.0);
+  for (std::size_t i = 0; i < left.probabilities.size(); i++)
+  {
+    if (left.probabilities[i] == 0)
+    {
+      continue;
+    }
+
+    for (std::size_t j = 0; j < right.probabilities.size(); j++)
+    {
+      long value = combine(
+          left.offset + static_cast<long>(i),
+          right.offset + static_cast<long>(j)
+      );
+      probabilities[value - min] +=
+          left.probabilities[i] * right.probabilities[j];
+    }
+  }
+
+  return {
+      .offset = min,
+      .probabilities = std::move(probabilities),
+  };
+}
+
+Distribution
+product_distribution(const Distribution &left, const Distribution &right)
+{
+  return combine_distributions(left, right, [](long a, long b) {
+    long result;
+    if (__builtin_mul_overflow(a, b, &result))
+    {
+      throw DiceException(
+          "Expression is too large to compute an exact distribution."
+      );
+    }
+    return result;
+  });
+}
+
+Distribution
+quotient_distribution(const Distribution &left, const Distribution &right)
+{
+  long rightMax =
+      right.offset + static_cast<long>(right.probabilities.size()) - 1;
+  if (right.offset <= 0 && rightMax >= 0 &&
+      right.probabilities[-right.offset] > 0)
+  {
+    throw DiceException("Division by zero is not allowed.");
+  }
+
+  // Zero divisors have no probability mass, but the corners of the divisor
+  // range may still be zero, so they are split around it.
+  Distribution result = point_distribution(0);
+  bool haveResult = false;
+  for (bool negative : {true, false})
+  {
+    long from = negative ? right.offset : std::max(right.offset, 1L);
+    long to = negative ? std::min(rightMax, -1L) : rightMax;
+    if (from > to)
+    {
+      continue;
+    }
+
+    Distribution side = {
+        .offset = from,
+        .probabilities = std::vector<double>(
+            right.probabilities.begin() + (from - right.offset),
+            right.probabilities.begin() + (to - right.offset) + 1
+        ),
+    };
+    auto partial = combine_distributions(left, side, [](long a, long b) {
+      return a == LONG_MIN && b == -1 ? LONG_MAX : a / b;
+    });
+
+    if (!haveResult)
+    {
+      result = std::move(partial);
+      haveResult = true;
+      continue;
+    }
+
+    long min = std::min(result.offset, partial.offset);
+    long max = std::max(
+        result.offset + static_cast<long>(result.probabilities.size()),
+        partial.offset + static_cast<long>(partial.probabilities.size())
+    );
+    std::vector<double> merged(max - min, 0.0);
+    for (const auto *distribution : {&result, &partial})
+    {
+      for (std::size_t i = 0; i < distribution->probabilities.size(); i++)
+      {
+        merged[distribution->offset - min + i] +=
+            distribution->probabilities[i];
+      }
+    }
+    result = {
+        .offset = min,
+        .probabilities = std::move(merged),
+    };
+  }
+
+  return result;
+}
+
+// Number of outcomes of `distribution` which are at most `value`.
+std::size_t outcomes_at_most(const Distribution &distribution, long value)
+{
+  if (value < distribution.offset)
+  {
+    return 0;
+  }
+
+  // Unsigned, so that the difference cannot overflow.
+  unsigned long index = static_cast<unsigned long>(value) -
+                        static_cast<unsigned long>(distribution.offset);
+  return std::min<std::size_t>(index + 1, distribution.probabilities.size());
+}
+
+// Number of outcomes of `distribution` which are at most `x - shift`, which
+// may lie outside the range of long.
+std::size_t outcomes_at_most_difference(
+    const Distribution &distribution,
+    long x,
+    long shift
+)
+{
+  long value;
+  if (__builtin_sub_overflow(x, shift, &value))
+  {
+    return shift > 0 ? 0 : distribution.probabilities.size();
+  }
+
+  return outcomes_at_most(distribution, value);
+}
+
+Distribution difference_within_distribution(
+    const Distribution &left,
+    const Distribution &right,
+    long low,
+    long high
+)
+{
+  // cumulative[i] is the chance of the first i outcomes of `right`.
+  std::vector<double> cumulative(right.probabilities.size() + 1, 0.0);
+  for (std::size_t i = 0; i < right.probabilities.size(); i++)
+  {
+    cumulative[i + 1] = cumulative[i] + right.probabilities[i];
+  }
+
+  // x - r lies in [low, high] when r lies in [x - high, x - low].
+  double probability = 0;
+  for (std::size_t i = 0; i < left.probabilities.size(); i++)
+  {
+    long x = left.offset + static_cast<long>(i);
+    std::size_t below =
+        high == LONG_MAX ? 0 : outcomes_at_most_difference(right, x, high + 1);
+    std::size_t through = outcomes_at_most_difference(right, x, low);
+    if (through > below)
+    {
+      probability +=
+          left.probabilities[i] * (cumulative[through] - cumulative[below]);
+    }
+  }
+
+  probability = std::clamp(probability, 0.0, 1.0);
+  return {
+      .offset = 0,
+      .probabilities = {1 - probability, probability},
+  };
+}
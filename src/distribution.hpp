@@ -0,0 +1,70 @@
+#pragma once
+
+#include <vector>
+
+// Probability mass function over the consecutive integers `offset`,
+// `offset + 1`, ..., `offset + probabilities.size() - 1`.
+struct Distribution
+{
+  long offset;
+  std::vector<double> probabilities;
+};
+
+Distribution point_distribution(long value);
+
+// A single roll of a `faces`-sided die.
+Distribution uniform_distribution(unsigned long faces);
+
+// Sum of `die` rolls of a `faces`-sided die.
+Distribution uniform_pool_distribution(unsigned long die, unsigned long faces);
+
+// A single exploding `faces`-sided die (`faces` > 1), truncated once the
+// chance of any further explosion is negligible.
+Distribution exploding_distribution(unsigned long faces);
+
+// Sum of `die` exploding rolls of a `faces`-sided die.
+Distribution
+exploding_pool_distribution(unsigned long die, unsigned long faces);
+
+// Number of successes among `die` dice which each succeed with probability
+// `p`, which is binomial.
+Distribution
+success_count_distribution(unsigned long die, double successProbability);
+
+// Sum of the `keep` highest (or lowest) of `die` rolls of a `faces`-sided die.
+Distribution keep_pool_distribution(
+    unsigned long die,
+    unsigned long faces,
+    unsigned long keep,
+    bool keepHighest
+);
+
+// Sum of the `keep` highest (or lowest) of `die` independent draws from
+// `single`.
+Distribution keep_pool_distribution(
+    const Distribution &single,
+    unsigned long die,
+    unsigned long keep,
+    bool keepHighest
+);
+
+// The following assume that both operands are independent.
+Distribution
+sum_distribution(const Distribution &left, const Distribution &right);
+Distribution
+difference_distribution(const Distribution &left, const Distribution &right);
+Distribution
+product_distribution(const Distribution &left, const Distribution &right);
+Distribution
+quotient_distribution(const Distribution &left, const Distribution &right);
+
+// 1 when `left` minus an independent `right` lies in [low, high], and 0
+// otherwise, which is how comparisons of two expressions are evaluated. Its
+// chance is summed exactly over every pair of outcomes, in time linear in
+// the sizes of the operands.
+Distribution difference_within_distribution(
+    const Distribution &left,
+    const Distribution &right,
+    long low,
+    long high
+);
@@ -0,0 +1,413 @@
+#include "distribution_cache.hpp"
+#include "dice_exception.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <format>
+#include <memory>
+#include <mutex>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+constexpr char cacheMagic[8] = {'D', 'I', 'C', 'E', 'D', 'I', 'S', 'T'};
+// Version 2 added the slot flags, which version 1 left as reserved.
+constexpr std::uint32_t cacheVersion = 2;
+constexpr std::uint32_t cacheSlotCount = 4096;
+constexpr std::uint64_t cacheAlignment = 64;
+// The whole file is mapped once up front so that lookups never have to remap
+// (and invalidate spans handed out earlier) as writers grow the file.
+constexpr std::size_t maxCacheFileSize = std::size_t{1} << 30;
+
+struct CacheHeader
+{
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t slotCount;
+  std::uint64_t dataEnd;
+  std::uint8_t reserved[40];
+};
+
+struct CacheSlot
+{
+  std::uint64_t die;
+  std::uint64_t faces;
+  std::uint64_t keepCount;
+  std::uint32_t keepMode;
+  std::uint32_t ready;
+  std::int64_t offset;
+  std::uint64_t dataOffset;
+  std::uint64_t length;
+  // Bit 0 marks exploding pools.
+  std::uint64_t flags;
+};
+
+static_assert(sizeof(CacheHeader) == cacheAlignment);
+static_assert(sizeof(CacheSlot) == cacheAlignment);
+
+constexpr std::uint64_t explodingSlotFlag = 1;
+
+constexpr std::uint64_t cacheDataStart =
+    sizeof(CacheHeader) + sizeof(CacheSlot) * cacheSlotCount;
+
+std::uint64_t mix_hash(std::uint64_t hash, std::uint64_t value)
+{
+  // splitmix64 finalizer over the running hash.
+  hash ^= value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+  hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebULL;
+  return hash ^ (hash >> 31);
+}
+
+std::uint64_t hash_pool(const Pool &key)
+{
+  std::uint64_t hash = 0;
+  hash = mix_hash(hash, key.die);
+  hash = mix_hash(hash, key.faces);
+  hash = mix_hash(hash, static_cast<std::uint64_t>(key.keepMode));
+  hash = mix_hash(hash, key.keepCount);
+  // Only mixed in when set, so existing cache files keep their slots.
+  if (key.explode)
+  {
+    hash = mix_hash(hash, explodingSlotFlag);
+  }
+  return hash;
+}
+
+bool slot_matches(const CacheSlot &slot, const Pool &key)
+{
+  return slot.die == key.die && slot.faces == key.faces &&
+         slot.keepMode == static_cast<std::uint32_t>(key.keepMode) &&
+         slot.keepCount == key.keepCount &&
+         (slot.flags & explodingSlotFlag) ==
+             (key.explode ? explodingSlotFlag : 0);
+}
+
+void write_fully(int fd, const void *data, std::size_t size, off_t offset)
+{
+  const auto *bytes = static_cast<const char *>(data);
+  while (size > 0)
+  {
+    ssize_t written = pwrite(fd, bytes, size, offset);
+    if (written < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      throw DiceException(std::format(
+          "Unable to write distribution cache: {}", std::strerror(errno)
+      ));
+    }
+
+    bytes += written;
+    size -= written;
+    offset += written;
+  }
+}
+
+// Holds a flock() for the lifetime of the object.
+class FileLock
+{
+private:
+  int fd;
+
+public:
+  FileLock(int f, int operation) : fd{f}
+  {
+    while (flock(fd, operation) != 0)
+    {
+      if (errno != EINTR)
+      {
+        throw DiceException(std::format(
+            "Unable to lock distribution cache: {}", std::strerror(errno)
+        ));
+      }
+    }
+  }
+  ~FileLock() { flock(fd, LOCK_UN); }
+};
+
+// Pages of the mapping past the end of the file raise SIGBUS when read, so
+// its size bounds everything read through the mapping.
+std::uint64_t cache_file_size(int fd)
+{
+  struct stat status;
+  if (fstat(fd, &status) != 0)
+  {
+    throw DiceException(std::format(
+        "Unable to read distribution cache: {}", std::strerror(errno)
+    ));
+  }
+  return static_cast<std::uint64_t>(status.st_size);
+}
+
+DistributionCache::DistributionCache(const std::string &path)
+    : fd{-1}, writable{true}, mapping{nullptr}, mappingSize{maxCacheFileSize}
+{
+  fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd < 0)
+  {
+    writable = false;
+    fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  }
+  if (fd < 0)
+  {
+    throw DiceException(std::format(
+        "Unable to open distribution cache '{}': {}",
+        path,
+        std::strerror(errno)
+    ));
+  }
+
+  try
+  {
+    FileLock lock(fd, writable ? LOCK_EX : LOCK_SH);
+
+    struct stat status;
+    if (fstat(fd, &status) != 0)
+    {
+      throw DiceException(std::format(
+          "Unable to read distribution cache '{}': {}",
+          path,
+          std::strerror(errno)
+      ));
+    }
+    if (status.st_size == 0 && writable)
+    {
+      CacheHeader header = {};
+      std::memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+      header.version = cacheVersion;
+      header.slotCount = cacheSlotCount;
+      header.dataEnd = cacheDataStart;
+
+      // ftruncate zero fills the index, which marks every slot empty.
+      if (ftruncate(fd, static_cast<off_t>(cacheDataStart)) != 0)
+      {
+        throw DiceException(std::format(
+            "Unable to create distribution cache '{}': {}",
+            path,
+            std::strerror(errno)
+        ));
+      }
+      write_fully(fd, &header, sizeof(header), 0);
+      status.st_size = static_cast<off_t>(cacheDataStart);
+    }
+
+    CacheHeader header = {};
+    bool valid =
+        static_cast<std::uint64_t>(status.st_size) >= cacheDataStart &&
+        pread(fd, &header, sizeof(header), 0) ==
+            static_cast<ssize_t>(sizeof(header)) &&
+        std::memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) == 0 &&
+        header.version == cacheVersion && header.slotCount == cacheSlotCount &&
+        header.dataEnd >= cacheDataStart &&
+        header.dataEnd <= static_cast<std::uint64_t>(status.st_size);
+    if (!valid)
+    {
+      throw DiceException(
+          std::format("Distribution cache '{}' is not valid.", path)
+      );
+    }
+  }
+  catch (...)
+  {
+    close(fd);
+    throw;
+  }
+
+  void *mapped = mmap(nullptr, mappingSize, PROT_READ, MAP_SHARED, fd, 0);
+  if (mapped == MAP_FAILED)
+  {
+    close(fd);
+    throw DiceException(std::format(
+        "Unable to map distribution cache '{}': {}",
+        path,
+        std::strerror(errno)
+    ));
+  }
+  mapping = static_cast<std::byte *>(mapped);
+}
+
+DistributionCache::~DistributionCache()
+{
+  munmap(mapping, mappingSize);
+  close(fd);
+}
+
+const CacheSlot *DistributionCache::findSlot(const Pool &key) const
+{
+  const auto *slots =
+      reinterpret_cast<const CacheSlot *>(mapping + sizeof(CacheHeader));
+
+  std::uint64_t hash = hash_pool(key);
+  for (std::uint32_t probe = 0; probe < cacheSlotCount; probe++)
+  {
+    const CacheSlot *slot = &slots[(hash + probe) % cacheSlotCount];
+    if (__atomic_load_n(&slot->ready, __ATOMIC_ACQUIRE) == 0 ||
+        slot_matches(*slot, key))
+    {
+      return slot;
+    }
+  }
+
+  return nullptr;
+}
+
+std::optional<CachedDistribution>
+DistributionCache::find(const Pool &key) const
+{
+  std::lock_guard<std::mutex> guard(fileLockMutex);
+  FileLock lock(fd, LOCK_SH);
+
+  // The file may have been truncated or damaged since it was opened, so
+  // neither the index nor a slot's data is read unless it lies within both
+  // the file and the data written so far.
+  std::uint64_t fileSize =
+      std::min<std::uint64_t>(cache_file_size(fd), mappingSize);
+  if (fileSize < cacheDataStart)
+  {
+    return std::nullopt;
+  }
+
+  const CacheSlot *slot = findSlot(key);
+  if (slot == nullptr || __atomic_load_n(&slot->ready, __ATOMIC_ACQUIRE) == 0)
+  {
+    return std::nullopt;
+  }
+
+  const auto *header = reinterpret_cast<const CacheHeader *>(mapping);
+  std::uint64_t dataEnd = std::min<std::uint64_t>(header->dataEnd, fileSize);
+  bool fits = slot->dataOffset >= cacheDataStart &&
+              slot->dataOffset % cacheAlignment == 0 &&
+              slot->dataOffset <= dataEnd &&
+              slot->length <= (dataEnd - slot->dataOffset) / sizeof(double);
+  if (!fits)
+  {
+    return std::nullopt;
+  }
+
+  return CachedDistribution{
+      .offset = slot->offset,
+      .probabilities = std::span<const double>(
+          reinterpret_cast<const double *>(mapping + slot->dataOffset),
+          slot->length
+      ),
+  };
+}
+
+void DistributionCache::insert(
+    const Pool &key,
+    const Distribution &distribution
+)
+{
+  if (!writable)
+  {
+    return;
+  }
+
+  std::lock_guard<std::mutex> guard(fileLockMutex);
+  FileLock lock(fd, LOCK_EX);
+  std::uint64_t fileSize = cache_file_size(fd);
+  if (fileSize < cacheDataStart ||
+      reinterpret_cast<const CacheHeader *>(mapping)->dataEnd > fileSize)
+  {
+    return;
+  }
+
+  // Another writer may have added this key (or filled the index) since the
+  // caller's lookup, so the probe is repeated under the lock.
+  const CacheSlot *slot = findSlot(key);
+  if (slot == nullptr || slot->ready != 0)
+  {
+    return;
+  }
+
+  const auto *header = reinterpret_cast<const CacheHeader *>(mapping);
+  std::uint64_t dataOffset =
+      (header->dataEnd + cacheAlignment - 1) / cacheAlignment * cacheAlignment;
+  std::uint64_t dataSize = distribution.probabilities.size() * sizeof(double);
+  if (dataOffset + dataSize > mappingSize)
+  {
+    return;
+  }
+
+  // Data first, then the new end of data, then the slot, and the ready flag
+  // last so that a reader which sees the flag also sees everything else.
+  write_fully(
+      fd,
+      distribution.probabilities.data(),
+      dataSize,
+      static_cast<off_t>(dataOffset)
+  );
+
+  std::uint64_t dataEnd = dataOffset + dataSize;
+  write_fully(
+      fd, &dataEnd, sizeof(dataEnd), offsetof(CacheHeader, dataEnd)
+  );
+
+  CacheSlot newSlot = {
+      .die = key.die,
+      .faces = key.faces,
+      .keepCount = key.keepCount,
+      .keepMode = static_cast<std::uint32_t>(key.keepMode),
+      .ready = 0,
+      .offset = distribution.offset,
+      .dataOffset = dataOffset,
+      .length = distribution.probabilities.size(),
+      .flags = key.explode ? explodingSlotFlag : 0,
+  };
+  off_t slotOffset = reinterpret_cast<const std::byte *>(slot) - mapping;
+  write_fully(fd, &newSlot, sizeof(newSlot), slotOffset);
+
+  std::uint32_t ready = 1;
+  write_fully(
+      fd, &ready, sizeof(ready), slotOffset + offsetof(CacheSlot, ready)
+  );
+}
+
+std::unique_ptr<DistributionCache> processDistributionCache;
+std::mutex processDistributionCacheMutex;
+
+void open_distribution_cache(const std::string &path)
+{
+  auto cache = std::make_unique<DistributionCache>(path);
+
+  std::lock_guard<std::mutex> guard(processDistributionCacheMutex);
+  processDistributionCache = std::move(cache);
+}
+
+Distribution cached_pool_distribution(
+    const Pool &key,
+    const std::function<Distribution()> &compute
+)
+{
+  DistributionCache *cache = processDistributionCache.get();
+  if (cache == nullptr)
+  {
+    return compute();
+  }
+
+  auto cached = cache->find(key);
+  if (cached.has_value())
+  {
+    // Distribution owns its probabilities, so a hit is copied out of the
+    // mapping once here rather than by each consumer.
+    return {
+        .offset = cached->offset,
+        .probabilities = std::vector<double>(
+            cached->probabilities.begin(), cached->probabilities.end()
+        ),
+    };
+  }
+
+  auto result = compute();
+  {
+    std::lock_guard<std::mutex> guard(processDistributionCacheMutex);
+    cache->insert(key, result);
+  }
+
+  return result;
+}
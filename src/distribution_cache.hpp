@@ -0,0 +1,59 @@
+#pragma once
+
+#include "distribution.hpp"
+#include "roll.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+
+// A distribution which points straight into the cache file's mapping.
+struct CachedDistribution
+{
+  long offset;
+  std::span<const double> probabilities;
+};
+
+struct CacheSlot;
+
+// On-disk cache of pool distributions. The file is a fixed header, an open
+// addressing hash index and 64 byte aligned probability arrays, so it is used
+// directly through a shared read-only mapping. Any number of processes may
+// read it while writers append under an exclusive file lock; a slot is only
+// marked ready once its data is in place.
+class DistributionCache
+{
+private:
+  int fd;
+  bool writable;
+  std::byte *mapping;
+  std::size_t mappingSize;
+  // flock() locks belong to the open file, so threads of this process
+  // take turns holding them.
+  mutable std::mutex fileLockMutex;
+
+  const CacheSlot *findSlot(const Pool &pool) const;
+
+public:
+  explicit DistributionCache(const std::string &path);
+  ~DistributionCache();
+
+  DistributionCache(const DistributionCache &) = delete;
+  DistributionCache &operator=(const DistributionCache &) = delete;
+
+  std::optional<CachedDistribution> find(const Pool &pool) const;
+  void insert(const Pool &pool, const Distribution &distribution);
+};
+
+// Opens the process wide cache used by cached_pool_distribution().
+void open_distribution_cache(const std::string &path);
+
+// Looks `pool` up in the process wide cache (if one is open), calling
+// `compute` and storing its result on a miss.
+Distribution cached_pool_distribution(
+    const Pool &pool,
+    const std::function<Distribution()> &compute
+);
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "dice_exception.hpp"
+#include "trace.hpp"
+#include <climits>
+#include <optional>
+#include <random>
+#include <span>
+
+// Bounds on the work one evaluation may do, so that untrusted expressions
+// can be evaluated safely.
+struct EvaluationLimits
+{
+  // Most dice a single roll may have.
+  unsigned long maxDicePerRoll = ULONG_MAX;
+};
+
+// Everything an evaluation reads or writes besides the expression itself.
+// Parsed and compiled expressions hold no mutable state, so one expression
+// may be evaluated by any number of threads at once, each with its own
+// context.
+struct EvaluationContext
+{
+  std::mt19937 &rng;
+  // Receives a description of each roll, if not null.
+  TraceSink *trace = nullptr;
+  EvaluationLimits limits = {};
+  // If not empty, executeMany() records the error of each sample which
+  // fails here, by index, instead of throwing. A failed sample keeps the
+  // first error it hit, and its result is meaningless.
+  std::span<std::optional<DiceErrorCode>> sampleErrors = {};
+};
@@ -0,0 +1,122 @@
+#include "expression_file.hpp"
+#include "latency.hpp"
+#include "lexer.hpp"
+#include "mapped_file.hpp"
+#include "parser.hpp"
+#include "random.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <charconv>
+#include <format>
+#include <string_view>
+#include <vector>
+
+// Chunks evaluated between writes, per pool thread.
+constexpr std::size_t chunksInFlightPerThread = 2;
+
+// Splits `text` into pieces of about `chunkSize` bytes, each ending just
+// after a newline (or at the end of the text).
+std::vector<std::string_view>
+split_line_aligned_chunks(std::string_view text, std::size_t chunkSize)
+{
+  std::vector<std::string_view> chunks;
+
+  while (!text.empty())
+  {
+    std::size_t end = text.find('\n', std::min(chunkSize, text.size()) - 1);
+    end = end == std::string_view::npos ? text.size() : end + 1;
+
+    chunks.push_back(text.substr(0, end));
+    text.remove_prefix(end);
+  }
+
+  return chunks;
+}
+
+void evaluate_expression_line(std::string_view line, std::string &output)
+{
+  LatencyTimer timer;
+
+  if (!line.empty() && line.back() == '\r')
+  {
+    line.remove_suffix(1);
+  }
+
+  auto tokens = try_tokenize(line);
+  if (!tokens.has_value())
+  {
+    output += std::format("Error: {}\n", tokens.error().message);
+    return;
+  }
+
+  auto tree = try_parse(tokens.value());
+  if (!tree.has_value())
+  {
+    output += std::format("Error: {}\n", tree.error().message);
+    return;
+  }
+
+  auto result = tree.value()->tryExecute({.rng = Random::mt});
+  if (!result.has_value())
+  {
+    output += std::format("Error: {}\n", result.error().message);
+    return;
+  }
+
+  char digits[24];
+  char *end = std::to_chars(digits, digits + sizeof(digits), *result).ptr;
+  output.append(digits, end);
+  output += '\n';
+}
+
+std::string evaluate_expression_chunk(std::string_view chunk)
+{
+  std::string output;
+
+  while (!chunk.empty())
+  {
+    std::size_t end = chunk.find('\n');
+    std::string_view line = chunk.substr(0, end);
+    evaluate_expression_line(line, output);
+
+    chunk.remove_prefix(end == std::string_view::npos ? chunk.size() : end + 1);
+  }
+
+  return output;
+}
+
+void evaluate_expression_file(
+    const std::string &path,
+    std::ostream &out,
+    std::size_t chunkSize
+)
+{
+  MappedFile file(path);
+  auto chunks = split_line_aligned_chunks(
+      file.contents(), std::max<std::size_t>(1, chunkSize)
+  );
+
+  auto &threadPool = shared_thread_pool();
+  std::size_t window = threadPool.size() * chunksInFlightPerThread;
+  std::vector<std::string> outputs(window);
+
+  // Chunks are evaluated a window at a time and written in order between
+  // windows. Pool tasks never wait on one another, since a line rolling a
+  // huge pool runs a nested parallelFor which may pick up any queued task.
+  for (std::size_t first = 0; first < chunks.size(); first += window)
+  {
+    std::size_t count = std::min(window, chunks.size() - first);
+    threadPool.parallelFor(count, [&](std::size_t i) {
+      outputs[i] = evaluate_expression_chunk(chunks[first + i]);
+    });
+
+    for (std::size_t i = 0; i < count; i++)
+    {
+      out.write(
+          outputs[i].data(), static_cast<std::streamsize>(outputs[i].size())
+      );
+    }
+  }
+
+  out.flush();
+}
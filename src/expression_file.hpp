@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+
+// Evaluates each line of the file at `path` as an expression, writing one
+// line to `out` per input line: the result, or the error for a line which
+// is not valid. The file is memory-mapped and split into line-aligned chunks
+// of about `chunkSize` bytes, which are evaluated in parallel. Output is
+// written in input order, holding at most a few chunks per thread of output
+// in memory. Each line's latency is recorded if latency recording is on.
+void evaluate_expression_file(
+    const std::string &path,
+    std::ostream &out,
+    std::size_t chunkSize = 1 << 20
+);
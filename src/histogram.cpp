@@ -0,0 +1,114 @@
+#include "histogram.hpp"
+#include <algorithm>
+#include <format>
+#include <string>
+
+constexpr std::size_t histogramBarWidth = 50;
+
+Histogram::Histogram(long mn, long mx) : min{mn}
+{
+  // Computed unsigned so that a range spanning all of `long` cannot
+  // overflow.
+  unsigned long range =
+      static_cast<unsigned long>(mx) - static_cast<unsigned long>(mn);
+  if (mx >= mn && range < maxDenseHistogramRange)
+  {
+    denseCounts.assign(range + 1, 0);
+  }
+}
+
+void Histogram::add(std::span<const long> results)
+{
+  sampleCount += results.size();
+
+  for (long result : results)
+  {
+    // The bounds are only as good as the analysis they came from, which
+    // saturates where evaluation wraps around, so results outside them are
+    // still counted.
+    unsigned long index =
+        static_cast<unsigned long>(result) - static_cast<unsigned long>(min);
+    if (index < denseCounts.size())
+    {
+      denseCounts[index]++;
+    }
+    else
+    {
+      sparseCounts[result]++;
+    }
+  }
+}
+
+unsigned long Histogram::total() const { return sampleCount; }
+
+std::vector<std::pair<long, unsigned long>> Histogram::counts() const
+{
+  std::vector<std::pair<long, unsigned long>> result;
+
+  for (std::size_t i = 0; i < denseCounts.size(); i++)
+  {
+    if (denseCounts[i] > 0)
+    {
+      result.emplace_back(min + static_cast<long>(i), denseCounts[i]);
+    }
+  }
+
+  result.insert(result.end(), sparseCounts.begin(), sparseCounts.end());
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+void print_histogram_text(std::ostream &out, const Histogram &histogram)
+{
+  auto counts = histogram.counts();
+
+  unsigned long mostFrequent = 0;
+  std::size_t resultWidth = 0;
+  std::size_t countWidth = 0;
+  for (const auto &[result, count] : counts)
+  {
+    mostFrequent = std::max(mostFrequent, count);
+    resultWidth = std::max(resultWidth, std::to_string(result).size());
+    countWidth = std::max(countWidth, std::to_string(count).size());
+  }
+
+  double total = static_cast<double>(histogram.total());
+  unsigned long cumulative = 0;
+
+  out << "\n";
+  for (const auto &[result, count] : counts)
+  {
+    cumulative += count;
+    auto bar = std::string(histogramBarWidth * count / mostFrequent, '#');
+
+    out << std::format(
+        "{:>{}}: {:>{}} {:>9.4f}% {:>9.4f}% {}\n",
+        result,
+        resultWidth,
+        count,
+        countWidth,
+        count / total * 100,
+        cumulative / total * 100,
+        bar
+    );
+  }
+}
+
+void print_histogram_csv(std::ostream &out, const Histogram &histogram)
+{
+  double total = static_cast<double>(histogram.total());
+  unsigned long cumulative = 0;
+
+  out << "result,count,percent,cumulative_percent\n";
+  for (const auto &[result, count] : histogram.counts())
+  {
+    cumulative += count;
+    out << std::format(
+        "{},{},{:.6f},{:.6f}\n",
+        result,
+        count,
+        count / total * 100,
+        cumulative / total * 100
+    );
+  }
+}
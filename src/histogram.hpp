@@ -0,0 +1,55 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <ostream>
+#include <span>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Ranges of results up to this wide are counted in a dense array.
+constexpr unsigned long maxDenseHistogramRange = 1 << 24;
+
+// Frequency of each result seen. Results are counted in an array indexed by
+// their offset from the smallest expected result when the expected range is
+// narrow enough, and in a hash map otherwise or when they fall outside it.
+class Histogram
+{
+private:
+  long min;
+  std::vector<unsigned long> denseCounts;
+  std::unordered_map<long, unsigned long> sparseCounts;
+  unsigned long sampleCount = 0;
+
+public:
+  // `min` and `max` bound the results expected to be added.
+  Histogram(long mn, long mx);
+
+  void add(std::span<const long> results);
+  unsigned long total() const;
+  // Every result seen with its count, in increasing order of result.
+  std::vector<std::pair<long, unsigned long>> counts() const;
+};
+
+// Evaluates `sample` into batches of results until `samples` of them have
+// been added to `histogram`.
+template <typename Sample>
+void fill_histogram(Histogram &histogram, unsigned long samples, Sample sample)
+{
+  constexpr unsigned long batchSize = 1 << 16;
+  std::vector<long> batch(std::min(samples, batchSize));
+
+  while (samples > 0)
+  {
+    std::span<long> results(batch.data(), std::min(samples, batchSize));
+    sample(results);
+    histogram.add(results);
+    samples -= results.size();
+  }
+}
+
+// Prints each result's count, percentage and cumulative percentage, with a
+// bar scaled to the most frequent result.
+void print_histogram_text(std::ostream &out, const Histogram &histogram);
+void print_histogram_csv(std::ostream &out, const Histogram &histogram);
@@ -48,4 +48,14 @@ public:
 
     return vec.at(peekIdx);
   }
+
+  std::optional<T> last()
+  {
+    if (vec.empty())
+    {
+      return std::nullopt;
+    }
+
+    return vec.back();
+  }
 };
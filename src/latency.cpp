@@ -0,0 +1,196 @@
+#include "latency.hpp"
+#include <bit>
+#include <cmath>
+#include <format>
+#include <memory>
+#include <vector>
+
+std::size_t LatencyHistogram::bucketIndex(std::uint64_t value)
+{
+  // Bucket `top` of magnitude `shift` holds [top << shift, (top + 1) <<
+  // shift), where the top value has exactly subBucketBits bits (or fewer for
+  // the smallest values, which are recorded exactly).
+  int width = std::bit_width(value);
+  unsigned shift = width > static_cast<int>(subBucketBits)
+                       ? static_cast<unsigned>(width) - subBucketBits
+                       : 0;
+  std::uint64_t top = value >> shift;
+  return (static_cast<std::size_t>(shift) << (subBucketBits - 1)) + top;
+}
+
+std::uint64_t LatencyHistogram::bucketUpperBound(std::size_t index)
+{
+  constexpr std::size_t halfBuckets = std::size_t{1} << (subBucketBits - 1);
+  if (index < 2 * halfBuckets)
+  {
+    return index;
+  }
+
+  unsigned shift = static_cast<unsigned>(index / halfBuckets - 1);
+  std::uint64_t top = index - shift * halfBuckets;
+  // Wraps to the largest value for the very last bucket.
+  return ((top + 1) << shift) - 1;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram &other)
+{
+  for (std::size_t i = 0; i < bucketCount; i++)
+  {
+    counts[i].fetch_add(
+        other.counts[i].load(std::memory_order_relaxed),
+        std::memory_order_relaxed
+    );
+  }
+  total.fetch_add(
+      other.total.load(std::memory_order_relaxed), std::memory_order_relaxed
+  );
+  if (other.max() > max())
+  {
+    maxValue.store(other.max(), std::memory_order_relaxed);
+  }
+}
+
+std::uint64_t LatencyHistogram::count() const
+{
+  return total.load(std::memory_order_relaxed);
+}
+
+std::uint64_t LatencyHistogram::max() const
+{
+  return maxValue.load(std::memory_order_relaxed);
+}
+
+std::uint64_t LatencyHistogram::valueAtFraction(double fraction) const
+{
+  // The total is read separately from the buckets while the owner may be
+  // recording, so the buckets are summed rather than trusted to match it.
+  std::uint64_t samples = 0;
+  for (const auto &count : counts)
+  {
+    samples += count.load(std::memory_order_relaxed);
+  }
+  if (samples == 0)
+  {
+    return 0;
+  }
+
+  auto rank = static_cast<std::uint64_t>(
+      std::ceil(fraction * static_cast<double>(samples))
+  );
+  rank = std::max<std::uint64_t>(rank, 1);
+
+  std::uint64_t seen = 0;
+  for (std::size_t i = 0; i < bucketCount; i++)
+  {
+    seen += counts[i].load(std::memory_order_relaxed);
+    if (seen >= rank)
+    {
+      return std::min(bucketUpperBound(i), max());
+    }
+  }
+
+  return max();
+}
+
+std::atomic<bool> latencyRecordingEnabled = false;
+std::mutex latencyHistogramsMutex;
+std::vector<std::unique_ptr<LatencyHistogram>> latencyHistograms;
+thread_local LatencyHistogram *threadLatencyHistogram = nullptr;
+
+void enable_latency_recording() { latencyRecordingEnabled = true; }
+
+bool latency_recording_enabled()
+{
+  return latencyRecordingEnabled.load(std::memory_order_relaxed);
+}
+
+void record_latency(std::chrono::nanoseconds latency)
+{
+  if (threadLatencyHistogram == nullptr)
+  {
+    std::lock_guard<std::mutex> guard(latencyHistogramsMutex);
+    latencyHistograms.push_back(std::make_unique<LatencyHistogram>());
+    threadLatencyHistogram = latencyHistograms.back().get();
+  }
+
+  threadLatencyHistogram->record(
+      static_cast<std::uint64_t>(std::max<std::int64_t>(0, latency.count()))
+  );
+}
+
+LatencyPercentiles latency_percentiles()
+{
+  auto merged = std::make_unique<LatencyHistogram>();
+  {
+    std::lock_guard<std::mutex> guard(latencyHistogramsMutex);
+    for (const auto &histogram : latencyHistograms)
+    {
+      merged->merge(*histogram);
+    }
+  }
+
+  return {
+      .count = merged->count(),
+      .p50 = merged->valueAtFraction(0.5),
+      .p90 = merged->valueAtFraction(0.9),
+      .p99 = merged->valueAtFraction(0.99),
+      .p999 = merged->valueAtFraction(0.999),
+      .max = merged->max(),
+  };
+}
+
+std::string format_latency(std::uint64_t nanoseconds)
+{
+  auto value = static_cast<double>(nanoseconds);
+  if (nanoseconds < 1000)
+  {
+    return std::format("{}ns", nanoseconds);
+  }
+  if (nanoseconds < 1000000)
+  {
+    return std::format("{:.1f}us", value / 1e3);
+  }
+  if (nanoseconds < 1000000000)
+  {
+    return std::format("{:.2f}ms", value / 1e6);
+  }
+
+  return std::format("{:.2f}s", value / 1e9);
+}
+
+std::string format_latency_percentiles(const LatencyPercentiles &percentiles)
+{
+  return std::format(
+      "latency: n={} p50={} p90={} p99={} p99.9={} max={}",
+      percentiles.count,
+      format_latency(percentiles.p50),
+      format_latency(percentiles.p90),
+      format_latency(percentiles.p99),
+      format_latency(percentiles.p999),
+      format_latency(percentiles.max)
+  );
+}
+
+LatencyReporter::LatencyReporter(std::ostream &o, std::chrono::milliseconds i)
+    : out{o}, interval{i}, thread{[this] { run(); }}
+{
+}
+
+LatencyReporter::~LatencyReporter()
+{
+  {
+    std::lock_guard<std::mutex> guard(mutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  thread.join();
+}
+
+void LatencyReporter::run()
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  while (!wake.wait_for(lock, interval, [this] { return stopping; }))
+  {
+    out << format_latency_percentiles(latency_percentiles()) << std::endl;
+  }
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+
+// Histogram of durations in nanoseconds with logarithmic buckets, in the
+// style of HdrHistogram. Values below 128 get a bucket each; above that
+// every power of two is split into 64 linear buckets, so any value is
+// recorded to within 1/64 of itself in a fixed array and recording never
+// allocates. One thread records while any thread may read.
+class LatencyHistogram
+{
+public:
+  static constexpr unsigned subBucketBits = 7;
+  static constexpr std::size_t bucketCount =
+      (64 - subBucketBits + 2) << (subBucketBits - 1);
+
+private:
+  std::array<std::atomic<std::uint64_t>, bucketCount> counts{};
+  std::atomic<std::uint64_t> total{0};
+  std::atomic<std::uint64_t> maxValue{0};
+
+public:
+  static std::size_t bucketIndex(std::uint64_t value);
+  // Largest value which falls in bucket `index`.
+  static std::uint64_t bucketUpperBound(std::size_t index);
+
+  // Only the owning thread may record.
+  void record(std::uint64_t value)
+  {
+    // Plain loads and stores suffice with a single writer, and are cheaper
+    // than atomic increments.
+    auto &count = counts[bucketIndex(value)];
+    count.store(
+        count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed
+    );
+    total.store(
+        total.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed
+    );
+    if (value > maxValue.load(std::memory_order_relaxed))
+    {
+      maxValue.store(value, std::memory_order_relaxed);
+    }
+  }
+
+  // Adds `other`'s samples to this histogram, which nothing else may be
+  // recording into.
+  void merge(const LatencyHistogram &other);
+
+  std::uint64_t count() const;
+  std::uint64_t max() const;
+  // Smallest recorded value (to bucket precision) which at least `fraction`
+  // of the samples do not exceed.
+  std::uint64_t valueAtFraction(double fraction) const;
+};
+
+struct LatencyPercentiles
+{
+  std::uint64_t count;
+  std::uint64_t p50;
+  std::uint64_t p90;
+  std::uint64_t p99;
+  std::uint64_t p999;
+  std::uint64_t max;
+};
+
+// Turns on record_latency(), which otherwise does nothing.
+void enable_latency_recording();
+bool latency_recording_enabled();
+
+// Records one sample in the calling thread's histogram. Each thread's
+// histogram is allocated on its first sample and kept until exit.
+void record_latency(std::chrono::nanoseconds latency);
+
+// Merges every thread's histogram recorded so far.
+LatencyPercentiles latency_percentiles();
+
+// One line such as "latency: n=1000 p50=1.2us p90=... max=...".
+std::string format_latency_percentiles(const LatencyPercentiles &percentiles);
+
+// Times its own lifetime and records it, if recording is enabled.
+class LatencyTimer
+{
+private:
+  bool enabled;
+  std::chrono::steady_clock::time_point start;
+
+public:
+  LatencyTimer() : enabled{latency_recording_enabled()}
+  {
+    if (enabled)
+    {
+      start = std::chrono::steady_clock::now();
+    }
+  }
+
+  ~LatencyTimer()
+  {
+    if (enabled)
+    {
+      record_latency(std::chrono::steady_clock::now() - start);
+    }
+  }
+
+  LatencyTimer(const LatencyTimer &) = delete;
+  LatencyTimer &operator=(const LatencyTimer &) = delete;
+};
+
+// Writes the latency percentiles so far to `out` every `interval` until it
+// is destroyed.
+class LatencyReporter
+{
+private:
+  std::ostream &out;
+  std::chrono::milliseconds interval;
+  std::mutex mutex;
+  std::condition_variable wake;
+  bool stopping = false;
+  std::thread thread;
+
+  void run();
+
+public:
+  LatencyReporter(std::ostream &o, std::chrono::milliseconds i);
+  ~LatencyReporter();
+
+  LatencyReporter(const LatencyReporter &) = delete;
+  LatencyReporter &operator=(const LatencyReporter &) = delete;
+};
@@ -1,6 +1,8 @@
 #include "lexer.hpp"
 #include "dice_exception.hpp"
 #include <format>
+#include <limits>
+#include <optional>
 
 struct TokenTypeResult
 {
@@ -32,6 +34,17 @@ TokenTypeResult determineTokenType(char c)
   case 'h':
   case 'H':
     return TokenTypeResult{true, TokenType::H};
+  case '!':
+    return TokenTypeResult{true, TokenType::Explode};
+  case 's':
+  case 'S':
+    return TokenTypeResult{true, TokenType::Successes};
+  case '>':
+    return TokenTypeResult{true, TokenType::Greater};
+  case '<':
+    return TokenTypeResult{true, TokenType::Less};
+  case '=':
+    return TokenTypeResult{true, TokenType::Equal};
   case '+':
     return TokenTypeResult{true, TokenType::Add};
   case '-':
@@ -49,61 +62,133 @@ TokenTypeResult determineTokenType(char c)
   case '\n':
     // Whitespace in an expression is valid, but not a token.
     return TokenTypeResult{false, TokenType::Unknown};
-  default:;
-    std::string msg = std::format("Unexpected character in input: '{}'", c);
-    throw DiceException(msg);
+  default:
+    // Anything else is a token, but not a valid one.
+    return TokenTypeResult{true, TokenType::Unknown};
   }
 }
 
-std::vector<Token> tokenize(std::string input)
+// The token made of the two characters of `input` starting at `i`, if they
+// form one.
+std::optional<TokenType>
+determineTwoCharacterTokenType(std::string_view input, std::size_t i)
+{
+  if (i + 1 >= input.size())
+  {
+    return std::nullopt;
+  }
+
+  if (input[i] == '>' && input[i + 1] == '=')
+  {
+    return TokenType::GreaterEqual;
+  }
+  if (input[i] == '<' && input[i + 1] == '=')
+  {
+    return TokenType::LessEqual;
+  }
+
+  return std::nullopt;
+}
+
+std::expected<std::vector<Token>, DiceError>
+try_tokenize(std::string_view input)
 {
-  std::string currentInt = "";
   std::vector<Token> results;
+  // Offset of the first digit of the integer being read, if there is one.
+  std::optional<std::size_t> integerStart;
+  unsigned long integer = 0;
 
-  for (char c : input)
+  for (std::size_t i = 0; i <= input.size(); i++)
   {
+    char c = i < input.size() ? input[i] : ' ';
     auto tokenTypeResult = determineTokenType(c);
-    if (!tokenTypeResult.matchesATokenType)
+
+    if (tokenTypeResult.tokenType == TokenType::Integer)
     {
+      if (!integerStart.has_value())
+      {
+        integerStart = i;
+        integer = 0;
+      }
+
+      unsigned long digit = c - '0';
+      if (integer > (std::numeric_limits<unsigned long>::max() - digit) / 10)
+      {
+        return std::unexpected(DiceError{
+            .code = DiceErrorCode::IntegerTooLarge,
+            .message = "Integer in input is too large.",
+            .offset = integerStart.value(),
+        });
+      }
+      integer = integer * 10 + digit;
       continue;
     }
 
-    if (tokenTypeResult.tokenType == TokenType::Integer)
+    // Whitespace is skipped without ending an integer, so "1 0" reads as
+    // 10, as it always has.
+    if (!tokenTypeResult.matchesATokenType && i < input.size())
     {
-      currentInt += c;
       continue;
     }
 
-    if (currentInt.size() > 0)
+    if (integerStart.has_value())
     {
-      unsigned long integer = std::stoul(currentInt); // TODO handle exceptions
-      currentInt = "";
-
       results.push_back(
           Token{
               .tokenType = TokenType::Integer,
               .integerValue = integer,
+              .offset = integerStart.value(),
+          }
+      );
+      integerStart.reset();
+    }
+
+    auto twoCharacterType = determineTwoCharacterTokenType(input, i);
+    if (twoCharacterType.has_value())
+    {
+      results.push_back(
+          Token{
+              .tokenType = twoCharacterType.value(),
+              .integerValue = 0,
+              .offset = i,
           }
       );
+      i++;
+      continue;
     }
 
-    results.push_back(
-        Token{
-            .tokenType = tokenTypeResult.tokenType,
-            .integerValue = 0,
-        }
-    );
+    if (tokenTypeResult.tokenType == TokenType::Unknown &&
+        tokenTypeResult.matchesATokenType)
+    {
+      return std::unexpected(DiceError{
+          .code = DiceErrorCode::UnexpectedCharacter,
+          .message = std::format("Unexpected character in input: '{}'", c),
+          .offset = i,
+      });
+    }
+
+    if (tokenTypeResult.matchesATokenType)
+    {
+      results.push_back(
+          Token{
+              .tokenType = tokenTypeResult.tokenType,
+              .integerValue = 0,
+              .offset = i,
+          }
+      );
+    }
   }
 
-  if (currentInt.length() > 0)
+  return results;
+}
+
+std::vector<Token> tokenize(std::string input)
+{
+  auto result = try_tokenize(input);
+  if (!result.has_value())
   {
-    results.push_back(
-        Token{
-            .tokenType = TokenType::Integer,
-            .integerValue = std::stoul(currentInt), // TODO handle exceptions,
-        }
-    );
+    throw DiceException(result.error());
   }
 
-  return results;
+  return std::move(result.value());
 }
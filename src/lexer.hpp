@@ -1,6 +1,10 @@
 #pragma once
 
+#include "dice_exception.hpp"
+#include <cstddef>
+#include <expected>
 #include <string>
+#include <string_view>
 #include <vector>
 
 enum class TokenType
@@ -9,6 +13,13 @@ enum class TokenType
   D,
   H,
   L,
+  Explode,
+  Successes,
+  GreaterEqual,
+  LessEqual,
+  Greater,
+  Less,
+  Equal,
   Add,
   Subtract,
   Multiply,
@@ -22,6 +33,13 @@ struct Token
 {
   TokenType tokenType;
   unsigned long integerValue;
+  // Byte offset of the token's first character in the input.
+  std::size_t offset = 0;
 };
 
+// Splits `input` into tokens, returning an error rather than throwing if it
+// contains anything which is not a token.
+std::expected<std::vector<Token>, DiceError>
+try_tokenize(std::string_view input);
+
 std::vector<Token> tokenize(std::string input);
@@ -1,32 +1,660 @@
+#include "alias_table.hpp"
+#include "allocation_stats.hpp"
+#include "catalog.hpp"
 #include "dice_exception.hpp"
+#include "distribution_cache.hpp"
+#include "expression_file.hpp"
+#include "histogram.hpp"
+#include "latency.hpp"
 #include "lexer.hpp"
+#include "mapped_file.hpp"
 #include "parser.hpp"
+#include "planner.hpp"
+#include "quantile_sketch.hpp"
+#include "random.hpp"
+#include "summary.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
 #include <format>
+#include <fstream>
+#include <functional>
 #include <iostream>
+#include <limits>
+#include <optional>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <vector>
 
-int main(int argc, char *argv[])
+bool has_flag(int argc, char *argv[], const std::string &flag)
+{
+  for (int i = 1; i < argc; i++)
+  {
+    if (flag == argv[i])
+    {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// Returns the argument following `flag`, if `flag` was given.
+std::optional<std::string>
+flag_value(int argc, char *argv[], const std::string &flag)
+{
+  for (int i = 1; i < argc; i++)
+  {
+    if (flag == argv[i])
+    {
+      if (i + 1 == argc)
+      {
+        throw DiceException(std::format("{} requires a value.", flag));
+      }
+      return argv[i + 1];
+    }
+  }
+
+  return std::nullopt;
+}
+
+std::optional<unsigned long> parse_unsigned(const std::string &value)
+{
+  bool digits = !value.empty() &&
+                std::all_of(value.begin(), value.end(), [](char c) {
+                  return c >= '0' && c <= '9';
+                });
+  if (!digits)
+  {
+    return std::nullopt;
+  }
+
+  try
+  {
+    return std::stoul(value);
+  }
+  catch (std::out_of_range &)
+  {
+    return std::nullopt;
+  }
+}
+
+unsigned long parse_sample_count(const std::string &value)
+{
+  auto count = parse_unsigned(value);
+  if (!count.has_value() || count.value() == 0)
+  {
+    throw DiceException("Histogram sample count must be a positive integer.");
+  }
+
+  return count.value();
+}
+
+// `--alias-budget <bytes>`, or the default budget.
+std::size_t alias_budget(int argc, char *argv[])
+{
+  auto value = flag_value(argc, argv, "--alias-budget");
+  if (!value.has_value())
+  {
+    return defaultAliasTableBudget;
+  }
+
+  auto budget = parse_unsigned(value.value());
+  if (!budget.has_value())
+  {
+    throw DiceException("Alias table budget must be a number of bytes.");
+  }
+
+  return budget.value();
+}
+
+// `--ranks <fraction>,...`, or a spread of ranks from 1% to 99%.
+std::vector<double> quantile_ranks(int argc, char *argv[])
+{
+  auto value = flag_value(argc, argv, "--ranks");
+  if (!value.has_value())
+  {
+    return {0, 0.01, 0.05, 0.25, 0.5, 0.75, 0.95, 0.99, 1};
+  }
+
+  std::vector<double> ranks;
+  std::string_view remaining = value.value();
+  while (true)
+  {
+    std::size_t comma = remaining.find(',');
+    std::string_view rank = remaining.substr(0, comma);
+    double fraction = -1;
+    auto [end, error] =
+        std::from_chars(rank.data(), rank.data() + rank.size(), fraction);
+    if (error != std::errc{} || end != rank.data() + rank.size() ||
+        !(fraction >= 0 && fraction <= 1))
+    {
+      throw DiceException("Quantile ranks must be numbers from 0 to 1.");
+    }
+    ranks.push_back(fraction);
+
+    if (comma == std::string_view::npos)
+    {
+      return ranks;
+    }
+    remaining.remove_prefix(comma + 1);
+  }
+}
+
+unsigned quantile_sketch_size(int argc, char *argv[])
+{
+  auto value = flag_value(argc, argv, "--sketch-size");
+  if (!value.has_value())
+  {
+    return defaultQuantileSketchSize;
+  }
+
+  auto size = parse_unsigned(value.value());
+  if (!size.has_value() || size.value() < 8 || size.value() > 65536)
+  {
+    throw DiceException("Sketch size must be between 8 and 65536.");
+  }
+
+  return static_cast<unsigned>(size.value());
+}
+
+// `--input <file>`, writing latency percentiles to stderr at exit with
+// `--latency` and every `--latency-interval <seconds>` seconds.
+void evaluate_input_file(int argc, char *argv[], const std::string &path)
+{
+  auto interval = flag_value(argc, argv, "--latency-interval");
+  bool latency = has_flag(argc, argv, "--latency") || interval.has_value();
+  if (latency)
+  {
+    enable_latency_recording();
+  }
+
+  std::optional<LatencyReporter> reporter;
+  if (interval.has_value())
+  {
+    auto seconds = parse_unsigned(interval.value());
+    if (!seconds.has_value() || seconds.value() == 0)
+    {
+      throw DiceException(
+          "Latency interval must be a positive number of seconds."
+      );
+    }
+    reporter.emplace(std::cerr, std::chrono::seconds(seconds.value()));
+  }
+
+  evaluate_expression_file(path, std::cout);
+
+  reporter.reset();
+  if (latency)
+  {
+    std::cout.flush();
+    std::cerr << format_latency_percentiles(latency_percentiles()) << "\n";
+  }
+}
+
+// `compile <source> <catalog>` compiles a file of expressions, one per line,
+// into a catalog file.
+void compile_catalog_command(int argc, char *argv[])
+{
+  if (argc != 4)
+  {
+    throw DiceException("Usage: compile <source file> <catalog file>");
+  }
+
+  MappedFile source(argv[2]);
+  std::string catalog = compile_catalog(source.contents());
+
+  std::ofstream out(argv[3], std::ios::binary | std::ios::trunc);
+  out.write(catalog.data(), static_cast<std::streamsize>(catalog.size()));
+  if (!out)
+  {
+    throw DiceException(
+        std::format("Unable to write catalog file '{}'.", argv[3])
+    );
+  }
+}
+
+// `run <catalog> <index>...` evaluates catalog entries by index, printing one
+// line per entry.
+void run_catalog_command(int argc, char *argv[])
+{
+  if (argc < 4)
+  {
+    throw DiceException("Usage: run <catalog file> <index>...");
+  }
+
+  Catalog catalog(argv[2]);
+  for (int i = 3; i < argc; i++)
+  {
+    auto index = parse_unsigned(argv[i]);
+    if (!index.has_value() || index.value() >= catalog.size())
+    {
+      throw DiceException(std::format("Catalog has no entry {}.", argv[i]));
+    }
+
+    auto result = catalog.evaluate(index.value(), {.rng = Random::mt});
+    if (result.has_value())
+    {
+      std::cout << result.value() << "\n";
+    }
+    else
+    {
+      std::cout << "Error: " << result.error().message << "\n";
+    }
+  }
+}
+
+double time_budget(int argc, char *argv[])
+{
+  auto value = flag_value(argc, argv, "--time-budget");
+  if (!value.has_value())
+  {
+    return std::numeric_limits<double>::infinity();
+  }
+
+  double seconds = 0;
+  const std::string &text = value.value();
+  auto [end, error] =
+      std::from_chars(text.data(), text.data() + text.size(), seconds);
+  if (error != std::errc{} || end != text.data() + text.size() ||
+      !(seconds > 0))
+  {
+    throw DiceException("Time budget must be a positive number of seconds.");
+  }
+
+  return seconds;
+}
+
+std::size_t memory_budget(int argc, char *argv[])
+{
+  auto value = flag_value(argc, argv, "--memory-budget");
+  if (!value.has_value())
+  {
+    return SIZE_MAX;
+  }
+
+  auto bytes = parse_unsigned(value.value());
+  if (!bytes.has_value())
+  {
+    throw DiceException("Memory budget must be a number of bytes.");
+  }
+
+  return bytes.value();
+}
+
+// Plans `samples` evaluations of `tree` within `--time-budget <seconds>` and
+// `--memory-budget <bytes>`. With `--explain` the plan is printed instead,
+// and nothing is returned so that the expression is not evaluated.
+std::optional<ExecutionPlan> plan_command(
+    int argc,
+    char *argv[],
+    const Tree &tree,
+    unsigned long samples,
+    bool traced,
+    std::size_t aliasBudget
+)
+{
+  auto plan = plan_execution(
+      tree,
+      {
+          .samples = samples,
+          .traced = traced,
+          .aliasBudget = aliasBudget,
+          .maxSeconds = time_budget(argc, argv),
+          .maxBytes = memory_budget(argc, argv),
+      }
+  );
+
+  if (has_flag(argc, argv, "--explain"))
+  {
+    std::cout << "\n" << explain_plan(plan);
+    return std::nullopt;
+  }
+
+  return plan;
+}
+
+// Fills batches of results from an alias table over the exact distribution
+// if `plan` chose one and it fits in `aliasBudget` bytes, and by evaluating
+// the tree otherwise.
+std::function<void(std::span<long>)> make_sampler(
+    const Tree &tree,
+    const ExecutionPlan &plan,
+    std::size_t aliasBudget
+)
+{
+  auto aliasTable = plan.aliasTable ? build_alias_table(tree, aliasBudget)
+                                    : std::nullopt;
+  if (aliasTable.has_value())
+  {
+    return [table = std::move(aliasTable.value())](std::span<long> results) {
+      table.sampleMany(Random::mt, results);
+    };
+  }
+
+  return [&tree](std::span<long> results) {
+    tree.executeMany({.rng = Random::mt}, results);
+  };
+}
+
+void print_histogram(
+    const Tree &tree,
+    unsigned long samples,
+    bool csv,
+    const std::function<void(std::span<long>)> &sample
+)
 {
-  std::cout << "Please enter a dice algebra expression: ";
+  auto analysis = tree.analyze();
+  Histogram histogram(analysis.min, analysis.max);
+  fill_histogram(histogram, samples, sample);
 
-  std::string userInput;
-  std::getline(std::cin, userInput);
+  if (csv)
+  {
+    print_histogram_csv(std::cout, histogram);
+  }
+  else
+  {
+    print_histogram_text(std::cout, histogram);
+  }
+}
 
+// Estimates quantiles in constant memory, however many samples are taken
+// and however widely the results range.
+void print_quantiles(
+    unsigned long samples,
+    const std::vector<double> &ranks,
+    unsigned sketchSize,
+    const std::function<void(std::span<long>)> &sample
+)
+{
+  auto sketch = sketch_samples(samples, sketchSize, sample);
+
+  std::cout << std::format(
+      "\nQuantiles of {} samples, each within {:.2f}% of its rank with 99% "
+      "confidence:\n",
+      sketch.count(),
+      quantile_rank_error(sketchSize) * 100
+  );
+  for (double rank : ranks)
+  {
+    std::cout << std::format("{:g}%: {}\n", rank * 100, sketch.quantile(rank));
+  }
+}
+
+void write_summary_file(
+    const std::string &path,
+    const SimulationSummary &summary
+)
+{
+  std::string bytes = serialize_summary(summary);
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+  if (!out)
+  {
+    throw DiceException(
+        std::format("Unable to write summary file '{}'.", path)
+    );
+  }
+}
+
+// `summarize <expression> <samples> <summary file>` simulates an expression
+// and writes a summary of the run which `merge` can combine with others.
+void summarize_command(int argc, char *argv[])
+{
+  if (argc < 5)
+  {
+    throw DiceException(
+        "Usage: summarize <expression> <samples> <summary file>"
+    );
+  }
+
+  std::string expression = argv[2];
+  auto tree = parse(tokenize(expression));
+  auto samples = parse_sample_count(argv[3]);
+  auto aliasBudget = alias_budget(argc, argv);
+  auto plan = plan_command(argc, argv, *tree, samples, false, aliasBudget);
+  if (!plan.has_value())
+  {
+    return;
+  }
+
+  auto analysis = tree->analyze();
+  Histogram histogram(analysis.min, analysis.max);
+  Moments moments;
+
+  auto sample = make_sampler(*tree, plan.value(), aliasBudget);
+  fill_histogram(
+      histogram,
+      samples,
+      [&](std::span<long> results) {
+        sample(results);
+        moments.merge(Moments::of(results));
+      }
+  );
+
+  write_summary_file(
+      argv[4], summarize_simulation(expression, histogram, moments)
+  );
+}
+
+// `merge <output file> <summary file>...` combines summaries of the same
+// expression, in any order, into one.
+void merge_command(int argc, char *argv[])
+{
+  if (argc < 4)
+  {
+    throw DiceException("Usage: merge <output file> <summary file>...");
+  }
+
+  std::optional<SimulationSummary> merged;
+  for (int i = 3; i < argc; i++)
+  {
+    MappedFile file(argv[i]);
+    SimulationSummary summary;
+    try
+    {
+      summary = deserialize_summary(file.contents());
+    }
+    catch (DiceException &)
+    {
+      throw DiceException(
+          std::format("'{}' is not a valid summary file.", argv[i])
+      );
+    }
+
+    merged = merged.has_value() ? merge_summaries(merged.value(), summary)
+                                : std::move(summary);
+  }
+
+  write_summary_file(argv[2], merged.value());
+}
+
+void print_distribution(const Distribution &distribution)
+{
+  std::cout << "\n";
+  for (std::size_t i = 0; i < distribution.probabilities.size(); i++)
+  {
+    double probability = distribution.probabilities.at(i);
+    if (probability == 0)
+    {
+      continue;
+    }
+
+    std::cout << std::format(
+        "{}: {:.6f}%\n",
+        distribution.offset + static_cast<long>(i),
+        probability * 100
+    );
+  }
+}
+
+// Prints the exact chance that an expression is true, which is the chance of
+// every non-zero result. For a comparison that is the chance that it holds.
+void print_probability(const Distribution &distribution)
+{
+  double probability = 0;
+  for (std::size_t i = 0; i < distribution.probabilities.size(); i++)
+  {
+    if (distribution.offset + static_cast<long>(i) != 0)
+    {
+      probability += distribution.probabilities[i];
+    }
+  }
+
+  std::cout << std::format("\nProbability: {:.6f}%\n", probability * 100);
+}
+
+// Writes the allocations of each phase to standard error when it goes out
+// of scope, if `enabled`, for --stats.
+struct AllocationStatsReport
+{
+  bool enabled;
+
+  ~AllocationStatsReport()
+  {
+    if (enabled)
+    {
+      std::cerr << format_allocation_stats() << std::endl;
+    }
+  }
+};
+
+int main(int argc, char *argv[])
+{
   try
   {
-    auto tokens = tokenize(userInput);
-    auto abstractSyntaxTree = parse(tokens);
-    auto result = abstractSyntaxTree->execute();
+    const char *cachePath = std::getenv("DICE_DISTRIBUTION_CACHE");
+    if (cachePath != nullptr)
+    {
+      open_distribution_cache(cachePath);
+    }
+
+    std::string command = argc > 1 ? argv[1] : "";
+    if (command == "compile")
+    {
+      compile_catalog_command(argc, argv);
+      return 0;
+    }
+    if (command == "run")
+    {
+      run_catalog_command(argc, argv);
+      return 0;
+    }
+    if (command == "summarize")
+    {
+      summarize_command(argc, argv);
+      return 0;
+    }
+    if (command == "merge")
+    {
+      merge_command(argc, argv);
+      return 0;
+    }
+
+    auto inputPath = flag_value(argc, argv, "--input");
+    if (inputPath.has_value())
+    {
+      std::ios::sync_with_stdio(false);
+      evaluate_input_file(argc, argv, inputPath.value());
+      return 0;
+    }
+
+    bool stats = has_flag(argc, argv, "--stats");
+    if (stats && !allocation_stats_enabled())
+    {
+      throw DiceException(
+          "--stats needs a build configured with -DDICE_ALLOCATION_STATS=ON."
+      );
+    }
+
+    std::cout << "Please enter a dice algebra expression: ";
+
+    std::string userInput;
+    std::getline(std::cin, userInput);
+
+    AllocationStatsReport report{.enabled = stats};
+    auto tokens = in_allocation_phase(AllocationPhase::Lex, [&] {
+      return tokenize(userInput);
+    });
+    auto abstractSyntaxTree = in_allocation_phase(AllocationPhase::Parse, [&] {
+      return parse(tokens);
+    });
+    // Everything from here on, including planning and sampling, is part of
+    // executing the expression.
+    AllocationPhaseScope executing(AllocationPhase::Execute);
 
-    bool verbose = argc > 1 && std::string(argv[1]) == "--v";
+    if (has_flag(argc, argv, "--distribution"))
+    {
+      print_distribution(abstractSyntaxTree->distribution());
+      return 0;
+    }
+    if (has_flag(argc, argv, "--probability"))
+    {
+      print_probability(abstractSyntaxTree->distribution());
+      return 0;
+    }
+
+    auto histogramSamples = flag_value(argc, argv, "--histogram");
+    auto quantileSamples = flag_value(argc, argv, "--quantiles");
+    if (histogramSamples.has_value() || quantileSamples.has_value())
+    {
+      auto samples = parse_sample_count(
+          histogramSamples.has_value() ? histogramSamples.value()
+                                       : quantileSamples.value()
+      );
+      auto aliasBudget = alias_budget(argc, argv);
+      auto plan = plan_command(
+          argc, argv, *abstractSyntaxTree, samples, false, aliasBudget
+      );
+      if (!plan.has_value())
+      {
+        return 0;
+      }
+
+      auto sample =
+          make_sampler(*abstractSyntaxTree, plan.value(), aliasBudget);
+      if (histogramSamples.has_value())
+      {
+        print_histogram(
+            *abstractSyntaxTree,
+            samples,
+            has_flag(argc, argv, "--csv"),
+            sample
+        );
+      }
+      else
+      {
+        print_quantiles(
+            samples,
+            quantile_ranks(argc, argv),
+            quantile_sketch_size(argc, argv),
+            sample
+        );
+      }
+      return 0;
+    }
+
+    bool verbose = has_flag(argc, argv, "--v");
+    if (!plan_command(argc, argv, *abstractSyntaxTree, 1, verbose, 0))
+    {
+      return 0;
+    }
+
+    long result = 0;
+    EvaluationContext context = {.rng = Random::mt};
     if (verbose)
     {
-      std::cout << result.description;
+      StreamTraceSink trace(std::cout);
+      context.trace = &trace;
+      result = abstractSyntaxTree->execute(context);
+    }
+    else
+    {
+      result = abstractSyntaxTree->execute(context);
     }
 
-    std::cout << std::format("\nYour result is: {}", result.result)
-              << std::endl;
+    std::cout << std::format("\nYour result is: {}", result) << std::endl;
   }
   catch (DiceException &e)
   {
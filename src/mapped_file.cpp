@@ -0,0 +1,57 @@
+#include "mapped_file.hpp"
+#include "dice_exception.hpp"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <format>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const std::string &path)
+{
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+  {
+    throw DiceException(std::format(
+        "Unable to open file '{}': {}", path, std::strerror(errno)
+    ));
+  }
+
+  struct stat status;
+  if (fstat(fd, &status) != 0)
+  {
+    close(fd);
+    throw DiceException(std::format(
+        "Unable to open file '{}': {}", path, std::strerror(errno)
+    ));
+  }
+
+  size = static_cast<std::size_t>(status.st_size);
+  if (size > 0)
+  {
+    void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped == MAP_FAILED)
+    {
+      close(fd);
+      throw DiceException(std::format(
+          "Unable to map file '{}': {}", path, std::strerror(errno)
+      ));
+    }
+    madvise(mapped, size, MADV_SEQUENTIAL);
+    data = static_cast<const char *>(mapped);
+  }
+
+  // The mapping stays valid once the descriptor is closed.
+  close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+  if (data != nullptr)
+  {
+    munmap(const_cast<char *>(data), size);
+  }
+}
+
+std::string_view MappedFile::contents() const { return {data, size}; }
@@ -1,13 +1,38 @@
 #include "parser.hpp"
 #include "dice_exception.hpp"
+#include "distribution_cache.hpp"
 #include "iterator.hpp"
 #include "random.hpp"
+#include "roll.hpp"
 #include <algorithm>
 #include <chrono>
+#include <climits>
 #include <format>
 #include <random>
 #include <string>
 
+long Tree::execute(const EvaluationContext &context) const
+{
+  auto result = tryExecute(context);
+  if (!result.has_value())
+  {
+    throw DiceException(result.error());
+  }
+
+  return result.value();
+}
+
+TreeExecutionResult Tree::execute() const
+{
+  StringTraceSink trace;
+  long result = execute({.rng = Random::mt, .trace = &trace});
+
+  return {
+      .result = result,
+      .description = trace.str(),
+  };
+}
+
 enum class MathOperation
 {
   Add,
@@ -16,164 +41,905 @@ enum class MathOperation
   Divide
 };
 
-struct MathTreeNodeArgs
+std::expected<long, DiceError> apply_math_operation(
+    MathOperation operation,
+    long left,
+    long right,
+    std::size_t offset
+)
+{
+  switch (operation)
+  {
+  case MathOperation::Add:
+    return left + right;
+
+  case MathOperation::Subtract:
+    return left - right;
+
+  case MathOperation::Multiply:
+    return left * right;
+
+  case MathOperation::Divide:
+    if (right == 0)
+    {
+      return std::unexpected(DiceError{
+          .code = DiceErrorCode::DivisionByZero,
+          .message = "Division by zero is not allowed.",
+          .offset = offset,
+      });
+    }
+    return left / right;
+  }
+
+  throw std::logic_error("Unhandled math operation.");
+}
+
+// Fails sample `i` of `results` with `code`, for a context which collects
+// sample errors. A sample which already failed keeps its first error.
+void record_sample_error(
+    const EvaluationContext &context,
+    std::span<long> results,
+    std::size_t i,
+    DiceErrorCode code
+)
+{
+  if (!context.sampleErrors[i].has_value())
+  {
+    context.sampleErrors[i] = code;
+  }
+  results[i] = 0;
+}
+
+// Fails every sample of `results` with `error`: recorded per sample if the
+// context collects sample errors, and thrown otherwise.
+void fail_all_samples(
+    const EvaluationContext &context,
+    std::span<long> results,
+    const DiceError &error
+)
+{
+  if (context.sampleErrors.empty())
+  {
+    throw DiceException(error);
+  }
+
+  for (std::size_t i = 0; i < results.size(); i++)
+  {
+    record_sample_error(context, results, i, error.code);
+  }
+}
+
+void apply_math_operation_many(
+    const EvaluationContext &context,
+    MathOperation operation,
+    std::span<long> results,
+    std::span<const long> right,
+    std::size_t offset
+)
+{
+  switch (operation)
+  {
+  case MathOperation::Add:
+    for (std::size_t i = 0; i < results.size(); i++)
+    {
+      results[i] += right[i];
+    }
+    break;
+
+  case MathOperation::Subtract:
+    for (std::size_t i = 0; i < results.size(); i++)
+    {
+      results[i] -= right[i];
+    }
+    break;
+
+  case MathOperation::Multiply:
+    for (std::size_t i = 0; i < results.size(); i++)
+    {
+      results[i] *= right[i];
+    }
+    break;
+
+  case MathOperation::Divide:
+    if (context.sampleErrors.empty() &&
+        std::find(right.begin(), right.end(), 0) != right.end())
+    {
+      throw DiceException(DiceError{
+          .code = DiceErrorCode::DivisionByZero,
+          .message = "Division by zero is not allowed.",
+          .offset = offset,
+      });
+    }
+    for (std::size_t i = 0; i < results.size(); i++)
+    {
+      if (right[i] == 0)
+      {
+        record_sample_error(
+            context, results, i, DiceErrorCode::DivisionByZero
+        );
+        continue;
+      }
+      results[i] /= right[i];
+    }
+    break;
+  }
+}
+
+TreeAnalysis analyze_math_operation(
+    MathOperation operation,
+    const TreeAnalysis &left,
+    const TreeAnalysis &right
+)
+{
+  switch (operation)
+  {
+  case MathOperation::Add:
+    return analyze_sum(left, right);
+  case MathOperation::Subtract:
+    return analyze_difference(left, right);
+  case MathOperation::Multiply:
+    return analyze_product(left, right);
+  case MathOperation::Divide:
+    return analyze_quotient(left, right);
+  }
+
+  throw std::logic_error("Unhandled math operation.");
+}
+
+Distribution math_operation_distribution(
+    MathOperation operation,
+    const Distribution &left,
+    const Distribution &right
+)
+{
+  switch (operation)
+  {
+  case MathOperation::Add:
+    return sum_distribution(left, right);
+  case MathOperation::Subtract:
+    return difference_distribution(left, right);
+  case MathOperation::Multiply:
+    return product_distribution(left, right);
+  case MathOperation::Divide:
+    return quotient_distribution(left, right);
+  }
+
+  throw std::logic_error("Unhandled math operation.");
+}
+
+char math_operation_symbol(MathOperation operation)
+{
+  switch (operation)
+  {
+  case MathOperation::Add:
+    return '+';
+  case MathOperation::Subtract:
+    return '-';
+  case MathOperation::Multiply:
+    return '*';
+  case MathOperation::Divide:
+    return '/';
+  }
+
+  throw std::logic_error("Unhandled math operation.");
+}
+
+CompiledNodeKind compiled_math_operation(MathOperation operation)
+{
+  switch (operation)
+  {
+  case MathOperation::Add:
+    return CompiledNodeKind::Add;
+  case MathOperation::Subtract:
+    return CompiledNodeKind::Subtract;
+  case MathOperation::Multiply:
+    return CompiledNodeKind::Multiply;
+  case MathOperation::Divide:
+    return CompiledNodeKind::Divide;
+  }
+
+  throw std::logic_error("Unhandled math operation.");
+}
+
+struct MathOperand
 {
-  std::unique_ptr<Tree> leftOperand;
-  std::unique_ptr<Tree> rightOperand;
   MathOperation operation;
+  std::unique_ptr<Tree> operand;
+  // Byte offset of the operator in the input.
+  std::size_t offset;
+};
+
+struct MathTreeNodeArgs
+{
+  std::unique_ptr<Tree> firstOperand;
+  std::vector<MathOperand> operands;
 };
 
+// A left associative chain of operations of the same precedence, such as
+// `a + b - c`. Holding the whole chain in one node (rather than one node per
+// operator) keeps the tree's depth bounded by the parenthesis depth, so long
+// expressions can be executed and destroyed without deep recursion.
 class MathTreeNode : public Tree
 {
 private:
-  std::unique_ptr<Tree> leftOperand;
-  std::unique_ptr<Tree> rightOperand;
-  MathOperation operation;
+  std::unique_ptr<Tree> firstOperand;
+  std::vector<MathOperand> operands;
 
 public:
   MathTreeNode(MathTreeNodeArgs args)
-      : leftOperand{std::move(args.leftOperand)},
-        rightOperand{std::move(args.rightOperand)},
-        operation{args.operation}
+      : firstOperand{std::move(args.firstOperand)},
+        operands{std::move(args.operands)}
   {
   }
 
-  TreeExecutionResult execute()
+  std::expected<long, DiceError>
+  tryExecute(const EvaluationContext &context) const
   {
-    auto leftResult = leftOperand->execute();
-    auto rightResult = rightOperand->execute();
+    auto result = firstOperand->tryExecute(context);
 
-    long result = 0;
+    for (const auto &[operation, operand, offset] : operands)
+    {
+      if (!result.has_value())
+      {
+        break;
+      }
+
+      auto right = operand->tryExecute(context);
+      if (!right.has_value())
+      {
+        return right;
+      }
+
+      result = apply_math_operation(
+          operation, result.value(), right.value(), offset
+      );
+    }
+
+    return result;
+  }
+
+  void executeMany(
+      const EvaluationContext &context,
+      std::span<long> results
+  ) const
+  {
+    firstOperand->executeMany(context, results);
 
-    switch (operation)
+    std::vector<long> right(results.size());
+    for (const auto &[operation, operand, offset] : operands)
     {
-    case MathOperation::Add:
-      result = leftResult.result + rightResult.result;
-      break;
+      operand->executeMany(context, right);
+      apply_math_operation_many(context, operation, results, right, offset);
+    }
+  }
 
-    case MathOperation::Subtract:
-      result = leftResult.result - rightResult.result;
-      break;
+  TreeAnalysis analyze() const
+  {
+    auto result = firstOperand->analyze();
 
-    case MathOperation::Multiply:
-      result = leftResult.result * rightResult.result;
-      break;
+    for (const auto &next : operands)
+    {
+      result = analyze_math_operation(
+          next.operation, result, next.operand->analyze()
+      );
+    }
+
+    return result;
+  }
+
+  Distribution distribution() const
+  {
+    auto result = firstOperand->distribution();
+
+    for (const auto &next : operands)
+    {
+      result = math_operation_distribution(
+          next.operation, result, next.operand->distribution()
+      );
+    }
+
+    return result;
+  }
+
+  void plan(std::vector<PlanStep> &steps, unsigned depth, bool traced) const
+  {
+    std::string chain;
+    for (const auto &next : operands)
+    {
+      chain += chain.empty() ? "" : ", ";
+      chain += math_operation_symbol(next.operation);
+    }
+    steps.push_back({
+        .depth = depth,
+        .node = std::format("math ({})", chain),
+        .strategy = "arithmetic",
+        .nanoseconds = static_cast<double>(operands.size()),
+        .bytes = 0,
+    });
+
+    firstOperand->plan(steps, depth + 1, traced);
+    for (const auto &next : operands)
+    {
+      next.operand->plan(steps, depth + 1, traced);
+    }
+  }
+
+  void compile(std::vector<CompiledNode> &program) const
+  {
+    firstOperand->compile(program);
+
+    for (const auto &next : operands)
+    {
+      next.operand->compile(program);
+      program.push_back({
+          .kind = compiled_math_operation(next.operation),
+          .keepMode = KeepMode::None,
+          .value = 0,
+          .faces = 0,
+          .keepCount = 0,
+          .offset = next.offset,
+      });
+    }
+  }
+};
+
+enum class Comparison
+{
+  GreaterEqual,
+  LessEqual,
+  Greater,
+  Less,
+  Equal
+};
+
+// The range of `left - right` for which `left` compares to `right` as
+// `comparison` asks.
+struct DifferenceRange
+{
+  long low;
+  long high;
+};
+
+DifferenceRange comparison_range(Comparison comparison)
+{
+  switch (comparison)
+  {
+  case Comparison::GreaterEqual:
+    return {.low = 0, .high = LONG_MAX};
+  case Comparison::LessEqual:
+    return {.low = LONG_MIN, .high = 0};
+  case Comparison::Greater:
+    return {.low = 1, .high = LONG_MAX};
+  case Comparison::Less:
+    return {.low = LONG_MIN, .high = -1};
+  case Comparison::Equal:
+    return {.low = 0, .high = 0};
+  }
+
+  throw std::logic_error("Unhandled comparison.");
+}
+
+bool compare(Comparison comparison, long left, long right)
+{
+  switch (comparison)
+  {
+  case Comparison::GreaterEqual:
+    return left >= right;
+  case Comparison::LessEqual:
+    return left <= right;
+  case Comparison::Greater:
+    return left > right;
+  case Comparison::Less:
+    return left < right;
+  case Comparison::Equal:
+    return left == right;
+  }
+
+  throw std::logic_error("Unhandled comparison.");
+}
+
+std::string_view comparison_symbol(Comparison comparison)
+{
+  switch (comparison)
+  {
+  case Comparison::GreaterEqual:
+    return ">=";
+  case Comparison::LessEqual:
+    return "<=";
+  case Comparison::Greater:
+    return ">";
+  case Comparison::Less:
+    return "<";
+  case Comparison::Equal:
+    return "=";
+  }
+
+  throw std::logic_error("Unhandled comparison.");
+}
+
+CompiledNodeKind compiled_comparison(Comparison comparison)
+{
+  switch (comparison)
+  {
+  case Comparison::GreaterEqual:
+    return CompiledNodeKind::GreaterEqual;
+  case Comparison::LessEqual:
+    return CompiledNodeKind::LessEqual;
+  case Comparison::Greater:
+    return CompiledNodeKind::Greater;
+  case Comparison::Less:
+    return CompiledNodeKind::Less;
+  case Comparison::Equal:
+    return CompiledNodeKind::Equal;
+  }
+
+  throw std::logic_error("Unhandled comparison.");
+}
+
+struct ComparisonTreeNodeArgs
+{
+  std::unique_ptr<Tree> left;
+  std::unique_ptr<Tree> right;
+  Comparison comparison;
+};
+
+// Compares two expressions, evaluating to 1 when the comparison holds and 0
+// when it does not. Its distribution is exact, so the chance of a comparison
+// holding can be found without sampling it.
+class ComparisonTreeNode : public Tree
+{
+private:
+  std::unique_ptr<Tree> left;
+  std::unique_ptr<Tree> right;
+  Comparison comparison;
+
+public:
+  ComparisonTreeNode(ComparisonTreeNodeArgs args)
+      : left{std::move(args.left)}, right{std::move(args.right)},
+        comparison{args.comparison}
+  {
+  }
+
+  std::expected<long, DiceError>
+  tryExecute(const EvaluationContext &context) const
+  {
+    auto leftResult = left->tryExecute(context);
+    if (!leftResult.has_value())
+    {
+      return leftResult;
+    }
+
+    auto rightResult = right->tryExecute(context);
+    if (!rightResult.has_value())
+    {
+      return rightResult;
+    }
+
+    return compare(comparison, leftResult.value(), rightResult.value()) ? 1
+                                                                        : 0;
+  }
+
+  void executeMany(
+      const EvaluationContext &context,
+      std::span<long> results
+  ) const
+  {
+    left->executeMany(context, results);
+
+    std::vector<long> rightResults(results.size());
+    right->executeMany(context, rightResults);
+    for (std::size_t i = 0; i < results.size(); i++)
+    {
+      results[i] = compare(comparison, results[i], rightResults[i]) ? 1 : 0;
+    }
+  }
+
+  TreeAnalysis analyze() const
+  {
+    auto range = comparison_range(comparison);
+    return analyze_difference_within(
+        left->analyze(), right->analyze(), range.low, range.high
+    );
+  }
+
+  Distribution distribution() const
+  {
+    auto range = comparison_range(comparison);
+    return difference_within_distribution(
+        left->distribution(), right->distribution(), range.low, range.high
+    );
+  }
+
+  void plan(std::vector<PlanStep> &steps, unsigned depth, bool traced) const
+  {
+    steps.push_back({
+        .depth = depth,
+        .node = std::format("compare ({})", comparison_symbol(comparison)),
+        .strategy = "comparison",
+        .nanoseconds = 1,
+        .bytes = 0,
+    });
+
+    left->plan(steps, depth + 1, traced);
+    right->plan(steps, depth + 1, traced);
+  }
+
+  void compile(std::vector<CompiledNode> &program) const
+  {
+    left->compile(program);
+    right->compile(program);
+    program.push_back({
+        .kind = compiled_comparison(comparison),
+        .keepMode = KeepMode::None,
+        .value = 0,
+        .faces = 0,
+        .keepCount = 0,
+        .offset = 0,
+    });
+  }
+};
+
+struct LongRollTreeNodeArgs
+{
+  unsigned long die;
+  unsigned long faces;
+  std::optional<unsigned long> high;
+  std::optional<unsigned long> low;
+  bool explode = false;
+  // Counts the dice at or above this, rather than summing them, if non-zero.
+  unsigned long target = 0;
+  // Byte offset of the roll in the input.
+  std::size_t offset = 0;
+};
+
+class LongRollTreeNode : public Tree
+{
+private:
+  unsigned long die;
+  unsigned long faces;
+  std::optional<unsigned long> high;
+  std::optional<unsigned long> low;
+  bool explode;
+  unsigned long target;
+  std::size_t offset;
+
+  Pool pool() const
+  {
+    if (low.has_value())
+    {
+      return {die, faces, KeepMode::Lowest, low.value(), explode};
+    }
+    if (high.has_value())
+    {
+      return {die, faces, KeepMode::Highest, high.value(), explode};
+    }
+
+    return {die, faces, KeepMode::None, 0, explode, target};
+  }
+
+  Distribution explodingDistribution() const
+  {
+    if (low.has_value())
+    {
+      return keep_pool_distribution(
+          exploding_distribution(faces), die, low.value(), false
+      );
+    }
+    if (high.has_value())
+    {
+      return keep_pool_distribution(
+          exploding_distribution(faces), die, high.value(), true
+      );
+    }
+
+    return exploding_pool_distribution(die, faces);
+  }
+
+public:
+  LongRollTreeNode(LongRollTreeNodeArgs args)
+      : die{args.die}, faces{args.faces}, high{args.high}, low{args.low},
+        explode{args.explode}, target{args.target}, offset{args.offset}
+  {
+  }
+
+  DiceError tooManyDice() const
+  {
+    return {
+        .code = DiceErrorCode::TooManyDice,
+        .message = std::format(
+            "Cannot roll {} {} at once.", die, die == 1 ? "die" : "dice"
+        ),
+        .offset = offset,
+    };
+  }
+
+  // The source form of the roll, as written in the trace.
+  std::string describe() const
+  {
+    std::string description = std::format("{}d{}", die, faces);
+    if (explode)
+    {
+      description += "!";
+    }
+    if (target != 0)
+    {
+      description += std::format("s>={}", target);
+    }
+    return description;
+  }
+
+  std::expected<long, DiceError>
+  tryExecute(const EvaluationContext &context) const
+  {
+    if (die > context.limits.maxDicePerRoll)
+    {
+      return std::unexpected(tooManyDice());
+    }
+
+    TraceSink *trace = context.trace;
+    if (trace != nullptr)
+    {
+      trace->write(std::format("\nRolling {}...\n", describe()));
+    }
+
+    if (faces < 1 || die < 1)
+    {
+      if (trace != nullptr)
+      {
+        trace->write("You rolled: 0\n");
+      }
+      return 0;
+    }
+
+    return roll_pool(pool(), context.rng, trace);
+  }
+
+  void executeMany(
+      const EvaluationContext &context,
+      std::span<long> results
+  ) const
+  {
+    if (die > context.limits.maxDicePerRoll)
+    {
+      fail_all_samples(context, results, tooManyDice());
+      return;
+    }
+
+    if (faces < 1 || die < 1)
+    {
+      std::fill(results.begin(), results.end(), 0);
+      return;
+    }
+
+    roll_pool_many(pool(), context.rng, results);
+  }
+
+  TreeAnalysis analyze() const
+  {
+    if (target != 0 && faces >= 1)
+    {
+      return analyze_success_count(die, success_probability(pool()));
+    }
+    if (explode && low.has_value())
+    {
+      return analyze_exploding_keep_pool(die, faces, low.value(), false);
+    }
+    if (explode && high.has_value())
+    {
+      return analyze_exploding_keep_pool(die, faces, high.value(), true);
+    }
+    if (explode)
+    {
+      return analyze_exploding_pool(die, faces);
+    }
+    if (low.has_value())
+    {
+      return analyze_keep_pool(die, faces, low.value(), false);
+    }
+    if (high.has_value())
+    {
+      return analyze_keep_pool(die, faces, high.value(), true);
+    }
+
+    return analyze_uniform_pool(die, faces);
+  }
+
+  Distribution distribution() const
+  {
+    // Success counts are binomial, which is cheap enough not to cache.
+    if (target != 0 && faces >= 1)
+    {
+      return success_count_distribution(die, success_probability(pool()));
+    }
+    if (explode)
+    {
+      return cached_pool_distribution(pool(), [this] {
+        return explodingDistribution();
+      });
+    }
+    if (low.has_value())
+    {
+      return cached_pool_distribution(
+          {die, faces, KeepMode::Lowest, low.value()},
+          [this] {
+            return keep_pool_distribution(die, faces, low.value(), false);
+          }
+      );
+    }
+    if (high.has_value())
+    {
+      return cached_pool_distribution(
+          {die, faces, KeepMode::Highest, high.value()},
+          [this] {
+            return keep_pool_distribution(die, faces, high.value(), true);
+          }
+      );
+    }
+
+    return cached_pool_distribution({die, faces, KeepMode::None, 0}, [this] {
+      return uniform_pool_distribution(die, faces);
+    });
+  }
+
+  void plan(std::vector<PlanStep> &steps, unsigned depth, bool traced) const
+  {
+    std::string node = describe();
+    if (high.has_value())
+    {
+      node += std::format("h{}", high.value());
+    }
+    if (low.has_value())
+    {
+      node += std::format("l{}", low.value());
+    }
 
-    case MathOperation::Divide:
-      if (rightResult.result == 0)
-      {
-        throw DiceException("Division by zero is not allowed.");
-      }
-      result = leftResult.result / rightResult.result;
-      break;
+    if (faces < 1 || die < 1)
+    {
+      steps.push_back({
+          .depth = depth,
+          .node = node,
+          .strategy = "constant",
+          .nanoseconds = 0,
+          .bytes = 0,
+      });
+      return;
     }
 
-    return {
-        .result = result,
-        .description = leftResult.description + rightResult.description,
-    };
+    auto roll = plan_roll(pool(), traced);
+    steps.push_back({
+        .depth = depth,
+        .node = node,
+        .strategy = std::string(roll_strategy_name(roll.strategy)),
+        .nanoseconds = roll.nanoseconds,
+        .bytes = roll.bytes,
+    });
   }
-};
 
-struct LongRollTreeNodeArgs
-{
-  unsigned long die;
-  unsigned long faces;
-  std::optional<unsigned long> high;
-  std::optional<unsigned long> low;
+  void compile(std::vector<CompiledNode> &program) const
+  {
+    Pool p = pool();
+    if (target != 0)
+    {
+      program.push_back({
+          .kind = explode ? CompiledNodeKind::ExplodingSuccessCount
+                          : CompiledNodeKind::SuccessCount,
+          .keepMode = KeepMode::None,
+          .value = p.die,
+          .faces = p.faces,
+          .keepCount = p.target,
+          .offset = offset,
+      });
+      return;
+    }
+
+    program.push_back({
+        .kind = explode ? CompiledNodeKind::ExplodingLongRoll
+                        : CompiledNodeKind::LongRoll,
+        .keepMode = p.keepMode,
+        .value = p.die,
+        .faces = p.faces,
+        .keepCount = p.keepCount,
+        .offset = offset,
+    });
+  }
 };
 
-class LongRollTreeNode : public Tree
+class ShortRollTreeNode : public Tree
 {
 private:
-  unsigned long die;
   unsigned long faces;
-  std::optional<unsigned long> high;
-  std::optional<unsigned long> low;
+  // Byte offset of the roll in the input.
+  std::size_t offset;
 
 public:
-  LongRollTreeNode(LongRollTreeNodeArgs args)
-      : die{args.die}, faces{args.faces}, high{args.high}, low{args.low}
+  ShortRollTreeNode(unsigned long f, std::size_t o) : faces{f}, offset{o} {}
+
+  // A short roll is one die, so it is subject to the same limit as 1dN.
+  DiceError tooManyDice() const
   {
+    return {
+        .code = DiceErrorCode::TooManyDice,
+        .message = "Cannot roll 1 die at once.",
+        .offset = offset,
+    };
   }
 
-  TreeExecutionResult execute()
+  std::expected<long, DiceError>
+  tryExecute(const EvaluationContext &context) const
   {
-    if (faces < 1 || die < 1)
+    if (context.limits.maxDicePerRoll < 1)
     {
-      return {
-          .result = 0,
-          .description = std::format(
-              "\nRolling {}d{}...\nYou rolled: {}\n", die, faces, 0
-          ),
-      };
+      return std::unexpected(tooManyDice());
     }
 
-    std::vector<long> rolls;
-    std::string description = std::format("\nRolling {}d{}...\n", die, faces);
+    long result = 0;
+    if (faces >= 1)
+    {
+      std::uniform_int_distribution<unsigned long> distribution(1, faces);
+      result = static_cast<long>(distribution(context.rng));
+    }
 
-    long sum = 0;
-    for (unsigned int i = 0; i < die; i++)
+    if (context.trace != nullptr)
     {
-      long roll = Random::get(1, faces);
-      description += std::format("You rolled: {}\n", roll);
-      rolls.push_back(roll);
-      sum += roll;
+      context.trace->write(
+          std::format("\nRolling d{}...\nYou rolled: {}\n", faces, result)
+      );
     }
 
-    if (low.has_value() && low.value() < rolls.size())
+    return result;
+  }
+
+  void executeMany(
+      const EvaluationContext &context,
+      std::span<long> results
+  ) const
+  {
+    if (context.limits.maxDicePerRoll < 1)
     {
-      sum = 0;
-      std::sort(rolls.begin(), rolls.end());
-      for (unsigned int i = 0; i < low.value(); i++)
-      {
-        sum += rolls.at(i);
-      }
+      fail_all_samples(context, results, tooManyDice());
+      return;
     }
-    else if (high.has_value() && high.value() < rolls.size())
+
+    if (faces < 1)
     {
-      sum = 0;
-      std::sort(rolls.begin(), rolls.end(), std::greater<long>());
-      for (unsigned int i = 0; i < high.value(); i++)
-      {
-        sum += rolls.at(i);
-      }
+      std::fill(results.begin(), results.end(), 0);
+      return;
     }
 
-    return {
-        .result = sum,
-        .description = description,
-    };
+    std::uniform_int_distribution<unsigned long> distribution(1, faces);
+    for (long &result : results)
+    {
+      result = static_cast<long>(distribution(context.rng));
+    }
   }
-};
-
-class ShortRollTreeNode : public Tree
-{
-private:
-  unsigned long faces;
 
-public:
-  explicit ShortRollTreeNode(unsigned long f) : faces{f} {}
+  TreeAnalysis analyze() const { return analyze_uniform_pool(1, faces); }
 
-  TreeExecutionResult execute()
+  void plan(std::vector<PlanStep> &steps, unsigned depth, bool traced) const
   {
-    if (faces < 1)
-    {
-      return {
-          .result = 0,
-          .description =
-              std::format("\nRolling d{}...\nYou rolled: {}\n", faces, 0)
-      };
-    }
+    Pool single = {1, std::max(faces, 1UL), KeepMode::None, 0};
+    auto roll = plan_roll(single, traced);
+    steps.push_back({
+        .depth = depth,
+        .node = std::format("d{}", faces),
+        .strategy = std::string(roll_strategy_name(roll.strategy)),
+        .nanoseconds = roll.nanoseconds,
+        .bytes = 0,
+    });
+  }
 
-    long result = Random::get(1, faces);
-    auto description =
-        std::format("\nRolling d{}...\nYou rolled: {}\n", faces, result);
+  Distribution distribution() const { return uniform_distribution(faces); }
 
-    return {
-        .result = result,
-        .description = description,
-    };
+  void compile(std::vector<CompiledNode> &program) const
+  {
+    program.push_back({
+        .kind = CompiledNodeKind::ShortRoll,
+        .keepMode = KeepMode::None,
+        .value = 1,
+        .faces = faces,
+        .keepCount = 0,
+        .offset = offset,
+    });
   }
 };
 
@@ -185,34 +951,153 @@ private:
 public:
   explicit IntegerTreeNode(unsigned long i) : integer{i} {}
 
-  TreeExecutionResult execute()
+  std::expected<long, DiceError> tryExecute(const EvaluationContext &) const
   {
-    return {
-        .result = static_cast<long>(integer),
-        .description = "",
-    };
+    return static_cast<long>(integer);
+  }
+
+  void executeMany(const EvaluationContext &, std::span<long> results) const
+  {
+    std::fill(results.begin(), results.end(), static_cast<long>(integer));
+  }
+
+  TreeAnalysis analyze() const
+  {
+    return analyze_constant(static_cast<long>(integer));
+  }
+
+  Distribution distribution() const
+  {
+    return point_distribution(static_cast<long>(integer));
+  }
+
+  void plan(std::vector<PlanStep> &steps, unsigned depth, bool) const
+  {
+    steps.push_back({
+        .depth = depth,
+        .node = std::to_string(integer),
+        .strategy = "constant",
+        .nanoseconds = 0,
+        .bytes = 0,
+    });
+  }
+
+  void compile(std::vector<CompiledNode> &program) const
+  {
+    program.push_back({
+        .kind = CompiledNodeKind::Integer,
+        .keepMode = KeepMode::None,
+        .value = integer,
+        .faces = 0,
+        .keepCount = 0,
+        .offset = 0,
+    });
   }
 };
 
-unsigned long parse_integer_raw(std::unique_ptr<Iterator<Token>> &tokens)
+using ParseResult = std::expected<std::unique_ptr<Tree>, DiceError>;
+
+// The error for a token which is not valid where it appears, or for running
+// out of tokens (reported at the last token).
+std::unexpected<DiceError>
+invalid_expression(std::unique_ptr<Iterator<Token>> &tokens)
 {
-  auto nextResult = tokens->next();
+  auto token = tokens->peek();
+  if (!token.has_value())
+  {
+    token = tokens->last();
+  }
+
+  return std::unexpected(DiceError{
+      .code = DiceErrorCode::InvalidExpression,
+      .message = "Input expression is not valid.",
+      .offset = token.has_value() ? token.value().offset : 0,
+  });
+}
+
+std::expected<unsigned long, DiceError>
+parse_integer_raw(std::unique_ptr<Iterator<Token>> &tokens)
+{
+  auto nextResult = tokens->peek();
 
   if (!nextResult.has_value() ||
       nextResult.value().tokenType != TokenType::Integer)
   {
-    throw DiceException("Input expression is not valid.");
+    return invalid_expression(tokens);
   }
 
+  tokens->next();
   return nextResult.value().integerValue;
 }
 
-std::unique_ptr<Tree> parse_integer(std::unique_ptr<Iterator<Token>> &tokens)
+ParseResult parse_integer(std::unique_ptr<Iterator<Token>> &tokens)
+{
+  auto integer = parse_integer_raw(tokens);
+  if (!integer.has_value())
+  {
+    return std::unexpected(integer.error());
+  }
+
+  return std::make_unique<IntegerTreeNode>(integer.value());
+}
+
+// Consumes the `!` after a roll's faces, if there is one. Dice with fewer
+// than two faces would explode forever, so they may not.
+std::expected<bool, DiceError>
+parse_explode(std::unique_ptr<Iterator<Token>> &tokens, unsigned long faces)
+{
+  auto nextResult = tokens->peek();
+  if (!nextResult.has_value() ||
+      nextResult.value().tokenType != TokenType::Explode)
+  {
+    return false;
+  }
+
+  if (faces < 2)
+  {
+    return std::unexpected(DiceError{
+        .code = DiceErrorCode::InvalidExpression,
+        .message = "Exploding dice must have more than one face.",
+        .offset = nextResult.value().offset,
+    });
+  }
+
+  tokens->next();
+  return true;
+}
+
+// Consumes an `s>=` target number after a roll, if there is one, returning
+// 0 when there is none. Every die is at least 1, so lower targets are raised
+// to 1 rather than being mistaken for no target.
+std::expected<unsigned long, DiceError>
+parse_target(std::unique_ptr<Iterator<Token>> &tokens)
 {
-  return std::make_unique<IntegerTreeNode>(parse_integer_raw(tokens));
+  auto nextResult = tokens->peek();
+  if (!nextResult.has_value() ||
+      nextResult.value().tokenType != TokenType::Successes)
+  {
+    return 0;
+  }
+
+  tokens->next();
+  nextResult = tokens->peek();
+  if (!nextResult.has_value() ||
+      nextResult.value().tokenType != TokenType::GreaterEqual)
+  {
+    return invalid_expression(tokens);
+  }
+
+  tokens->next();
+  auto target = parse_integer_raw(tokens);
+  if (!target.has_value())
+  {
+    return std::unexpected(target.error());
+  }
+
+  return std::max(1UL, target.value());
 }
 
-std::unique_ptr<Tree> parse_shortroll(std::unique_ptr<Iterator<Token>> &tokens)
+ParseResult parse_shortroll(std::unique_ptr<Iterator<Token>> &tokens)
 {
   auto nextResult = tokens->next();
   if (!nextResult.has_value() || nextResult.value().tokenType != TokenType::D)
@@ -222,12 +1107,51 @@ std::unique_ptr<Tree> parse_shortroll(std::unique_ptr<Iterator<Token>> &tokens)
     );
   }
 
-  return std::make_unique<ShortRollTreeNode>(parse_integer_raw(tokens));
+  auto faces = parse_integer_raw(tokens);
+  if (!faces.has_value())
+  {
+    return std::unexpected(faces.error());
+  }
+
+  auto explode = parse_explode(tokens, faces.value());
+  if (!explode.has_value())
+  {
+    return std::unexpected(explode.error());
+  }
+
+  auto target = parse_target(tokens);
+  if (!target.has_value())
+  {
+    return std::unexpected(target.error());
+  }
+
+  // A single exploding or success counting die is rolled as a pool of one.
+  if (explode.value() || target.value() != 0)
+  {
+    return std::make_unique<LongRollTreeNode>(LongRollTreeNodeArgs{
+        .die = 1,
+        .faces = faces.value(),
+        .high = std::nullopt,
+        .low = std::nullopt,
+        .explode = explode.value(),
+        .target = target.value(),
+        .offset = nextResult.value().offset,
+    });
+  }
+
+  return std::make_unique<ShortRollTreeNode>(
+      faces.value(), nextResult.value().offset
+  );
 }
 
-std::unique_ptr<Tree> parse_longroll(std::unique_ptr<Iterator<Token>> &tokens)
+ParseResult parse_longroll(std::unique_ptr<Iterator<Token>> &tokens)
 {
+  auto first = tokens->peek();
   auto die = parse_integer_raw(tokens);
+  if (!die.has_value())
+  {
+    return std::unexpected(die.error());
+  }
 
   auto nextResult = tokens->next();
   if (!nextResult.has_value() || nextResult.value().tokenType != TokenType::D)
@@ -238,52 +1162,70 @@ std::unique_ptr<Tree> parse_longroll(std::unique_ptr<Iterator<Token>> &tokens)
   }
 
   auto faces = parse_integer_raw(tokens);
+  if (!faces.has_value())
+  {
+    return std::unexpected(faces.error());
+  }
+
+  auto explode = parse_explode(tokens, faces.value());
+  if (!explode.has_value())
+  {
+    return std::unexpected(explode.error());
+  }
+
+  LongRollTreeNodeArgs args = {
+      .die = die.value(),
+      .faces = faces.value(),
+      .high = std::nullopt,
+      .low = std::nullopt,
+      .explode = explode.value(),
+      .target = 0,
+      .offset = first.value().offset,
+  };
 
   nextResult = tokens->peek();
-  if (nextResult.has_value())
-  {
-    switch (nextResult.value().tokenType)
-    {
-    case TokenType::L:
-      // discard L token
-      tokens->next();
-      return std::make_unique<LongRollTreeNode>(LongRollTreeNodeArgs{
-          .die = die,
-          .faces = faces,
-          .high = std::nullopt,
-          .low = parse_integer_raw(tokens),
-      });
+  if (nextResult.has_value() &&
+      (nextResult.value().tokenType == TokenType::L ||
+       nextResult.value().tokenType == TokenType::H))
+  {
+    // discard L or H token
+    tokens->next();
 
-    case TokenType::H:
-      // discard H token
-      tokens->next();
-      return std::make_unique<LongRollTreeNode>(LongRollTreeNodeArgs{
-          .die = die,
-          .faces = faces,
-          .high = parse_integer_raw(tokens),
-          .low = std::nullopt,
-      });
+    auto keep = parse_integer_raw(tokens);
+    if (!keep.has_value())
+    {
+      return std::unexpected(keep.error());
+    }
 
-    default:
-        // do nothing and return at the bottom of this function
-        ;
+    if (nextResult.value().tokenType == TokenType::L)
+    {
+      args.low = keep.value();
+    }
+    else
+    {
+      args.high = keep.value();
     }
+
+    return std::make_unique<LongRollTreeNode>(args);
   }
 
-  return std::make_unique<LongRollTreeNode>(LongRollTreeNodeArgs{
-      .die = die,
-      .faces = faces,
-      .high = std::nullopt,
-      .low = std::nullopt,
-  });
+  // Pools either keep dice or count successes, not both.
+  auto target = parse_target(tokens);
+  if (!target.has_value())
+  {
+    return std::unexpected(target.error());
+  }
+  args.target = target.value();
+
+  return std::make_unique<LongRollTreeNode>(args);
 }
 
-std::unique_ptr<Tree> parse_roll(std::unique_ptr<Iterator<Token>> &tokens)
+ParseResult parse_roll(std::unique_ptr<Iterator<Token>> &tokens)
 {
   auto nextToken = tokens->peek();
   if (!nextToken.has_value())
   {
-    throw DiceException("Input expression is not valid.");
+    return invalid_expression(tokens);
   }
   if (nextToken.has_value() && nextToken.value().tokenType == TokenType::D)
   {
@@ -300,137 +1242,327 @@ std::unique_ptr<Tree> parse_roll(std::unique_ptr<Iterator<Token>> &tokens)
   return parse_integer(tokens);
 }
 
-std::unique_ptr<Tree> parse_add(std::unique_ptr<Iterator<Token>> &tokens);
+// Operands and operators seen so far inside one level of parentheses (or at
+// the top level). Terms of the current `*` `/` chain are gathered until a
+// `+` `-` or the end of the level closes it. A comparison closes the level's
+// sum so far as its left side, and each level may hold one comparison.
+struct ParseFrame
+{
+  std::unique_ptr<Tree> compared;
+  Comparison comparison = Comparison::Equal;
+  std::unique_ptr<Tree> firstTerm;
+  std::vector<MathOperand> terms;
+  MathOperation termOperation = MathOperation::Add;
+  std::size_t termOffset = 0;
+  std::unique_ptr<Tree> firstFactor;
+  std::vector<MathOperand> factors;
+  MathOperation factorOperation = MathOperation::Multiply;
+  std::size_t factorOffset = 0;
+};
 
-std::unique_ptr<Tree> parse_atom(std::unique_ptr<Iterator<Token>> &tokens)
+std::unique_ptr<Tree>
+make_math_chain(std::unique_ptr<Tree> first, std::vector<MathOperand> rest)
 {
-  auto nextToken = tokens->peek();
-  if (!nextToken.has_value())
+  if (rest.empty())
   {
-    throw DiceException("Input expression is not valid.");
+    return first;
   }
-  if (nextToken.has_value() &&
-      nextToken.value().tokenType != TokenType::OpenParenthesis)
+
+  return std::make_unique<MathTreeNode>(MathTreeNodeArgs{
+      .firstOperand = std::move(first),
+      .operands = std::move(rest),
+  });
+}
+
+void add_factor(ParseFrame &frame, std::unique_ptr<Tree> factor)
+{
+  if (!frame.firstFactor)
   {
-    return parse_roll(tokens);
+    frame.firstFactor = std::move(factor);
+    return;
   }
 
-  tokens->next(); // discard ( token
-  auto result = parse_add(tokens);
-  tokens->next(); // discard ) token
-
-  return result;
+  frame.factors.push_back(
+      {frame.factorOperation, std::move(factor), frame.factorOffset}
+  );
 }
 
-std::unique_ptr<Tree> parse_mult(std::unique_ptr<Iterator<Token>> &tokens)
+void close_term(ParseFrame &frame)
 {
-  auto leftOperand = parse_atom(tokens);
+  auto term =
+      make_math_chain(std::move(frame.firstFactor), std::move(frame.factors));
+  frame.factors.clear();
 
-  auto peekResult = tokens->peek();
-  while (peekResult.has_value())
+  if (!frame.firstTerm)
   {
-    MathOperation op;
-    switch (peekResult.value().tokenType)
-    {
-    case TokenType::Multiply:
-      op = MathOperation::Multiply;
-      break;
-    case TokenType::Divide:
-      op = MathOperation::Divide;
-      break;
-    default:
-      return leftOperand;
-    }
-
-    tokens->next(); // discard * or / token
+    frame.firstTerm = std::move(term);
+    return;
+  }
 
-    auto rightOperand = parse_atom(tokens);
+  frame.terms.push_back(
+      {frame.termOperation, std::move(term), frame.termOffset}
+  );
+}
 
-    leftOperand = std::make_unique<MathTreeNode>(MathTreeNodeArgs{
-        .leftOperand = std::move(leftOperand),
-        .rightOperand = std::move(rightOperand),
-        .operation = op,
-    });
+std::unique_ptr<Tree> close_sum(ParseFrame &frame)
+{
+  close_term(frame);
+  auto sum =
+      make_math_chain(std::move(frame.firstTerm), std::move(frame.terms));
+  frame.terms.clear();
+  return sum;
+}
 
-    peekResult = tokens->peek();
+std::unique_ptr<Tree> close_frame(ParseFrame &frame)
+{
+  auto sum = close_sum(frame);
+  if (!frame.compared)
+  {
+    return sum;
   }
 
-  return leftOperand;
+  return std::make_unique<ComparisonTreeNode>(ComparisonTreeNodeArgs{
+      .left = std::move(frame.compared),
+      .right = std::move(sum),
+      .comparison = frame.comparison,
+  });
+}
+
+// The comparison a token stands for, if it is a comparison operator.
+std::optional<Comparison> token_comparison(TokenType tokenType)
+{
+  switch (tokenType)
+  {
+  case TokenType::GreaterEqual:
+    return Comparison::GreaterEqual;
+  case TokenType::LessEqual:
+    return Comparison::LessEqual;
+  case TokenType::Greater:
+    return Comparison::Greater;
+  case TokenType::Less:
+    return Comparison::Less;
+  case TokenType::Equal:
+    return Comparison::Equal;
+  default:
+    return std::nullopt;
+  }
 }
 
-std::unique_ptr<Tree> parse_add(std::unique_ptr<Iterator<Token>> &tokens)
+// Parses `add` from the grammar without recursion: each open parenthesis
+// pushes a frame onto an explicit stack and each close parenthesis pops one,
+// so adversarial nesting is bounded by `limits` rather than the call stack.
+ParseResult parse_add(
+    std::unique_ptr<Iterator<Token>> &tokens,
+    const ParseLimits &limits
+)
 {
-  auto leftOperand = parse_mult(tokens);
+  std::vector<ParseFrame> frames(1);
+  bool expectOperand = true;
 
-  auto peekResult = tokens->peek();
-  while (peekResult.has_value())
+  while (true)
   {
-    MathOperation op;
-    switch (peekResult.value().tokenType)
+    auto nextToken = tokens->peek();
+
+    if (expectOperand)
+    {
+      if (!nextToken.has_value())
+      {
+        return invalid_expression(tokens);
+      }
+
+      if (nextToken.value().tokenType == TokenType::OpenParenthesis)
+      {
+        if (frames.size() > limits.maxDepth)
+        {
+          return std::unexpected(DiceError{
+              .code = DiceErrorCode::NestedTooDeeply,
+              .message = "Expression is nested too deeply.",
+              .offset = nextToken.value().offset,
+          });
+        }
+        tokens->next(); // discard ( token
+        frames.emplace_back();
+        continue;
+      }
+
+      auto roll = parse_roll(tokens);
+      if (!roll.has_value())
+      {
+        return roll;
+      }
+      add_factor(frames.back(), std::move(roll.value()));
+      expectOperand = false;
+      continue;
+    }
+
+    if (!nextToken.has_value())
+    {
+      break;
+    }
+
+    auto &frame = frames.back();
+    std::size_t offset = nextToken.value().offset;
+    auto comparison = token_comparison(nextToken.value().tokenType);
+    if (comparison.has_value())
+    {
+      // Chained comparisons such as `a < b < c` are ambiguous.
+      if (frame.compared)
+      {
+        return invalid_expression(tokens);
+      }
+
+      frame.compared = close_sum(frame);
+      frame.comparison = comparison.value();
+      tokens->next(); // discard comparison token
+      expectOperand = true;
+      continue;
+    }
+
+    switch (nextToken.value().tokenType)
     {
+    case TokenType::Multiply:
+      frame.factorOperation = MathOperation::Multiply;
+      frame.factorOffset = offset;
+      break;
+
+    case TokenType::Divide:
+      frame.factorOperation = MathOperation::Divide;
+      frame.factorOffset = offset;
+      break;
+
     case TokenType::Add:
-      op = MathOperation::Add;
+      close_term(frame);
+      frame.termOperation = MathOperation::Add;
+      frame.termOffset = offset;
       break;
+
     case TokenType::Subtract:
-      op = MathOperation::Subtract;
+      close_term(frame);
+      frame.termOperation = MathOperation::Subtract;
+      frame.termOffset = offset;
       break;
-    default:
-      return leftOperand;
-    }
 
-    tokens->next(); // discard + or - token
+    case TokenType::CloseParenthesis:
+    {
+      if (frames.size() == 1)
+      {
+        return invalid_expression(tokens);
+      }
+
+      auto parenthetical = close_frame(frame);
+      frames.pop_back();
+      add_factor(frames.back(), std::move(parenthetical));
+      tokens->next(); // discard ) token
+      continue;
+    }
 
-    auto rightOperand = parse_mult(tokens);
+    default:
+      return invalid_expression(tokens);
+    }
 
-    leftOperand = std::make_unique<MathTreeNode>(MathTreeNodeArgs{
-        .leftOperand = std::move(leftOperand),
-        .rightOperand = std::move(rightOperand),
-        .operation = op,
-    });
+    tokens->next(); // discard operator token
+    expectOperand = true;
+  }
 
-    peekResult = tokens->peek();
+  if (frames.size() != 1)
+  {
+    return invalid_expression(tokens);
   }
 
-  return leftOperand;
+  return close_frame(frames.back());
 }
 
-void validate_parenthesis_count(std::vector<Token> tokens)
+std::expected<void, DiceError>
+validate_parenthesis_count(const std::vector<Token> &tokens)
 {
-  int openCount = 0;
-  int closeCount = 0;
+  // Offsets of the open parentheses not yet closed, and the close
+  // parentheses which had nothing to close. Out of order but balanced
+  // parentheses, such as `)(`, are left to the parser to reject.
+  std::vector<std::size_t> unclosed;
+  std::vector<std::size_t> unopened;
 
-  for (Token token : tokens)
+  for (const Token &token : tokens)
   {
     if (token.tokenType == TokenType::OpenParenthesis)
     {
-      openCount++;
+      unclosed.push_back(token.offset);
     }
     else if (token.tokenType == TokenType::CloseParenthesis)
     {
-      closeCount++;
+      if (unclosed.empty())
+      {
+        unopened.push_back(token.offset);
+      }
+      else
+      {
+        unclosed.pop_back();
+      }
     }
   }
 
-  if (openCount != closeCount)
+  if (unclosed.size() == unopened.size())
   {
-    throw DiceException("Expression contains an unclosed parenthetical.");
+    return {};
   }
+
+  return std::unexpected(DiceError{
+      .code = DiceErrorCode::UnclosedParenthetical,
+      .message = "Expression contains an unclosed parenthetical.",
+      .offset = unclosed.size() > unopened.size() ? unclosed.front()
+                                                  : unopened.front(),
+  });
 }
 
-void validate_input_not_empty(std::vector<Token> tokens)
+std::expected<void, DiceError>
+validate_input_size(const std::vector<Token> &tokens, const ParseLimits &limits)
 {
-  if (tokens.size() < 1)
+  if (tokens.empty())
   {
-    throw DiceException("Empty input.");
+    return std::unexpected(DiceError{
+        .code = DiceErrorCode::EmptyInput,
+        .message = "Empty input.",
+        .offset = 0,
+    });
+  }
+
+  if (tokens.size() > limits.maxTokens)
+  {
+    return std::unexpected(DiceError{
+        .code = DiceErrorCode::ExpressionTooLong,
+        .message = "Expression is too long.",
+        .offset = tokens.at(limits.maxTokens).offset,
+    });
   }
+
+  return {};
 }
 
-std::unique_ptr<Tree> parse(std::vector<Token> tokens)
+ParseResult
+try_parse(const std::vector<Token> &tokens, const ParseLimits &limits)
 {
-  validate_input_not_empty(tokens);
-  validate_parenthesis_count(tokens);
+  auto valid = validate_input_size(tokens, limits);
+  if (valid.has_value())
+  {
+    valid = validate_parenthesis_count(tokens);
+  }
+  if (!valid.has_value())
+  {
+    return std::unexpected(valid.error());
+  }
 
   auto iterator = std::make_unique<Iterator<Token>>(tokens);
 
-  return parse_add(iterator);
+  return parse_add(iterator, limits);
+}
+
+std::unique_ptr<Tree>
+parse(const std::vector<Token> &tokens, const ParseLimits &limits)
+{
+  auto result = try_parse(tokens, limits);
+  if (!result.has_value())
+  {
+    throw DiceException(result.error());
+  }
+
+  return std::move(result.value());
 }
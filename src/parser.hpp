@@ -1,6 +1,17 @@
+#pragma once
+
+#include "analysis.hpp"
+#include "dice_exception.hpp"
+#include "distribution.hpp"
+#include "evaluation.hpp"
 #include "lexer.hpp"
+#include "planner.hpp"
+#include "program.hpp"
+#include "trace.hpp"
+#include <expected>
 #include <memory>
 #include <optional>
+#include <span>
 
 struct TreeExecutionResult
 {
@@ -8,11 +19,49 @@ struct TreeExecutionResult
   std::string description;
 };
 
+// A parsed expression. Trees are immutable once parsed, so every method is
+// const and one tree may be evaluated on several threads at once.
 class Tree
 {
 public:
   virtual ~Tree() {}
-  virtual TreeExecutionResult execute() = 0;
+  // Evaluates the tree with the context's generator, writing its description
+  // to the context's trace (if any) as it goes.
+  virtual std::expected<long, DiceError>
+  tryExecute(const EvaluationContext &context) const = 0;
+  // As tryExecute(), throwing a DiceException on error.
+  long execute(const EvaluationContext &context) const;
+  // Evaluates the tree with this thread's generator and collects its
+  // description in memory.
+  TreeExecutionResult execute() const;
+  // Evaluates the tree once for each element of `results`, a whole batch of
+  // samples at a time per node. The context's trace is not written.
+  virtual void executeMany(
+      const EvaluationContext &context,
+      std::span<long> results
+  ) const = 0;
+  virtual TreeAnalysis analyze() const = 0;
+  virtual Distribution distribution() const = 0;
+  // Appends the tree's nodes to `program` in postfix order.
+  virtual void compile(std::vector<CompiledNode> &program) const = 0;
+  // Appends how each of the tree's nodes will be evaluated to `steps`, the
+  // tree itself at `depth` and its operands below it.
+  virtual void
+  plan(std::vector<PlanStep> &steps, unsigned depth, bool traced) const = 0;
 };
 
-std::unique_ptr<Tree> parse(std::vector<Token> tokens);
+// Bounds on the input accepted by parse(), which is safe to call on
+// untrusted input as long as these are bounded.
+struct ParseLimits
+{
+  // Deepest nesting of parentheses.
+  unsigned long maxDepth = 1000;
+  unsigned long maxTokens = 1 << 22;
+};
+
+std::expected<std::unique_ptr<Tree>, DiceError>
+try_parse(const std::vector<Token> &tokens, const ParseLimits &limits = {});
+
+// As try_parse(), throwing a DiceException on error.
+std::unique_ptr<Tree>
+parse(const std::vector<Token> &tokens, const ParseLimits &limits = {});
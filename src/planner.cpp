@@ -0,0 +1,173 @@
+#include "planner.hpp"
+#include "alias_table.hpp"
+#include "dice_exception.hpp"
+#include "parser.hpp"
+#include <climits>
+#include <cmath>
+#include <format>
+
+// Estimated cost of drawing one sample from an alias table.
+constexpr double aliasSampleNanoseconds = 5;
+// Estimated cost of computing an exact distribution and building its alias
+// table, per outcome. Keep pools cost more and plain sums less, but this
+// puts the break-even point in the right place for most expressions.
+constexpr double aliasOutcomeNanoseconds = 200;
+// The outcomes of unbounded (exploding) expressions are counted out to this
+// many standard deviations above the mean, where the distribution is
+// truncated in practice.
+constexpr double unboundedOutcomeDeviations = 40;
+
+// Outcomes of an expression's exact distribution, which its alias table has
+// one entry for each of.
+double estimated_outcome_count(const TreeAnalysis &analysis)
+{
+  auto min = static_cast<double>(analysis.min);
+  if (analysis.max != LONG_MAX)
+  {
+    return static_cast<double>(analysis.max) - min + 1;
+  }
+
+  return analysis.mean +
+         unboundedOutcomeDeviations * std::sqrt(analysis.variance) - min + 1;
+}
+
+ExecutionPlan plan_execution(const Tree &tree, const PlanOptions &options)
+{
+  auto samples = static_cast<double>(options.samples);
+  ExecutionPlan evaluated = {
+      .samples = options.samples,
+      .aliasTable = false,
+      .steps = {},
+      .nanoseconds = 0,
+      .bytes = 0,
+  };
+  tree.plan(evaluated.steps, 0, options.traced);
+  for (const auto &step : evaluated.steps)
+  {
+    evaluated.nanoseconds += step.nanoseconds * samples;
+    evaluated.bytes += step.bytes;
+  }
+
+  std::vector<ExecutionPlan> candidates = {evaluated};
+  if (!options.traced && options.aliasBudget > 0)
+  {
+    double outcomes = estimated_outcome_count(tree.analyze());
+    if (outcomes * sizeof(AliasEntry) <=
+        static_cast<double>(options.aliasBudget))
+    {
+      ExecutionPlan aliased = evaluated;
+      aliased.aliasTable = true;
+      aliased.nanoseconds = outcomes * aliasOutcomeNanoseconds +
+                            samples * aliasSampleNanoseconds;
+      // The table, and the distribution it is built from.
+      aliased.bytes = static_cast<std::size_t>(
+          outcomes * (sizeof(AliasEntry) + sizeof(double))
+      );
+      candidates.push_back(aliased);
+    }
+  }
+
+  const ExecutionPlan *best = nullptr;
+  for (const auto &candidate : candidates)
+  {
+    if (candidate.bytes <= options.maxBytes &&
+        (best == nullptr || candidate.nanoseconds < best->nanoseconds))
+    {
+      best = &candidate;
+    }
+  }
+
+  if (best == nullptr)
+  {
+    throw DiceException(std::format(
+        "Evaluating this expression needs an estimated {} bytes, over the "
+        "memory budget of {} bytes.",
+        evaluated.bytes,
+        options.maxBytes
+    ));
+  }
+  if (best->nanoseconds / 1e9 > options.maxSeconds)
+  {
+    throw DiceException(std::format(
+        "Evaluating this expression is estimated to take {:.3g} seconds, "
+        "over the time budget of {:g} seconds.",
+        best->nanoseconds / 1e9,
+        options.maxSeconds
+    ));
+  }
+
+  return *best;
+}
+
+std::string format_plan_time(double nanoseconds)
+{
+  if (nanoseconds < 1e3)
+  {
+    return std::format("{:.0f}ns", nanoseconds);
+  }
+  if (nanoseconds < 1e6)
+  {
+    return std::format("{:.1f}us", nanoseconds / 1e3);
+  }
+  if (nanoseconds < 1e9)
+  {
+    return std::format("{:.1f}ms", nanoseconds / 1e6);
+  }
+
+  return std::format("{:.1f}s", nanoseconds / 1e9);
+}
+
+std::string format_plan_bytes(std::size_t bytes)
+{
+  auto value = static_cast<double>(bytes);
+  if (bytes < 1024)
+  {
+    return std::format("{}B", bytes);
+  }
+  if (bytes < 1024 * 1024)
+  {
+    return std::format("{:.1f}KiB", value / 1024);
+  }
+  if (bytes < 1024 * 1024 * 1024)
+  {
+    return std::format("{:.1f}MiB", value / (1024 * 1024));
+  }
+
+  return std::format("{:.1f}GiB", value / (1024 * 1024 * 1024));
+}
+
+std::string explain_plan(const ExecutionPlan &plan)
+{
+  std::string explanation = std::format(
+      "{} the expression {} time{}, estimated {} and {}:\n",
+      plan.aliasTable ? "Sample the exact distribution of"
+                      : "Evaluate each node of",
+      plan.samples,
+      plan.samples == 1 ? "" : "s",
+      format_plan_time(plan.nanoseconds),
+      format_plan_bytes(plan.bytes)
+  );
+
+  for (const auto &step : plan.steps)
+  {
+    std::string indent(2 * (step.depth + 1), ' ');
+    // Only the exact distribution is sampled, so the nodes' own strategies
+    // do not matter.
+    if (plan.aliasTable)
+    {
+      explanation += std::format("{}{}\n", indent, step.node);
+      continue;
+    }
+
+    explanation += std::format(
+        "{}{}: {}, {} and {} per evaluation\n",
+        indent,
+        step.node,
+        step.strategy,
+        format_plan_time(step.nanoseconds),
+        format_plan_bytes(step.bytes)
+    );
+  }
+
+  return explanation;
+}
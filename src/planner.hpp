@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+class Tree;
+
+// How an expression is going to be evaluated, and the limits on doing so.
+struct PlanOptions
+{
+  // Evaluations which will be made of the expression.
+  unsigned long samples = 1;
+  // Whether each roll is written to a trace.
+  bool traced = false;
+  // Largest alias table worth building, in bytes, or 0 to never build one.
+  std::size_t aliasBudget = 0;
+  // Plans estimated to take longer or use more memory are rejected.
+  double maxSeconds = std::numeric_limits<double>::infinity();
+  std::size_t maxBytes = SIZE_MAX;
+};
+
+// How one node of a tree is evaluated, and its estimated cost for each
+// evaluation.
+struct PlanStep
+{
+  // Nesting depth of the node below the root.
+  unsigned depth;
+  std::string node;
+  std::string strategy;
+  double nanoseconds;
+  std::size_t bytes;
+};
+
+struct ExecutionPlan
+{
+  unsigned long samples;
+  // Whether samples are drawn from an alias table over the exact
+  // distribution instead of evaluating the tree.
+  bool aliasTable;
+  // Every node of the tree, each before its operands.
+  std::vector<PlanStep> steps;
+  // Estimated time and memory for all of the samples.
+  double nanoseconds;
+  std::size_t bytes;
+};
+
+// Chooses between sampling from an alias table and evaluating each node
+// with the strategy plan_roll() picks for it, whichever is estimated to be
+// faster within the memory budget. Throws a DiceException if no plan fits
+// within the memory budget or the cheapest one exceeds the time budget.
+ExecutionPlan plan_execution(const Tree &tree, const PlanOptions &options);
+
+// A readable description of a plan, one line per node, for `--explain`.
+std::string explain_plan(const ExecutionPlan &plan);
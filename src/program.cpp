@@ -0,0 +1,219 @@
+#include "program.hpp"
+#include <algorithm>
+#include <format>
+#include <random>
+
+bool is_keep_mode(KeepMode keepMode)
+{
+  return keepMode == KeepMode::None || keepMode == KeepMode::Highest ||
+         keepMode == KeepMode::Lowest;
+}
+
+std::expected<std::size_t, DiceError>
+validate_program(std::span<const CompiledNode> program)
+{
+  bool valid = true;
+  std::size_t depth = 0;
+  std::size_t maxDepth = 0;
+
+  for (const CompiledNode &node : program)
+  {
+    switch (node.kind)
+    {
+    case CompiledNodeKind::Integer:
+    case CompiledNodeKind::ShortRoll:
+    case CompiledNodeKind::LongRoll:
+      valid = is_keep_mode(node.keepMode);
+      depth++;
+      maxDepth = std::max(maxDepth, depth);
+      break;
+
+    // Dice with a single face would explode forever.
+    case CompiledNodeKind::ExplodingLongRoll:
+    case CompiledNodeKind::ExplodingSuccessCount:
+      valid = is_keep_mode(node.keepMode) && node.faces != 1;
+      depth++;
+      maxDepth = std::max(maxDepth, depth);
+      break;
+
+    case CompiledNodeKind::SuccessCount:
+      valid = is_keep_mode(node.keepMode);
+      depth++;
+      maxDepth = std::max(maxDepth, depth);
+      break;
+
+    case CompiledNodeKind::Add:
+    case CompiledNodeKind::Subtract:
+    case CompiledNodeKind::Multiply:
+    case CompiledNodeKind::Divide:
+    case CompiledNodeKind::GreaterEqual:
+    case CompiledNodeKind::LessEqual:
+    case CompiledNodeKind::Greater:
+    case CompiledNodeKind::Less:
+    case CompiledNodeKind::Equal:
+      valid = depth >= 2;
+      depth--;
+      break;
+
+    default:
+      valid = false;
+    }
+
+    if (!valid)
+    {
+      break;
+    }
+  }
+
+  if (!valid || depth != 1)
+  {
+    return std::unexpected(DiceError{
+        .code = DiceErrorCode::InvalidExpression,
+        .message = "Compiled expression is not valid.",
+        .offset = 0,
+    });
+  }
+
+  return maxDepth;
+}
+
+long roll_compiled_node(const CompiledNode &node, std::mt19937 &rng)
+{
+  if (node.faces < 1 || node.value < 1)
+  {
+    return 0;
+  }
+
+  if (node.kind == CompiledNodeKind::ShortRoll)
+  {
+    std::uniform_int_distribution<unsigned long> distribution(1, node.faces);
+    return static_cast<long>(distribution(rng));
+  }
+
+  Pool pool = {node.value, node.faces, node.keepMode, node.keepCount};
+  switch (node.kind)
+  {
+  case CompiledNodeKind::ExplodingLongRoll:
+    pool.explode = true;
+    break;
+
+  case CompiledNodeKind::ExplodingSuccessCount:
+    pool.explode = true;
+    [[fallthrough]];
+  case CompiledNodeKind::SuccessCount:
+    pool.keepMode = KeepMode::None;
+    pool.keepCount = 0;
+    pool.target = std::max<std::uint64_t>(node.keepCount, 1);
+    break;
+
+  default:
+    break;
+  }
+
+  return roll_pool(pool, rng, nullptr);
+}
+
+std::expected<long, DiceError> evaluate_program(
+    std::span<const CompiledNode> program,
+    std::size_t stackDepth,
+    const EvaluationContext &context
+)
+{
+  // Most programs fit in the local buffer, so evaluation does not allocate.
+  constexpr std::size_t localStackDepth = 32;
+  long localStack[localStackDepth];
+  std::vector<long> heapStack;
+  long *stack = localStack;
+  if (stackDepth > localStackDepth)
+  {
+    heapStack.resize(stackDepth);
+    stack = heapStack.data();
+  }
+
+  std::size_t depth = 0;
+  for (const CompiledNode &node : program)
+  {
+    long right = 0;
+    switch (node.kind)
+    {
+    case CompiledNodeKind::Integer:
+      stack[depth++] = static_cast<long>(node.value);
+      continue;
+
+    case CompiledNodeKind::ShortRoll:
+    case CompiledNodeKind::LongRoll:
+    case CompiledNodeKind::ExplodingLongRoll:
+    case CompiledNodeKind::SuccessCount:
+    case CompiledNodeKind::ExplodingSuccessCount:
+      if (node.value > context.limits.maxDicePerRoll)
+      {
+        return std::unexpected(DiceError{
+            .code = DiceErrorCode::TooManyDice,
+            .message = std::format(
+                "Cannot roll {} {} at once.",
+                node.value,
+                node.value == 1 ? "die" : "dice"
+            ),
+            .offset = node.offset,
+        });
+      }
+      stack[depth++] = roll_compiled_node(node, context.rng);
+      continue;
+
+    case CompiledNodeKind::Add:
+      right = stack[--depth];
+      stack[depth - 1] += right;
+      continue;
+
+    case CompiledNodeKind::Subtract:
+      right = stack[--depth];
+      stack[depth - 1] -= right;
+      continue;
+
+    case CompiledNodeKind::Multiply:
+      right = stack[--depth];
+      stack[depth - 1] *= right;
+      continue;
+
+    case CompiledNodeKind::Divide:
+      right = stack[--depth];
+      if (right == 0)
+      {
+        return std::unexpected(DiceError{
+            .code = DiceErrorCode::DivisionByZero,
+            .message = "Division by zero is not allowed.",
+            .offset = node.offset,
+        });
+      }
+      stack[depth - 1] /= right;
+      continue;
+
+    case CompiledNodeKind::GreaterEqual:
+      right = stack[--depth];
+      stack[depth - 1] = stack[depth - 1] >= right ? 1 : 0;
+      continue;
+
+    case CompiledNodeKind::LessEqual:
+      right = stack[--depth];
+      stack[depth - 1] = stack[depth - 1] <= right ? 1 : 0;
+      continue;
+
+    case CompiledNodeKind::Greater:
+      right = stack[--depth];
+      stack[depth - 1] = stack[depth - 1] > right ? 1 : 0;
+      continue;
+
+    case CompiledNodeKind::Less:
+      right = stack[--depth];
+      stack[depth - 1] = stack[depth - 1] < right ? 1 : 0;
+      continue;
+
+    case CompiledNodeKind::Equal:
+      right = stack[--depth];
+      stack[depth - 1] = stack[depth - 1] == right ? 1 : 0;
+      continue;
+    }
+  }
+
+  return stack[0];
+}
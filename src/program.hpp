@@ -0,0 +1,65 @@
+#pragma once
+
+#include "dice_exception.hpp"
+#include "evaluation.hpp"
+#include "roll.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <span>
+#include <vector>
+
+enum class CompiledNodeKind : std::uint32_t
+{
+  Integer,
+  ShortRoll,
+  LongRoll,
+  Add,
+  Subtract,
+  Multiply,
+  Divide,
+  // Appended so that the values of existing kinds stay stable on disk.
+  ExplodingLongRoll,
+  SuccessCount,
+  ExplodingSuccessCount,
+  // Comparisons, which leave 1 if they hold and 0 if not.
+  GreaterEqual,
+  LessEqual,
+  Greater,
+  Less,
+  Equal
+};
+
+// One node of a compiled expression. A program is its tree's nodes in
+// postfix order, so it is evaluated with a single pass over a flat array and
+// a stack of intermediate results. The layout is fixed so that programs can
+// be written to disk and used straight from a mapping.
+struct CompiledNode
+{
+  CompiledNodeKind kind;
+  KeepMode keepMode;
+  // The integer of an Integer node and the number of dice of a roll.
+  std::uint64_t value;
+  std::uint64_t faces;
+  // The dice kept by a roll, or the target number of a success count.
+  std::uint64_t keepCount;
+  // Byte offset in the source expression of a roll or of a math operation's
+  // operator, which errors they raise are reported at.
+  std::uint64_t offset;
+};
+
+static_assert(sizeof(CompiledNode) == 40);
+
+// Returns the deepest stack `program` needs, or an error if it is not a
+// well formed program.
+std::expected<std::size_t, DiceError>
+validate_program(std::span<const CompiledNode> program);
+
+// Evaluates a program already checked by validate_program(), which returned
+// `stackDepth`. Programs are only read, so any number of threads may
+// evaluate one at once. The context's trace is not written.
+std::expected<long, DiceError> evaluate_program(
+    std::span<const CompiledNode> program,
+    std::size_t stackDepth,
+    const EvaluationContext &context
+);
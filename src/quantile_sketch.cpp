@@ -0,0 +1,217 @@
+#include "quantile_sketch.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+// Each level below the top holds this fraction of the one above it.
+constexpr double quantileSketchShrink = 2.0 / 3.0;
+
+QuantileSketch::QuantileSketch(unsigned size, std::uint64_t seed)
+    : k{std::max(size, 2U)}, coins{seed ^ 0x9e3779b97f4a7c15ULL}
+{
+  addLevel();
+}
+
+std::size_t QuantileSketch::levelCapacity(std::size_t level) const
+{
+  auto depth = static_cast<double>(levels.size() - 1 - level);
+  auto capacity = static_cast<std::size_t>(
+      std::ceil(k * std::pow(quantileSketchShrink, depth))
+  );
+  return std::max<std::size_t>(capacity, 2);
+}
+
+void QuantileSketch::addLevel()
+{
+  levels.emplace_back();
+  capacity = 0;
+  for (std::size_t level = 0; level < levels.size(); level++)
+  {
+    capacity += levelCapacity(level);
+  }
+}
+
+void QuantileSketch::compress()
+{
+  for (std::size_t level = 0; level < levels.size(); level++)
+  {
+    if (levels[level].size() < levelCapacity(level))
+    {
+      continue;
+    }
+    if (level + 1 == levels.size())
+    {
+      addLevel();
+    }
+
+    // xorshift64 supplies the coin which picks the promoted half.
+    coins ^= coins << 13;
+    coins ^= coins >> 7;
+    coins ^= coins << 17;
+
+    auto &compacted = levels[level];
+    std::sort(compacted.begin(), compacted.end());
+    // An odd result out stays at this level, so no weight is lost.
+    std::size_t kept = compacted.size() % 2;
+    std::size_t promoted = 0;
+    for (std::size_t i = kept + (coins & 1); i < compacted.size(); i += 2)
+    {
+      levels[level + 1].push_back(compacted[i]);
+      promoted++;
+    }
+    retainedCount -= compacted.size() - kept - promoted;
+    compacted.resize(kept);
+
+    if (retainedCount < capacity)
+    {
+      return;
+    }
+  }
+}
+
+void QuantileSketch::add(long value)
+{
+  if (total == 0)
+  {
+    minValue = value;
+    maxValue = value;
+  }
+  minValue = std::min(minValue, value);
+  maxValue = std::max(maxValue, value);
+  total++;
+
+  levels[0].push_back(value);
+  retainedCount++;
+  if (retainedCount >= capacity)
+  {
+    compress();
+  }
+}
+
+void QuantileSketch::add(std::span<const long> values)
+{
+  for (long value : values)
+  {
+    add(value);
+  }
+}
+
+void QuantileSketch::merge(const QuantileSketch &other)
+{
+  if (other.total == 0)
+  {
+    return;
+  }
+  if (total == 0)
+  {
+    minValue = other.minValue;
+    maxValue = other.maxValue;
+  }
+  minValue = std::min(minValue, other.minValue);
+  maxValue = std::max(maxValue, other.maxValue);
+  total += other.total;
+
+  while (levels.size() < other.levels.size())
+  {
+    addLevel();
+  }
+  for (std::size_t level = 0; level < other.levels.size(); level++)
+  {
+    levels[level].insert(
+        levels[level].end(),
+        other.levels[level].begin(),
+        other.levels[level].end()
+    );
+    retainedCount += other.levels[level].size();
+  }
+
+  while (retainedCount >= capacity)
+  {
+    compress();
+  }
+}
+
+std::uint64_t QuantileSketch::count() const { return total; }
+
+std::size_t QuantileSketch::retained() const { return retainedCount; }
+
+long QuantileSketch::quantile(double fraction) const
+{
+  if (fraction <= 0)
+  {
+    return minValue;
+  }
+  if (fraction >= 1)
+  {
+    return maxValue;
+  }
+
+  std::vector<std::pair<long, std::uint64_t>> weighted;
+  weighted.reserve(retainedCount);
+  for (std::size_t level = 0; level < levels.size(); level++)
+  {
+    for (long value : levels[level])
+    {
+      weighted.emplace_back(value, std::uint64_t{1} << level);
+    }
+  }
+  std::sort(weighted.begin(), weighted.end());
+
+  // Compaction keeps the total weight equal to the count.
+  double rank = fraction * static_cast<double>(total);
+  std::uint64_t seen = 0;
+  for (const auto &[value, weight] : weighted)
+  {
+    seen += weight;
+    if (static_cast<double>(seen) >= rank)
+    {
+      return value;
+    }
+  }
+
+  return maxValue;
+}
+
+double quantile_rank_error(unsigned size)
+{
+  return 2.296 / std::pow(static_cast<double>(std::max(size, 2U)), 0.9723);
+}
+
+QuantileSketch sketch_samples(
+    unsigned long samples,
+    unsigned size,
+    const std::function<void(std::span<long>)> &sample
+)
+{
+  constexpr unsigned long batchSize = 1 << 16;
+  auto &threadPool = shared_thread_pool();
+  std::size_t shards = std::max<std::size_t>(
+      1, std::min<unsigned long>(threadPool.size(), samples)
+  );
+
+  std::vector<QuantileSketch> sketches;
+  sketches.reserve(shards);
+  for (std::size_t shard = 0; shard < shards; shard++)
+  {
+    sketches.emplace_back(size, shard);
+  }
+
+  threadPool.parallelFor(shards, [&](std::size_t shard) {
+    unsigned long remaining = samples / shards + (shard < samples % shards);
+    std::vector<long> batch(std::min(remaining, batchSize));
+    while (remaining > 0)
+    {
+      std::span<long> results(batch.data(), std::min(remaining, batchSize));
+      sample(results);
+      sketches[shard].add(results);
+      remaining -= results.size();
+    }
+  });
+
+  for (std::size_t shard = 1; shard < shards; shard++)
+  {
+    sketches[0].merge(sketches[shard]);
+  }
+  return std::move(sketches[0]);
+}
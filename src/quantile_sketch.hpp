@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <vector>
+
+// Default accuracy parameter of quantile sketches.
+constexpr unsigned defaultQuantileSketchSize = 200;
+
+// KLL sketch (Karnin, Lang and Liberty) of a stream of results. Level h
+// keeps results which each stand for 2^h of the stream; a full level is
+// sorted and every other result, from a random end, is promoted to the next
+// level. Levels shrink geometrically by 2/3 below the top one, which keeps
+// about 3k results, plus at most two per level with one level per doubling
+// of the stream beyond k. That is a few kilobytes however many results are
+// added and however widely they range.
+class QuantileSketch
+{
+private:
+  unsigned k;
+  std::vector<std::vector<long>> levels;
+  std::size_t retainedCount = 0;
+  std::size_t capacity = 0;
+  std::uint64_t total = 0;
+  long minValue = 0;
+  long maxValue = 0;
+  std::uint64_t coins;
+
+  std::size_t levelCapacity(std::size_t level) const;
+  void addLevel();
+  void compress();
+
+public:
+  // Larger `size`s are more accurate and take proportionally more memory.
+  // The seed only decides which end of each compaction is promoted.
+  explicit QuantileSketch(
+      unsigned size = defaultQuantileSketchSize,
+      std::uint64_t seed = 0
+  );
+
+  void add(long value);
+  void add(std::span<const long> values);
+  // Adds everything `other` has seen, as if it had been added here.
+  void merge(const QuantileSketch &other);
+
+  std::uint64_t count() const;
+  std::size_t retained() const;
+  // A result whose rank among everything added is within
+  // quantile_rank_error() of `fraction`. Fraction 0 and 1 give the exact
+  // smallest and largest results. Must not be called on an empty sketch.
+  long quantile(double fraction) const;
+};
+
+// Bound on the error in rank, as a fraction of the count, of any one
+// quantile from a sketch of `size`, holding with 99% confidence. This is
+// the empirical bound measured for the same design in Apache DataSketches,
+// 1.3% at the default size.
+double quantile_rank_error(unsigned size);
+
+// Draws `samples` results by calling `sample` on every thread of the shared
+// pool, each thread filling its own sketch without any locking, and merges
+// the sketches at the end.
+QuantileSketch sketch_samples(
+    unsigned long samples,
+    unsigned size,
+    const std::function<void(std::span<long>)> &sample
+);
@@ -28,9 +28,11 @@ inline std::mt19937 generate()
   return std::mt19937{ss};
 }
 
-inline std::mt19937 mt{generate()};
+// Each thread has its own generator, so expressions may be evaluated on
+// several threads at once.
+inline thread_local std::mt19937 mt{generate()};
 
-unsigned long get(unsigned long min, unsigned long max)
+inline unsigned long get(unsigned long min, unsigned long max)
 {
   return std::uniform_int_distribution<unsigned long>{min, max}(mt);
 }
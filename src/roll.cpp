@@ -0,0 +1,811 @@
+#include "roll.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <climits>
+#include <cmath>
+#include <functional>
+#include <utility>
+
+// Dice with at most this many faces are kept with a per-face count.
+constexpr unsigned long maxCountedFaces = 1 << 16;
+// Pools of at most this many dice which keep some of them are sorted on the
+// stack with a sorting network.
+constexpr unsigned long maxNetworkDice = 16;
+// Pools with fewer dice than this are not worth handing off to other threads.
+constexpr unsigned long parallelDieThreshold = 1 << 20;
+// Smallest number of dice rolled by one parallel chunk.
+constexpr unsigned long minChunkDice = 1 << 18;
+// Chunks per pool thread, so that work stealing can even out slow threads.
+constexpr unsigned long chunksPerThread = 4;
+
+// Estimated costs, in nanoseconds, from which plan_roll() ranks strategies.
+constexpr double uniformDrawNanoseconds = 4;
+constexpr double explodingDrawNanoseconds = 25;
+constexpr double traceLineNanoseconds = 40;
+// Adding a die to a count or comparing it with the top of a heap.
+constexpr double keepStepNanoseconds = 1;
+// Clearing and scanning one face's count.
+constexpr double faceCountNanoseconds = 1;
+// One sift of a die through a heap level.
+constexpr double heapLevelNanoseconds = 2;
+// One compare-exchange of a sorting network, or one step of tracking the
+// lowest and highest dice.
+constexpr double comparatorNanoseconds = 0.5;
+// Setting up and drawing from a binomial or negative binomial distribution.
+constexpr double distributionDrawNanoseconds = 100;
+// Handing chunks to the thread pool and waiting for them.
+constexpr double parallelOverheadNanoseconds = 50000;
+
+// Calls `visit` with each comparator, as the pair of indices it orders, of
+// Batcher's odd-even merge sort of `n` elements, `n` being a power of two.
+template <typename Visit>
+constexpr void visit_batcher_network(std::size_t n, Visit visit)
+{
+  for (std::size_t p = 1; p < n; p *= 2)
+  {
+    for (std::size_t k = p; k >= 1; k /= 2)
+    {
+      for (std::size_t j = k % p; j + k < n; j += 2 * k)
+      {
+        for (std::size_t i = 0; i < k && i + j + k < n; i++)
+        {
+          if ((i + j) / (2 * p) == (i + j + k) / (2 * p))
+          {
+            visit(i + j, i + j + k);
+          }
+        }
+      }
+    }
+  }
+}
+
+constexpr std::size_t batcher_network_size(std::size_t n)
+{
+  std::size_t size = 0;
+  visit_batcher_network(n, [&](std::size_t, std::size_t) { size++; });
+  return size;
+}
+
+struct Comparator
+{
+  std::uint8_t low;
+  std::uint8_t high;
+};
+
+template <std::size_t N>
+constexpr std::array<Comparator, batcher_network_size(N)> batcher_network()
+{
+  std::array<Comparator, batcher_network_size(N)> network{};
+  std::size_t next = 0;
+  visit_batcher_network(N, [&](std::size_t low, std::size_t high) {
+    network[next++] = {
+        .low = static_cast<std::uint8_t>(low),
+        .high = static_cast<std::uint8_t>(high),
+    };
+  });
+  return network;
+}
+
+template <std::size_t N>
+constexpr std::array<Comparator, batcher_network_size(N)> batcherNetwork =
+    batcher_network<N>();
+
+// Sorts `dice` ascending. Every comparator is unrolled with constant indices,
+// and std::min and std::max compile to conditional moves, so the dice stay
+// in registers and the sort never branches on their values.
+template <std::size_t N, std::size_t... I>
+void sort_dice_network(
+    std::array<unsigned long, N> &dice,
+    std::index_sequence<I...>
+)
+{
+  (
+      [&] {
+        constexpr Comparator comparator = batcherNetwork<N>[I];
+        unsigned long low = dice[comparator.low];
+        unsigned long high = dice[comparator.high];
+        dice[comparator.low] = std::min(low, high);
+        dice[comparator.high] = std::max(low, high);
+      }(),
+      ...
+  );
+}
+
+// Whether a small pool keeps, or discards, exactly one die, so that only its
+// lowest and highest dice are needed.
+bool keeps_extreme_die(const Pool &pool)
+{
+  return pool.keepCount == 1 || pool.die - pool.keepCount == 1;
+}
+
+// The smallest power of two elements, of at least 4, which a small pool's
+// dice are padded to for its sorting network.
+std::size_t sorting_network_width(const Pool &pool)
+{
+  return pool.die <= 4 ? 4 : pool.die <= 8 ? 8 : maxNetworkDice;
+}
+
+std::size_t sorting_network_comparators(const Pool &pool)
+{
+  if (keeps_extreme_die(pool))
+  {
+    return pool.die;
+  }
+
+  switch (sorting_network_width(pool))
+  {
+  case 4:
+    return batcher_network_size(4);
+  case 8:
+    return batcher_network_size(8);
+  default:
+    return batcher_network_size(maxNetworkDice);
+  }
+}
+
+// Keeps the highest or lowest `keepCount` of a pool of at most N dice. The
+// padding sorts below every die when keeping the highest, and above every
+// die when keeping the lowest, so it is never kept.
+template <std::size_t N, typename RollDie>
+long roll_network_pool(const Pool &pool, RollDie rollDie)
+{
+  bool highest = pool.keepMode == KeepMode::Highest;
+  std::array<unsigned long, N> dice;
+  dice.fill(highest ? 0 : ULONG_MAX);
+  for (unsigned long i = 0; i < pool.die; i++)
+  {
+    dice[i] = rollDie();
+  }
+
+  sort_dice_network(dice, std::make_index_sequence<batcherNetwork<N>.size()>());
+
+  std::size_t first = highest ? N - pool.keepCount : 0;
+  unsigned long sum = 0;
+  for (std::size_t i = first; i < first + pool.keepCount; i++)
+  {
+    sum += dice[i];
+  }
+  return static_cast<long>(sum);
+}
+
+// Keeps or discards the single highest or lowest die of a small pool by
+// tracking the lowest, highest and total of its dice.
+template <typename RollDie>
+long roll_extreme_pool(const Pool &pool, RollDie rollDie)
+{
+  unsigned long lowest = ULONG_MAX;
+  unsigned long highest = 0;
+  unsigned long total = 0;
+  for (unsigned long i = 0; i < pool.die; i++)
+  {
+    unsigned long roll = rollDie();
+    lowest = std::min(lowest, roll);
+    highest = std::max(highest, roll);
+    total += roll;
+  }
+
+  bool keepHighest = pool.keepMode == KeepMode::Highest;
+  if (pool.keepCount == 1)
+  {
+    return static_cast<long>(keepHighest ? highest : lowest);
+  }
+  return static_cast<long>(total - (keepHighest ? lowest : highest));
+}
+
+template <typename RollDie>
+long roll_small_pool(const Pool &pool, RollDie rollDie)
+{
+  if (keeps_extreme_die(pool))
+  {
+    return roll_extreme_pool(pool, rollDie);
+  }
+
+  switch (sorting_network_width(pool))
+  {
+  case 4:
+    return roll_network_pool<4>(pool, rollDie);
+  case 8:
+    return roll_network_pool<8>(pool, rollDie);
+  default:
+    return roll_network_pool<maxNetworkDice>(pool, rollDie);
+  }
+}
+
+RollPlan plan_roll(const Pool &pool, bool traced)
+{
+  auto die = static_cast<double>(pool.die);
+  double draw =
+      pool.explode ? explodingDrawNanoseconds : uniformDrawNanoseconds;
+
+  if (pool.target != 0)
+  {
+    if (traced)
+    {
+      return {
+          .strategy = RollStrategy::TracedDice,
+          .countFaces = false,
+          .nanoseconds = die * (draw + traceLineNanoseconds),
+          .bytes = 0,
+      };
+    }
+    return {
+        .strategy = RollStrategy::Binomial,
+        .countFaces = false,
+        .nanoseconds = distributionDrawNanoseconds,
+        .bytes = 0,
+    };
+  }
+
+  // Keeping no dice always sums to 0, so only a trace needs the dice.
+  if (pool.keepMode != KeepMode::None && pool.keepCount == 0)
+  {
+    if (traced)
+    {
+      return {
+          .strategy = RollStrategy::TracedDice,
+          .countFaces = false,
+          .nanoseconds = die * (draw + traceLineNanoseconds),
+          .bytes = 0,
+      };
+    }
+    return {
+        .strategy = RollStrategy::Constant,
+        .countFaces = false,
+        .nanoseconds = 0,
+        .bytes = 0,
+    };
+  }
+
+  // Finding the kept dice: a heap only ever holds the kept or the discarded
+  // dice, whichever there are fewer of, and a die displaces one of them
+  // about s (1 + ln(n / s)) times in a stream of n.
+  bool keepsAll = pool.keepMode == KeepMode::None || pool.keepCount >= pool.die;
+  RollPlan plan = {
+      .strategy = RollStrategy::Sum,
+      .countFaces = false,
+      .nanoseconds = die * draw,
+      .bytes = 0,
+  };
+  if (!keepsAll)
+  {
+    auto selected = static_cast<double>(
+        std::min(pool.keepCount, pool.die - pool.keepCount)
+    );
+    double heapNanoseconds =
+        die * keepStepNanoseconds + selected * (1 + std::log(die / selected)) *
+                                        std::log2(selected + 1) *
+                                        heapLevelNanoseconds;
+    double countNanoseconds = die * keepStepNanoseconds +
+                              static_cast<double>(pool.faces) *
+                                  faceCountNanoseconds;
+
+    // Exploding dice can exceed the number of faces, so they are never
+    // counted.
+    plan.countFaces = !pool.explode && pool.faces <= maxCountedFaces &&
+                      countNanoseconds < heapNanoseconds;
+    plan.strategy =
+        plan.countFaces ? RollStrategy::FaceCounts : RollStrategy::Selection;
+    plan.nanoseconds += plan.countFaces ? countNanoseconds : heapNanoseconds;
+    plan.bytes = plan.countFaces
+                     ? pool.faces * sizeof(unsigned long)
+                     : static_cast<std::size_t>(selected) *
+                           sizeof(unsigned long);
+  }
+  else if (pool.explode)
+  {
+    plan.strategy = RollStrategy::NegativeBinomial;
+    plan.nanoseconds =
+        distributionDrawNanoseconds + die * uniformDrawNanoseconds;
+  }
+
+  if (!keepsAll && pool.die <= maxNetworkDice)
+  {
+    plan.strategy = RollStrategy::SortingNetwork;
+    plan.countFaces = false;
+    plan.nanoseconds = die * draw + static_cast<double>(
+                                        sorting_network_comparators(pool)
+                                    ) * comparatorNanoseconds;
+    plan.bytes = 0;
+  }
+
+  // A trace has to be written in roll order, so traced pools are rolled on
+  // one thread.
+  if (traced)
+  {
+    plan.strategy = RollStrategy::TracedDice;
+    plan.nanoseconds = die * (draw + traceLineNanoseconds) + plan.nanoseconds;
+    return plan;
+  }
+
+  if (pool.die < parallelDieThreshold)
+  {
+    return plan;
+  }
+  auto threads = static_cast<double>(shared_thread_pool().size());
+  if (threads > 1)
+  {
+    double parallelNanoseconds =
+        plan.nanoseconds / threads + parallelOverheadNanoseconds;
+    if (parallelNanoseconds < plan.nanoseconds)
+    {
+      plan.strategy = RollStrategy::Parallel;
+      plan.nanoseconds = parallelNanoseconds;
+      plan.bytes *= static_cast<std::size_t>(threads) * chunksPerThread;
+    }
+  }
+
+  return plan;
+}
+
+std::string_view roll_strategy_name(RollStrategy strategy)
+{
+  switch (strategy)
+  {
+  case RollStrategy::TracedDice:
+    return "traced dice";
+  case RollStrategy::Sum:
+    return "sum";
+  case RollStrategy::FaceCounts:
+    return "face counts";
+  case RollStrategy::Selection:
+    return "heap selection";
+  case RollStrategy::SortingNetwork:
+    return "sorting network";
+  case RollStrategy::Parallel:
+    return "parallel chunks";
+  case RollStrategy::Binomial:
+    return "binomial draw";
+  case RollStrategy::NegativeBinomial:
+    return "negative binomial draw";
+  case RollStrategy::Constant:
+    return "constant";
+  }
+
+  return "unknown";
+}
+
+KeptDiceAccumulator::KeptDiceAccumulator(const Pool &p)
+    : KeptDiceAccumulator(p, plan_roll(p, false).countFaces)
+{
+}
+
+KeptDiceAccumulator::KeptDiceAccumulator(const Pool &p, bool countFaces)
+    : pool{p}
+{
+  if (keepsAll())
+  {
+    return;
+  }
+
+  if (countFaces && !pool.explode)
+  {
+    faceCounts.assign(pool.faces, 0);
+    return;
+  }
+
+  unsigned long discarded = pool.die - pool.keepCount;
+  selectedAreKept = pool.keepCount <= discarded;
+  selectedCapacity = selectedAreKept ? pool.keepCount : discarded;
+  selectLargest = (pool.keepMode == KeepMode::Highest) == selectedAreKept;
+}
+
+template <typename Compare>
+void select_into_heap(
+    std::vector<unsigned long> &heap,
+    std::size_t capacity,
+    unsigned long roll,
+    Compare compare
+)
+{
+  if (heap.size() < capacity)
+  {
+    heap.push_back(roll);
+    std::push_heap(heap.begin(), heap.end(), compare);
+    return;
+  }
+
+  if (compare(roll, heap.front()))
+  {
+    std::pop_heap(heap.begin(), heap.end(), compare);
+    heap.back() = roll;
+    std::push_heap(heap.begin(), heap.end(), compare);
+  }
+}
+
+void KeptDiceAccumulator::select(unsigned long roll)
+{
+  // When selecting the largest dice the heap is a min-heap, so its front is
+  // the first to be displaced, and vice versa.
+  if (selectLargest)
+  {
+    select_into_heap(
+        selected, selectedCapacity, roll, std::greater<unsigned long>()
+    );
+  }
+  else
+  {
+    select_into_heap(
+        selected, selectedCapacity, roll, std::less<unsigned long>()
+    );
+  }
+}
+
+void KeptDiceAccumulator::merge(const KeptDiceAccumulator &other)
+{
+  total += other.total;
+
+  for (std::size_t i = 0; i < faceCounts.size(); i++)
+  {
+    faceCounts[i] += other.faceCounts[i];
+  }
+
+  // The overall largest (or smallest) n dice are among each part's n.
+  for (unsigned long roll : other.selected)
+  {
+    select(roll);
+  }
+}
+
+long KeptDiceAccumulator::sum() const
+{
+  if (keepsAll())
+  {
+    return total;
+  }
+
+  if (!faceCounts.empty())
+  {
+    long sum = 0;
+    unsigned long remaining = pool.keepCount;
+    for (unsigned long i = 0; i < pool.faces && remaining > 0; i++)
+    {
+      unsigned long face =
+          pool.keepMode == KeepMode::Highest ? pool.faces - i : i + 1;
+      unsigned long taken = std::min(remaining, faceCounts[face - 1]);
+      sum += static_cast<long>(taken * face);
+      remaining -= taken;
+    }
+
+    return sum;
+  }
+
+  long selectedSum = 0;
+  for (unsigned long roll : selected)
+  {
+    selectedSum += static_cast<long>(roll);
+  }
+
+  return selectedAreKept ? selectedSum : total - selectedSum;
+}
+
+void KeptDiceAccumulator::clear()
+{
+  total = 0;
+  std::fill(faceCounts.begin(), faceCounts.end(), 0);
+  selected.clear();
+}
+
+// One exploding die. The number of times it shows its highest face is
+// geometric, and the roll which ends the chain is uniform over the others.
+class ExplodingDie
+{
+private:
+  unsigned long faces;
+  std::geometric_distribution<unsigned long> explosions;
+  std::uniform_int_distribution<unsigned long> last;
+
+public:
+  explicit ExplodingDie(unsigned long f)
+      : faces{f},
+        explosions{static_cast<double>(f - 1) / static_cast<double>(f)},
+        last{1, f - 1}
+  {
+  }
+
+  unsigned long operator()(std::mt19937 &rng)
+  {
+    return faces * explosions(rng) + last(rng);
+  }
+};
+
+// Sum of `count` exploding dice. The explosions of the whole pool follow a
+// negative binomial distribution, so they are drawn at once.
+unsigned long roll_exploding_total(
+    unsigned long count,
+    unsigned long faces,
+    std::mt19937 &rng
+)
+{
+  if (count == 0)
+  {
+    return 0;
+  }
+
+  double p = static_cast<double>(faces - 1) / static_cast<double>(faces);
+  std::negative_binomial_distribution<unsigned long> explosions(count, p);
+  std::uniform_int_distribution<unsigned long> last(1, faces - 1);
+
+  unsigned long total = faces * explosions(rng);
+  for (unsigned long i = 0; i < count; i++)
+  {
+    total += last(rng);
+  }
+
+  return total;
+}
+
+template <typename RollDie, typename Accumulator>
+void roll_each_die(
+    unsigned long count,
+    RollDie rollDie,
+    Accumulator &accumulator,
+    TraceSink *trace
+)
+{
+  if (trace == nullptr)
+  {
+    for (unsigned long i = 0; i < count; i++)
+    {
+      accumulator.add(rollDie());
+    }
+    return;
+  }
+
+  constexpr std::string_view prefix = "You rolled: ";
+  char line[64];
+  prefix.copy(line, prefix.size());
+
+  for (unsigned long i = 0; i < count; i++)
+  {
+    unsigned long roll = rollDie();
+    char *end =
+        std::to_chars(line + prefix.size(), line + sizeof(line) - 1, roll).ptr;
+    *end++ = '\n';
+    trace->write(std::string_view(line, end - line));
+    accumulator.add(roll);
+  }
+}
+
+// Rolls `count` of the dice of `pool` into `accumulator`.
+void roll_dice(
+    const Pool &pool,
+    unsigned long count,
+    std::mt19937 &rng,
+    KeptDiceAccumulator &accumulator,
+    TraceSink *trace
+)
+{
+  if (!pool.explode)
+  {
+    std::uniform_int_distribution<unsigned long> distribution(1, pool.faces);
+    roll_each_die(
+        count, [&] { return distribution(rng); }, accumulator, trace
+    );
+    return;
+  }
+
+  if (trace == nullptr && accumulator.keepsAll())
+  {
+    accumulator.addTotal(roll_exploding_total(count, pool.faces, rng));
+    return;
+  }
+
+  ExplodingDie die(pool.faces);
+  roll_each_die(count, [&] { return die(rng); }, accumulator, trace);
+}
+
+double success_probability(const Pool &pool)
+{
+  if (pool.target <= 1)
+  {
+    return 1;
+  }
+
+  double f = static_cast<double>(pool.faces);
+  if (!pool.explode)
+  {
+    return pool.target > pool.faces
+               ? 0
+               : static_cast<double>(pool.faces - pool.target + 1) / f;
+  }
+
+  // An exploding die reaches faces * k + r (1 <= r <= faces) after exactly k
+  // explosions followed by a roll of at least r.
+  unsigned long explosions = (pool.target - 1) / pool.faces;
+  unsigned long rest = (pool.target - 1) % pool.faces + 1;
+  return std::pow(f, -static_cast<double>(explosions)) *
+         static_cast<double>(pool.faces - rest + 1) / f;
+}
+
+// Number of dice rolled at or above a target.
+struct SuccessCounter
+{
+  unsigned long target;
+  long count = 0;
+
+  void add(unsigned long roll) { count += roll >= target ? 1 : 0; }
+};
+
+// Rolls each die of a success counting pool, so that the trace can show it.
+long roll_successes(const Pool &pool, std::mt19937 &rng, TraceSink *trace)
+{
+  SuccessCounter counter{.target = pool.target};
+
+  if (pool.explode)
+  {
+    ExplodingDie die(pool.faces);
+    roll_each_die(pool.die, [&] { return die(rng); }, counter, trace);
+  }
+  else
+  {
+    std::uniform_int_distribution<unsigned long> distribution(1, pool.faces);
+    roll_each_die(
+        pool.die, [&] { return distribution(rng); }, counter, trace
+    );
+  }
+
+  return counter.count;
+}
+
+// Rolls a pool planned as a RollStrategy::SortingNetwork, without touching
+// the heap.
+long roll_sorting_network(const Pool &pool, std::mt19937 &rng)
+{
+  if (pool.explode)
+  {
+    ExplodingDie die(pool.faces);
+    return roll_small_pool(pool, [&] { return die(rng); });
+  }
+
+  std::uniform_int_distribution<unsigned long> distribution(1, pool.faces);
+  return roll_small_pool(pool, [&] { return distribution(rng); });
+}
+
+long roll_pool(const Pool &pool, std::mt19937 &rng, TraceSink *trace)
+{
+  auto plan = plan_roll(pool, trace != nullptr);
+
+  if (pool.target != 0 && plan.strategy == RollStrategy::TracedDice)
+  {
+    return roll_successes(pool, rng, trace);
+  }
+  if (plan.strategy == RollStrategy::Constant)
+  {
+    return 0;
+  }
+  if (plan.strategy == RollStrategy::Binomial)
+  {
+    std::binomial_distribution<unsigned long> successes(
+        pool.die, success_probability(pool)
+    );
+    return static_cast<long>(successes(rng));
+  }
+  if (plan.strategy == RollStrategy::SortingNetwork)
+  {
+    return roll_sorting_network(pool, rng);
+  }
+
+  KeptDiceAccumulator accumulator(pool, plan.countFaces);
+
+  if (plan.strategy != RollStrategy::Parallel)
+  {
+    roll_dice(pool, pool.die, rng, accumulator, trace);
+    return accumulator.sum();
+  }
+
+  auto &threadPool = shared_thread_pool();
+  unsigned long chunks = std::max(
+      2UL,
+      std::min(pool.die / minChunkDice, threadPool.size() * chunksPerThread)
+  );
+
+  // Each chunk gets its own generator seeded from the caller's generator and
+  // the chunk's index, so the result does not depend on thread scheduling.
+  std::uint32_t streamSeed[] = {
+      static_cast<std::uint32_t>(rng()), static_cast<std::uint32_t>(rng())
+  };
+
+  std::vector<KeptDiceAccumulator> partials(chunks, accumulator);
+  threadPool.parallelFor(chunks, [&](std::size_t chunk) {
+    unsigned long first = pool.die / chunks * chunk;
+    unsigned long last =
+        chunk + 1 == chunks ? pool.die : pool.die / chunks * (chunk + 1);
+
+    std::seed_seq seeds{
+        streamSeed[0],
+        streamSeed[1],
+        static_cast<std::uint32_t>(chunk),
+        static_cast<std::uint32_t>(chunk >> 32)
+    };
+    std::mt19937 chunkRng(seeds);
+
+    roll_dice(pool, last - first, chunkRng, partials[chunk], nullptr);
+  });
+
+  for (std::size_t chunk = 0; chunk < chunks; chunk++)
+  {
+    accumulator.merge(partials[chunk]);
+  }
+
+  return accumulator.sum();
+}
+
+void roll_pool_many(
+    const Pool &pool,
+    std::mt19937 &rng,
+    std::span<long> results
+)
+{
+  auto plan = plan_roll(pool, false);
+
+  if (plan.strategy == RollStrategy::Constant)
+  {
+    std::fill(results.begin(), results.end(), 0);
+    return;
+  }
+
+  if (plan.strategy == RollStrategy::Binomial)
+  {
+    std::binomial_distribution<unsigned long> successes(
+        pool.die, success_probability(pool)
+    );
+    for (long &result : results)
+    {
+      result = static_cast<long>(successes(rng));
+    }
+    return;
+  }
+
+  if (plan.strategy == RollStrategy::Parallel)
+  {
+    for (long &result : results)
+    {
+      result = roll_pool(pool, rng, nullptr);
+    }
+    return;
+  }
+
+  if (plan.strategy == RollStrategy::SortingNetwork)
+  {
+    for (long &result : results)
+    {
+      result = roll_sorting_network(pool, rng);
+    }
+    return;
+  }
+
+  if (plan.strategy == RollStrategy::NegativeBinomial)
+  {
+    for (long &result : results)
+    {
+      result =
+          static_cast<long>(roll_exploding_total(pool.die, pool.faces, rng));
+    }
+    return;
+  }
+
+  if (plan.strategy == RollStrategy::Sum)
+  {
+    std::uniform_int_distribution<unsigned long> distribution(1, pool.faces);
+    for (long &result : results)
+    {
+      unsigned long sum = 0;
+      for (unsigned long i = 0; i < pool.die; i++)
+      {
+        sum += distribution(rng);
+      }
+      result = static_cast<long>(sum);
+    }
+    return;
+  }
+
+  KeptDiceAccumulator accumulator(pool, plan.countFaces);
+  for (long &result : results)
+  {
+    accumulator.clear();
+    roll_dice(pool, pool.die, rng, accumulator, nullptr);
+    result = accumulator.sum();
+  }
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include "trace.hpp"
+#include <cstdint>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class KeepMode : std::uint32_t
+{
+  None,
+  Highest,
+  Lowest
+};
+
+// `die` rolls of a `faces`-sided die, keeping `keepCount` of them if
+// `keepMode` is not None. Exploding dice roll again, and add the new roll,
+// every time they show their highest face. A pool with a non-zero `target`
+// counts the dice showing at least `target` instead of summing them.
+struct Pool
+{
+  unsigned long die;
+  unsigned long faces;
+  KeepMode keepMode;
+  unsigned long keepCount;
+  bool explode = false;
+  unsigned long target = 0;
+};
+
+// The chance that one die of `pool` shows at least its target.
+double success_probability(const Pool &pool);
+
+// How roll_pool() and roll_pool_many() roll a pool.
+enum class RollStrategy
+{
+  // Each die rolled one at a time and written to the trace.
+  TracedDice,
+  // Each die rolled and summed, for pools which keep every die.
+  Sum,
+  // Each die rolled, and the kept dice found from a count per face.
+  FaceCounts,
+  // Each die rolled, and the kept (or discarded) dice selected with a heap.
+  Selection,
+  // Each die of a small pool rolled onto the stack and sorted with a
+  // branchless sorting network, or only its lowest and highest tracked.
+  SortingNetwork,
+  // Chunks of dice rolled on the shared thread pool and merged.
+  Parallel,
+  // Success counts drawn from a binomial distribution.
+  Binomial,
+  // Exploding dice whose explosions are drawn at once from a negative
+  // binomial distribution.
+  NegativeBinomial,
+  // Pools which keep no dice, whose result is always 0, left unrolled.
+  Constant
+};
+
+// The cheapest correct way to roll a pool, with its estimated cost.
+struct RollPlan
+{
+  RollStrategy strategy;
+  // Whether kept dice are found from per-face counts rather than a heap.
+  bool countFaces;
+  // Estimated time and memory to roll the pool once.
+  double nanoseconds;
+  std::size_t bytes;
+};
+
+// Plans a roll of a non-empty pool, with a trace if `traced`. The estimates
+// are rough, from per-die costs measured on a typical desktop processor, but
+// they rank the strategies correctly.
+RollPlan plan_roll(const Pool &pool, bool traced);
+
+std::string_view roll_strategy_name(RollStrategy strategy);
+
+// Running sum of the dice a pool keeps, in memory bounded by the number of
+// faces (or by the smaller of the kept and discarded counts for dice with a
+// very large number of faces) rather than by the number of dice.
+// Accumulators over disjoint parts of a pool can be merged.
+class KeptDiceAccumulator
+{
+private:
+  Pool pool;
+  long total = 0;
+  std::vector<unsigned long> faceCounts;
+  // Heap of the largest (or smallest) dice seen, which are either the kept
+  // dice or the discarded ones, whichever there are fewer of.
+  std::vector<unsigned long> selected;
+  std::size_t selectedCapacity = 0;
+  bool selectedAreKept = true;
+  bool selectLargest = true;
+
+  void select(unsigned long roll);
+
+public:
+  // Counts faces or selects with a heap as plan_roll() chooses.
+  explicit KeptDiceAccumulator(const Pool &p);
+  KeptDiceAccumulator(const Pool &p, bool countFaces);
+
+  void add(unsigned long roll)
+  {
+    total += static_cast<long>(roll);
+
+    if (!faceCounts.empty())
+    {
+      faceCounts[roll - 1]++;
+    }
+    else if (selectedCapacity > 0)
+    {
+      select(roll);
+    }
+  }
+
+  // Whether every die of the pool is kept, so that only the total matters.
+  bool keepsAll() const
+  {
+    return pool.keepMode == KeepMode::None || pool.keepCount >= pool.die;
+  }
+
+  // Adds several dice at once, for pools which keep every die.
+  void addTotal(unsigned long rolls) { total += static_cast<long>(rolls); }
+
+  void merge(const KeptDiceAccumulator &other);
+  long sum() const;
+  // Forgets every die added so far, keeping the allocated storage.
+  void clear();
+};
+
+// Rolls every die of `pool` with `rng` as plan_roll() chooses and returns
+// the kept sum, writing a line per die to `trace` if there is one. Large
+// pools without a trace may be split into chunks which are rolled in
+// parallel, each from its own RNG stream seeded from `rng`. Explosions are
+// drawn rather than rolled one by one, so exploding pools take no longer
+// however often their dice explode. Success counts without a trace are drawn
+// from a binomial distribution in constant expected time.
+long roll_pool(const Pool &pool, std::mt19937 &rng, TraceSink *trace);
+
+// Rolls `pool` once for each element of `results`, reusing one accumulator
+// across the samples.
+void roll_pool_many(
+    const Pool &pool,
+    std::mt19937 &rng,
+    std::span<long> results
+);
@@ -0,0 +1,231 @@
+#include "summary.hpp"
+#include "dice_exception.hpp"
+#include <cctype>
+#include <cstring>
+
+constexpr char summaryMagic[8] = {'D', 'I', 'C', 'E', 'S', 'U', 'M', 'M'};
+constexpr std::uint32_t summaryVersion = 1;
+
+struct SummaryHeader
+{
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t reserved;
+  std::uint64_t expressionHash;
+  std::uint64_t sampleCount;
+  double mean;
+  double m2;
+  std::uint64_t resultCount;
+};
+
+struct SummaryRecord
+{
+  std::int64_t result;
+  std::uint64_t count;
+};
+
+static_assert(sizeof(SummaryHeader) == 56);
+static_assert(sizeof(SummaryRecord) == 16);
+
+Moments Moments::of(std::span<const long> results)
+{
+  Moments moments = {.count = results.size()};
+  if (results.empty())
+  {
+    return moments;
+  }
+
+  // Two passes over the batch, so its own deviations are taken from its
+  // exact mean.
+  double sum = 0;
+  for (long result : results)
+  {
+    sum += static_cast<double>(result);
+  }
+  moments.mean = sum / static_cast<double>(results.size());
+  for (long result : results)
+  {
+    double deviation = static_cast<double>(result) - moments.mean;
+    moments.m2 += deviation * deviation;
+  }
+
+  return moments;
+}
+
+void Moments::merge(const Moments &other)
+{
+  if (other.count == 0)
+  {
+    return;
+  }
+  if (count == 0)
+  {
+    *this = other;
+    return;
+  }
+
+  auto n = static_cast<double>(count);
+  auto otherN = static_cast<double>(other.count);
+  double total = n + otherN;
+  double delta = other.mean - mean;
+
+  mean += delta * (otherN / total);
+  m2 += other.m2 + delta * delta * (n * otherN / total);
+  count += other.count;
+}
+
+double Moments::variance() const
+{
+  return count == 0 ? 0 : m2 / static_cast<double>(count);
+}
+
+std::uint64_t expression_hash(std::string_view expression)
+{
+  // 64-bit FNV-1a.
+  std::uint64_t hash = 0xcbf29ce484222325ULL;
+  for (char c : expression)
+  {
+    if (std::isspace(static_cast<unsigned char>(c)))
+    {
+      continue;
+    }
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 0x100000001b3ULL;
+  }
+
+  return hash;
+}
+
+SimulationSummary summarize_simulation(
+    std::string_view expression,
+    const Histogram &histogram,
+    const Moments &moments
+)
+{
+  return {
+      .expressionHash = expression_hash(expression),
+      .moments = moments,
+      .counts = histogram.counts(),
+  };
+}
+
+SimulationSummary
+merge_summaries(const SimulationSummary &a, const SimulationSummary &b)
+{
+  if (a.expressionHash != b.expressionHash)
+  {
+    throw DiceException("Cannot merge summaries of different expressions.");
+  }
+
+  SimulationSummary merged = {
+      .expressionHash = a.expressionHash,
+      .moments = a.moments,
+      .counts = {},
+  };
+  merged.moments.merge(b.moments);
+
+  auto left = a.counts.begin();
+  auto right = b.counts.begin();
+  while (left != a.counts.end() || right != b.counts.end())
+  {
+    if (right == b.counts.end() ||
+        (left != a.counts.end() && left->first < right->first))
+    {
+      merged.counts.push_back(*left++);
+    }
+    else if (left == a.counts.end() || right->first < left->first)
+    {
+      merged.counts.push_back(*right++);
+    }
+    else
+    {
+      merged.counts.emplace_back(left->first, left->second + right->second);
+      left++;
+      right++;
+    }
+  }
+
+  return merged;
+}
+
+std::string serialize_summary(const SimulationSummary &summary)
+{
+  SummaryHeader header = {};
+  std::memcpy(header.magic, summaryMagic, sizeof(summaryMagic));
+  header.version = summaryVersion;
+  header.expressionHash = summary.expressionHash;
+  header.sampleCount = summary.moments.count;
+  header.mean = summary.moments.mean;
+  header.m2 = summary.moments.m2;
+  header.resultCount = summary.counts.size();
+
+  std::string bytes;
+  bytes.reserve(
+      sizeof(SummaryHeader) + summary.counts.size() * sizeof(SummaryRecord)
+  );
+  bytes.append(reinterpret_cast<const char *>(&header), sizeof(header));
+  for (const auto &[result, count] : summary.counts)
+  {
+    SummaryRecord record = {.result = result, .count = count};
+    bytes.append(reinterpret_cast<const char *>(&record), sizeof(record));
+  }
+
+  return bytes;
+}
+
+SimulationSummary deserialize_summary(std::string_view bytes)
+{
+  auto invalid = DiceException("Not a valid simulation summary.");
+
+  SummaryHeader header = {};
+  if (bytes.size() < sizeof(header))
+  {
+    throw invalid;
+  }
+  std::memcpy(&header, bytes.data(), sizeof(header));
+  bytes.remove_prefix(sizeof(header));
+
+  if (std::memcmp(header.magic, summaryMagic, sizeof(summaryMagic)) != 0 ||
+      header.version != summaryVersion ||
+      header.resultCount > bytes.size() / sizeof(SummaryRecord) ||
+      bytes.size() != header.resultCount * sizeof(SummaryRecord))
+  {
+    throw invalid;
+  }
+
+  SimulationSummary summary = {
+      .expressionHash = header.expressionHash,
+      .moments =
+          {
+              .count = header.sampleCount,
+              .mean = header.mean,
+              .m2 = header.m2,
+          },
+      .counts = {},
+  };
+  summary.counts.reserve(header.resultCount);
+
+  // Results must be strictly increasing and their counts must add up to the
+  // sample count, so that merging can rely on both.
+  std::uint64_t total = 0;
+  for (std::uint64_t i = 0; i < header.resultCount; i++)
+  {
+    SummaryRecord record = {};
+    std::memcpy(&record, bytes.data() + i * sizeof(record), sizeof(record));
+    bool increasing = summary.counts.empty() ||
+                      record.result > summary.counts.back().first;
+    if (!increasing || record.count == 0 ||
+        record.count > header.sampleCount - total)
+    {
+      throw invalid;
+    }
+    total += record.count;
+    summary.counts.emplace_back(record.result, record.count);
+  }
+  if (total != header.sampleCount)
+  {
+    throw invalid;
+  }
+
+  return summary;
+}
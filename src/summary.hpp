@@ -0,0 +1,55 @@
+#pragma once
+
+#include "histogram.hpp"
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Count, mean and sum of squared deviations from the mean of some results,
+// combined with Chan et al.'s pairwise update so that partial moments merge
+// without the cancellation of summing squares.
+struct Moments
+{
+  std::uint64_t count = 0;
+  double mean = 0;
+  double m2 = 0;
+
+  static Moments of(std::span<const long> results);
+  void merge(const Moments &other);
+  // Population variance, or 0 for no results.
+  double variance() const;
+};
+
+// Everything kept of one simulation run of an expression. Summaries of the
+// same expression merge into the summary of all their samples, in any order
+// and grouping: the histogram and count merge exactly, and the moments to
+// within rounding.
+struct SimulationSummary
+{
+  std::uint64_t expressionHash;
+  Moments moments;
+  // Every result seen with its count, in increasing order of result.
+  std::vector<std::pair<long, unsigned long>> counts;
+};
+
+// Hash identifying an expression in summaries, ignoring whitespace.
+std::uint64_t expression_hash(std::string_view expression);
+
+SimulationSummary summarize_simulation(
+    std::string_view expression,
+    const Histogram &histogram,
+    const Moments &moments
+);
+
+// Throws a DiceException if the summaries are of different expressions.
+SimulationSummary
+merge_summaries(const SimulationSummary &a, const SimulationSummary &b);
+
+// The bytes of a summary file: a fixed header followed by one 16 byte
+// record per distinct result.
+std::string serialize_summary(const SimulationSummary &summary);
+// Throws a DiceException if `bytes` are not a valid summary file.
+SimulationSummary deserialize_summary(std::string_view bytes);
@@ -0,0 +1,158 @@
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <exception>
+
+// Index of the queue owned by the current thread, if it is a pool worker.
+thread_local std::size_t currentWorkerQueue = 0;
+
+ThreadPool::ThreadPool(std::size_t threadCount)
+{
+  threadCount = std::max<std::size_t>(threadCount, 1);
+
+  for (std::size_t i = 0; i < threadCount; i++)
+  {
+    queues.push_back(std::make_unique<WorkerQueue>());
+  }
+  for (std::size_t i = 0; i < threadCount; i++)
+  {
+    threads.emplace_back([this, i] { workerLoop(i); });
+  }
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> guard(sleepMutex);
+    stopping = true;
+  }
+  wake.notify_all();
+
+  for (auto &thread : threads)
+  {
+    thread.join();
+  }
+}
+
+std::size_t ThreadPool::size() const { return threads.size(); }
+
+bool ThreadPool::runOne(std::size_t preferredQueue)
+{
+  std::function<void()> task;
+
+  for (std::size_t i = 0; i < queues.size() && !task; i++)
+  {
+    std::size_t index = (preferredQueue + i) % queues.size();
+    auto &queue = *queues[index];
+
+    std::lock_guard<std::mutex> guard(queue.mutex);
+    if (queue.tasks.empty())
+    {
+      continue;
+    }
+
+    // Own work is taken LIFO (it is the most cache friendly), stolen work
+    // FIFO (it is the oldest and so usually the largest).
+    if (i == 0)
+    {
+      task = std::move(queue.tasks.back());
+      queue.tasks.pop_back();
+    }
+    else
+    {
+      task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+    }
+  }
+
+  if (!task)
+  {
+    return false;
+  }
+
+  queuedTasks--;
+  task();
+  return true;
+}
+
+void ThreadPool::workerLoop(std::size_t index)
+{
+  currentWorkerQueue = index;
+
+  while (true)
+  {
+    if (runOne(index))
+    {
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(sleepMutex);
+    wake.wait(lock, [this] { return stopping || queuedTasks > 0; });
+    if (stopping)
+    {
+      return;
+    }
+  }
+}
+
+void ThreadPool::parallelFor(
+    std::size_t count,
+    const std::function<void(std::size_t)> &body
+)
+{
+  if (count == 0)
+  {
+    return;
+  }
+
+  std::atomic<std::size_t> remaining = count;
+  std::mutex errorMutex;
+  std::exception_ptr error;
+
+  for (std::size_t i = 0; i < count; i++)
+  {
+    auto &queue = *queues[i % queues.size()];
+    std::lock_guard<std::mutex> guard(queue.mutex);
+    queue.tasks.emplace_back([&, i] {
+      try
+      {
+        body(i);
+      }
+      catch (...)
+      {
+        std::lock_guard<std::mutex> errorGuard(errorMutex);
+        if (!error)
+        {
+          error = std::current_exception();
+        }
+      }
+      remaining--;
+    });
+    queuedTasks++;
+  }
+
+  {
+    std::lock_guard<std::mutex> guard(sleepMutex);
+  }
+  wake.notify_all();
+
+  // Help out rather than block, so that a worker calling this cannot starve
+  // the pool of the thread its own tasks need.
+  while (remaining > 0)
+  {
+    if (!runOne(currentWorkerQueue))
+    {
+      std::this_thread::yield();
+    }
+  }
+
+  if (error)
+  {
+    std::rethrow_exception(error);
+  }
+}
+
+ThreadPool &shared_thread_pool()
+{
+  static ThreadPool pool(std::thread::hardware_concurrency());
+  return pool;
+}
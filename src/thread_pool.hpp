@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed size pool of worker threads. Each worker owns a task deque which it
+// works through from the back, and steals from the front of the other
+// workers' deques when its own runs dry.
+class ThreadPool
+{
+private:
+  struct WorkerQueue
+  {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  std::vector<std::unique_ptr<WorkerQueue>> queues;
+  std::vector<std::thread> threads;
+  std::mutex sleepMutex;
+  std::condition_variable wake;
+  std::atomic<std::size_t> queuedTasks = 0;
+  bool stopping = false;
+
+  bool runOne(std::size_t preferredQueue);
+  void workerLoop(std::size_t index);
+
+public:
+  explicit ThreadPool(std::size_t threadCount);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  std::size_t size() const;
+
+  // Calls body(0) ... body(count - 1) across the pool and returns once all
+  // of them have finished, rethrowing the first exception any of them threw.
+  // The calling thread runs tasks while it waits, so this may be nested.
+  void parallelFor(
+      std::size_t count,
+      const std::function<void(std::size_t)> &body
+  );
+};
+
+// Process wide pool with one worker per hardware thread.
+ThreadPool &shared_thread_pool();
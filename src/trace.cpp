@@ -0,0 +1,36 @@
+#include "trace.hpp"
+
+void StringTraceSink::write(std::string_view t) { text += t; }
+
+const std::string &StringTraceSink::str() const { return text; }
+
+StreamTraceSink::StreamTraceSink(std::ostream &s, std::size_t c)
+    : stream{s}, capacity{c}
+{
+  buffer.reserve(capacity);
+}
+
+StreamTraceSink::~StreamTraceSink() { flush(); }
+
+void StreamTraceSink::write(std::string_view text)
+{
+  if (buffer.size() + text.size() > capacity)
+  {
+    flush();
+  }
+
+  if (text.size() >= capacity)
+  {
+    stream.write(text.data(), static_cast<std::streamsize>(text.size()));
+    return;
+  }
+
+  buffer += text;
+}
+
+void StreamTraceSink::flush()
+{
+  stream.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+  stream.flush();
+  buffer.clear();
+}
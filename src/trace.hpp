@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+// Destination for the verbose description of an execution, written to in
+// tree evaluation order as dice are rolled.
+class TraceSink
+{
+public:
+  virtual ~TraceSink() {}
+  virtual void write(std::string_view text) = 0;
+};
+
+// Collects the whole description in memory.
+class StringTraceSink : public TraceSink
+{
+private:
+  std::string text;
+
+public:
+  void write(std::string_view t);
+  const std::string &str() const;
+};
+
+// Writes the description to a stream through a fixed size buffer, so memory
+// use does not grow with the length of the description.
+class StreamTraceSink : public TraceSink
+{
+private:
+  std::ostream &stream;
+  std::string buffer;
+  std::size_t capacity;
+
+public:
+  explicit StreamTraceSink(std::ostream &s, std::size_t c = 1 << 16);
+  ~StreamTraceSink();
+
+  StreamTraceSink(const StreamTraceSink &) = delete;
+  StreamTraceSink &operator=(const StreamTraceSink &) = delete;
+
+  void write(std::string_view text);
+  void flush();
+};
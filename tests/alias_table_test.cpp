@@ -0,0 +1,73 @@
+#include "alias_table.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include <gtest/gtest.h>
+#include <map>
+
+TEST(AliasTable, sample_EveryWordOfAColumn_ReturnsColumnOrAlias)
+{
+  AliasTable table({.offset = 10, .probabilities = {0.25, 0.25, 0.25, 0.25}});
+
+  // A uniform distribution fills every column exactly, so no word reaches
+  // an alias.
+  EXPECT_EQ(10, table.sample(0));
+  EXPECT_EQ(11, table.sample(std::uint64_t{1} << 62));
+  EXPECT_EQ(13, table.sample(UINT64_MAX));
+}
+
+TEST(AliasTable, sampleMany_SkewedDistribution_MatchesProbabilities)
+{
+  Distribution distribution = {
+      .offset = -1,
+      .probabilities = {0.5, 0.0, 0.1, 0.4},
+  };
+  AliasTable table(distribution);
+  std::mt19937 rng(29);
+  std::vector<long> results(200000);
+
+  table.sampleMany(rng, results);
+
+  std::map<long, double> frequencies;
+  for (long result : results)
+  {
+    frequencies[result] += 1.0 / results.size();
+  }
+  EXPECT_NEAR(0.5, frequencies[-1], 0.005);
+  EXPECT_EQ(0, frequencies.count(0));
+  EXPECT_NEAR(0.1, frequencies[1], 0.005);
+  EXPECT_NEAR(0.4, frequencies[2], 0.005);
+}
+
+TEST(AliasTable, build_alias_table_SmallSupport_BuildsTable)
+{
+  auto tree = parse(tokenize("4d6h3"));
+
+  auto table = build_alias_table(*tree, defaultAliasTableBudget);
+
+  ASSERT_TRUE(table.has_value());
+  std::mt19937 rng(31);
+  std::vector<long> results(1000);
+  table->sampleMany(rng, results);
+  for (long result : results)
+  {
+    EXPECT_GE(result, 3);
+    EXPECT_LE(result, 18);
+  }
+}
+
+TEST(AliasTable, build_alias_table_OverBudget_ReturnsNullopt)
+{
+  auto tree = parse(tokenize("3d6"));
+
+  // 16 outcomes need 128 bytes.
+  EXPECT_TRUE(build_alias_table(*tree, 128).has_value());
+  EXPECT_FALSE(build_alias_table(*tree, 127).has_value());
+  EXPECT_FALSE(build_alias_table(*tree, 0).has_value());
+}
+
+TEST(AliasTable, build_alias_table_DistributionTooLarge_ReturnsNullopt)
+{
+  auto tree = parse(tokenize("1000000d1000000"));
+
+  EXPECT_FALSE(build_alias_table(*tree, SIZE_MAX).has_value());
+}
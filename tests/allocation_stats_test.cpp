@@ -0,0 +1,67 @@
+#include "allocation_stats.hpp"
+#include <gtest/gtest.h>
+
+TEST(AllocationStats, record_allocation_InPhase_CountsTowardsPhase)
+{
+  auto before = allocation_counts(AllocationPhase::Parse);
+
+  {
+    AllocationPhaseScope parsing(AllocationPhase::Parse);
+    record_allocation(48);
+    record_allocation(16);
+  }
+  auto after = allocation_counts(AllocationPhase::Parse);
+
+  EXPECT_EQ(2, after.allocations - before.allocations);
+  EXPECT_EQ(64, after.bytes - before.bytes);
+}
+
+TEST(AllocationStats, AllocationPhaseScope_Nested_RestoresPreviousPhase)
+{
+  auto lexBefore = allocation_counts(AllocationPhase::Lex);
+  auto executeBefore = allocation_counts(AllocationPhase::Execute);
+
+  {
+    AllocationPhaseScope lexing(AllocationPhase::Lex);
+    {
+      AllocationPhaseScope executing(AllocationPhase::Execute);
+      record_allocation(8);
+    }
+    record_allocation(8);
+  }
+
+  EXPECT_EQ(
+      1,
+      allocation_counts(AllocationPhase::Lex).allocations -
+          lexBefore.allocations
+  );
+  EXPECT_EQ(
+      1,
+      allocation_counts(AllocationPhase::Execute).allocations -
+          executeBefore.allocations
+  );
+}
+
+TEST(AllocationStats, in_allocation_phase_Body_ReturnsItsResult)
+{
+  auto before = allocation_counts(AllocationPhase::Execute);
+
+  int result = in_allocation_phase(AllocationPhase::Execute, [] {
+    record_allocation(100);
+    return 7;
+  });
+
+  EXPECT_EQ(7, result);
+  EXPECT_EQ(
+      100, allocation_counts(AllocationPhase::Execute).bytes - before.bytes
+  );
+}
+
+TEST(AllocationStats, format_allocation_stats_Counts_ListsEachPhase)
+{
+  auto stats = format_allocation_stats();
+
+  EXPECT_EQ(0, stats.find("allocations: lex="));
+  EXPECT_NE(std::string::npos, stats.find(" parse="));
+  EXPECT_NE(std::string::npos, stats.find(" execute="));
+}
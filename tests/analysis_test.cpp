@@ -0,0 +1,280 @@
+#include "analysis.hpp"
+#include "dice_exception.hpp"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <functional>
+#include <gtest/gtest.h>
+#include <vector>
+
+// Computes the mean & variance of a keep pool by enumerating every outcome.
+TreeAnalysis enumerate_keep_pool(
+    unsigned long die,
+    unsigned long faces,
+    unsigned long keep,
+    bool keepHighest
+)
+{
+  std::vector<long> rolls(die, 1);
+  double count = 0;
+  double sum = 0;
+  double sumOfSquares = 0;
+
+  while (true)
+  {
+    auto sorted = rolls;
+    if (keepHighest)
+    {
+      std::sort(sorted.begin(), sorted.end(), std::greater<long>());
+    }
+    else
+    {
+      std::sort(sorted.begin(), sorted.end());
+    }
+
+    double kept = 0;
+    for (unsigned long i = 0; i < keep; i++)
+    {
+      kept += sorted.at(i);
+    }
+    count++;
+    sum += kept;
+    sumOfSquares += kept * kept;
+
+    unsigned long i = 0;
+    while (i < die && rolls.at(i) == static_cast<long>(faces))
+    {
+      rolls.at(i) = 1;
+      i++;
+    }
+    if (i == die)
+    {
+      break;
+    }
+    rolls.at(i)++;
+  }
+
+  double mean = sum / count;
+  return {
+      .mean = mean,
+      .variance = sumOfSquares / count - mean * mean,
+      .min = 0,
+      .max = 0,
+      .exact = true,
+  };
+}
+
+TEST(Analysis, analyze_uniform_pool_SingleDie_ReturnsUniformMoments)
+{
+  auto result = analyze_uniform_pool(1, 6);
+
+  EXPECT_DOUBLE_EQ(3.5, result.mean);
+  EXPECT_DOUBLE_EQ(35.0 / 12, result.variance);
+  EXPECT_EQ(1, result.min);
+  EXPECT_EQ(6, result.max);
+  EXPECT_TRUE(result.exact);
+}
+
+TEST(Analysis, analyze_uniform_pool_HugePool_ReturnsScaledMoments)
+{
+  auto result = analyze_uniform_pool(1000000000, 1000);
+
+  EXPECT_DOUBLE_EQ(500.5e9, result.mean);
+  EXPECT_DOUBLE_EQ(1e9 * (1000.0 * 1000.0 - 1) / 12, result.variance);
+  EXPECT_EQ(1000000000, result.min);
+  EXPECT_EQ(1000000000000, result.max);
+}
+
+TEST(Analysis, analyze_uniform_pool_0Faces_ReturnsConstant0)
+{
+  auto result = analyze_uniform_pool(4, 0);
+
+  EXPECT_DOUBLE_EQ(0, result.mean);
+  EXPECT_DOUBLE_EQ(0, result.variance);
+  EXPECT_EQ(0, result.min);
+  EXPECT_EQ(0, result.max);
+}
+
+TEST(Analysis, analyze_keep_pool_KeepHighest_MatchesEnumeration)
+{
+  auto result = analyze_keep_pool(4, 6, 3, true);
+  auto expected = enumerate_keep_pool(4, 6, 3, true);
+
+  EXPECT_NEAR(expected.mean, result.mean, 1e-9);
+  EXPECT_NEAR(expected.variance, result.variance, 1e-9);
+  EXPECT_EQ(3, result.min);
+  EXPECT_EQ(18, result.max);
+  EXPECT_TRUE(result.exact);
+}
+
+TEST(Analysis, analyze_keep_pool_KeepLowest_MatchesEnumeration)
+{
+  auto result = analyze_keep_pool(5, 4, 2, false);
+  auto expected = enumerate_keep_pool(5, 4, 2, false);
+
+  EXPECT_NEAR(expected.mean, result.mean, 1e-9);
+  EXPECT_NEAR(expected.variance, result.variance, 1e-9);
+  EXPECT_EQ(2, result.min);
+  EXPECT_EQ(8, result.max);
+}
+
+TEST(Analysis, analyze_keep_pool_Advantage_ReturnsKnownMean)
+{
+  auto result = analyze_keep_pool(2, 20, 1, true);
+
+  EXPECT_NEAR(13.825, result.mean, 1e-9);
+}
+
+TEST(Analysis, analyze_keep_pool_KeepAtLeastAllDice_ReturnsUniformMoments)
+{
+  auto result = analyze_keep_pool(3, 6, 5, true);
+
+  EXPECT_DOUBLE_EQ(10.5, result.mean);
+  EXPECT_DOUBLE_EQ(8.75, result.variance);
+}
+
+TEST(Analysis, analyze_keep_pool_HugePool_UsesLargePoolApproximation)
+{
+  auto result = analyze_keep_pool(1000000000, 1000000, 500000000, true);
+
+  EXPECT_FALSE(result.exact);
+  // Keeping the top half of a d1000000 averages ~750000 per kept die.
+  EXPECT_NEAR(750000.5 * 500000000, result.mean, 1e9);
+  EXPECT_EQ(500000000, result.min);
+  EXPECT_EQ(500000000000000, result.max);
+}
+
+TEST(Analysis, analyze_exploding_pool_3d6_ReturnsGeometricMoments)
+{
+  auto result = analyze_exploding_pool(3, 6);
+
+  EXPECT_NEAR(12.6, result.mean, 1e-9);
+  EXPECT_NEAR(3 * (216.0 / 25 + 24.0 / 12), result.variance, 1e-9);
+  EXPECT_EQ(3, result.min);
+  EXPECT_EQ(LONG_MAX, result.max);
+  EXPECT_TRUE(result.exact);
+}
+
+TEST(Analysis, analyze_exploding_keep_pool_Advantage_BeatsSingleDie)
+{
+  auto single = analyze_exploding_pool(1, 6);
+
+  auto result = analyze_exploding_keep_pool(2, 6, 1, true);
+
+  EXPECT_GT(result.mean, single.mean);
+  EXPECT_EQ(1, result.min);
+  EXPECT_FALSE(result.exact);
+}
+
+TEST(Analysis, analyze_exploding_keep_pool_LargePool_ApproximatesMoments)
+{
+  // 318.010 and 101.990, sd 27.55 and 9.59, from the exact distributions.
+  auto highest = analyze_exploding_keep_pool(100, 6, 50, true);
+  auto lowest = analyze_exploding_keep_pool(100, 6, 50, false);
+
+  EXPECT_NEAR(318.0, highest.mean, 0.03 * 318.0);
+  EXPECT_NEAR(27.55, std::sqrt(highest.variance), 0.1 * 27.55);
+  EXPECT_NEAR(102.0, lowest.mean, 0.03 * 102.0);
+  EXPECT_NEAR(9.59, std::sqrt(lowest.variance), 0.25 * 9.59);
+  EXPECT_EQ(LONG_MAX, highest.max);
+  EXPECT_FALSE(highest.exact);
+}
+
+TEST(Analysis, analyze_product_IndependentOperands_PropagatesMoments)
+{
+  auto result =
+      analyze_product(analyze_uniform_pool(1, 6), analyze_constant(-2));
+
+  EXPECT_DOUBLE_EQ(-7, result.mean);
+  EXPECT_DOUBLE_EQ(35.0 / 3, result.variance);
+  EXPECT_EQ(-12, result.min);
+  EXPECT_EQ(-2, result.max);
+}
+
+TEST(Analysis, analyze_difference_IndependentOperands_AddsVariances)
+{
+  auto die = analyze_uniform_pool(1, 6);
+
+  auto result = analyze_difference(die, die);
+
+  EXPECT_DOUBLE_EQ(0, result.mean);
+  EXPECT_DOUBLE_EQ(35.0 / 6, result.variance);
+  EXPECT_EQ(-5, result.min);
+  EXPECT_EQ(5, result.max);
+}
+
+TEST(Analysis, analyze_difference_within_OverlappingRanges_ApproximatesChance)
+{
+  auto die = analyze_uniform_pool(10, 6);
+
+  auto result = analyze_difference_within(die, die, 1, LONG_MAX);
+
+  // Ties take about 5% of the mass, and the rest is split evenly.
+  EXPECT_NEAR(0.474, result.mean, 0.01);
+  EXPECT_NEAR(result.mean * (1 - result.mean), result.variance, 1e-12);
+  EXPECT_EQ(0, result.min);
+  EXPECT_EQ(1, result.max);
+  EXPECT_FALSE(result.exact);
+}
+
+TEST(Analysis, analyze_difference_within_BoundsDecide_ReturnsConstant)
+{
+  auto die = analyze_uniform_pool(1, 6);
+  auto ten = analyze_constant(10);
+
+  auto always = analyze_difference_within(ten, die, 1, LONG_MAX);
+  auto never = analyze_difference_within(die, ten, 0, 0);
+
+  EXPECT_EQ(1, always.min);
+  EXPECT_EQ(1, always.max);
+  EXPECT_TRUE(always.exact);
+  EXPECT_EQ(0, never.max);
+  EXPECT_TRUE(never.exact);
+}
+
+TEST(Analysis, analyze_difference_within_SaturatedBounds_DoesNotDecide)
+{
+  auto product = analyze_product(
+      analyze_constant(4000000000), analyze_constant(4000000000)
+  );
+
+  auto result = analyze_difference_within(
+      product, analyze_constant(0), 1, LONG_MAX
+  );
+
+  EXPECT_EQ(0, result.min);
+  EXPECT_EQ(1, result.max);
+  EXPECT_FALSE(result.exact);
+}
+
+TEST(Analysis, analyze_quotient_DivisorRangeContainsZero_SkipsZeroForBounds)
+{
+  TreeAnalysis divisor = {
+      .mean = 0,
+      .variance = 1,
+      .min = -2,
+      .max = 3,
+      .exact = true,
+  };
+
+  auto result = analyze_quotient(analyze_constant(12), divisor);
+
+  EXPECT_EQ(-12, result.min);
+  EXPECT_EQ(12, result.max);
+  EXPECT_FALSE(result.exact);
+}
+
+TEST(Analysis, analyze_quotient_DivisorAlwaysZero_ThrowsDiceException)
+{
+  try
+  {
+    analyze_quotient(analyze_constant(1), analyze_constant(0));
+  }
+  catch (DiceException &e)
+  {
+    EXPECT_STREQ("Division by zero is not allowed.", e.what());
+    return;
+  }
+
+  FAIL() << "Expected DiceException.";
+}
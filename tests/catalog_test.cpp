@@ -0,0 +1,69 @@
+#include "catalog.hpp"
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+std::string
+write_catalog_file(const std::string &name, const std::string &bytes)
+{
+  auto path = std::filesystem::temp_directory_path() /
+              (name + "_" + std::to_string(getpid()) + ".catalog");
+  std::ofstream(path, std::ios::binary) << bytes;
+  return path.string();
+}
+
+TEST(Catalog, evaluate_CompiledCatalog_EvaluatesEntriesByIndex)
+{
+  auto bytes = compile_catalog("2d1 + 5\r\n(3 * d1) * 4\n10 / (d1 - 1)\n");
+  auto path = write_catalog_file("catalog_valid", bytes);
+  Catalog catalog(path);
+  std::mt19937 rng(1);
+  EvaluationContext context = {.rng = rng};
+
+  ASSERT_EQ(3, catalog.size());
+  EXPECT_EQ(7, catalog.evaluate(0, context).value());
+  EXPECT_EQ(12, catalog.evaluate(1, context).value());
+  EXPECT_EQ(
+      DiceErrorCode::DivisionByZero, catalog.evaluate(2, context).error().code
+  );
+  EXPECT_THROW(catalog.evaluate(3, context), DiceException);
+  std::filesystem::remove(path);
+}
+
+TEST(Catalog, compile_catalog_InvalidLine_ThrowsDiceExceptionWithLineNumber)
+{
+  try
+  {
+    compile_catalog("1 + 1\n2 +\n");
+  }
+  catch (DiceException &e)
+  {
+    EXPECT_STREQ("Line 2: Input expression is not valid.", e.what());
+    return;
+  }
+
+  FAIL() << "Expected DiceException.";
+}
+
+TEST(Catalog, Catalog_TruncatedFile_ThrowsDiceException)
+{
+  auto bytes = compile_catalog("1 + 1\n");
+  auto path = write_catalog_file(
+      "catalog_truncated", bytes.substr(0, bytes.size() - 1)
+  );
+
+  EXPECT_THROW(Catalog catalog(path), DiceException);
+  std::filesystem::remove(path);
+}
+
+TEST(Catalog, Catalog_CorruptProgram_ThrowsDiceException)
+{
+  auto bytes = compile_catalog("1 + 1\n");
+  // The first node's kind is the first field after the header and index.
+  bytes[32 + 16] = 3;
+  auto path = write_catalog_file("catalog_corrupt", bytes);
+
+  EXPECT_THROW(Catalog catalog(path), DiceException);
+  std::filesystem::remove(path);
+}
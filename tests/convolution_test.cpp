@@ -0,0 +1,103 @@
+#include "convolution.hpp"
+#include <cmath>
+#include <gtest/gtest.h>
+#include <numeric>
+#include <vector>
+
+TEST(Convolution, convolve_SmallInputs_ReturnsDirectConvolution)
+{
+  auto result = convolve({1, 2, 3}, {0, 1, 0.5});
+
+  std::vector<double> expected = {0, 1, 2.5, 4, 1.5};
+  ASSERT_EQ(expected.size(), result.size());
+  for (std::size_t i = 0; i < expected.size(); i++)
+  {
+    EXPECT_NEAR(expected[i], result[i], 1e-12);
+  }
+}
+
+TEST(Convolution, convolve_LargeInputs_MatchesDirectConvolution)
+{
+  std::vector<double> left(3000);
+  std::vector<double> right(2000);
+  for (std::size_t i = 0; i < left.size(); i++)
+  {
+    left[i] = static_cast<double>(i % 7) / 7;
+  }
+  for (std::size_t i = 0; i < right.size(); i++)
+  {
+    right[i] = static_cast<double>(i % 5) / 5;
+  }
+
+  auto result = convolve(left, right);
+
+  ASSERT_EQ(4999, result.size());
+  for (std::size_t k : {0UL, 1UL, 1234UL, 2999UL, 4998UL})
+  {
+    double expected = 0;
+    for (std::size_t i = 0; i < left.size(); i++)
+    {
+      if (k >= i && k - i < right.size())
+      {
+        expected += left[i] * right[k - i];
+      }
+    }
+    EXPECT_NEAR(expected, result[k], 1e-9);
+  }
+}
+
+TEST(Convolution, convolve_power_ExponentZero_ReturnsIdentity)
+{
+  auto result = convolve_power({0.5, 0.5}, 0);
+
+  EXPECT_EQ(std::vector<double>{1.0}, result);
+}
+
+TEST(Convolution, convolve_power_LargePool_SumsToOneWithExpectedMean)
+{
+  std::vector<double> d100(100, 0.01);
+
+  auto result = convolve_power(d100, 500);
+
+  ASSERT_EQ(49501, result.size());
+  double total = 0;
+  double mean = 0;
+  for (std::size_t i = 0; i < result.size(); i++)
+  {
+    total += result[i];
+    mean += result[i] * static_cast<double>(i + 500);
+  }
+  EXPECT_NEAR(1.0, total, 1e-9);
+  EXPECT_NEAR(25250, mean, 1e-6);
+}
+
+TEST(Convolution, convolve_power_exact_ThreeD6_ReturnsExactCounts)
+{
+  auto result = convolve_power_exact(std::vector<unsigned long>(6, 1), 3);
+
+  ASSERT_TRUE(result.has_value());
+  std::vector<double> counts = {1,  3,  6,  10, 15, 21, 25, 27,
+                                27, 25, 21, 15, 10, 6,  3,  1};
+  ASSERT_EQ(counts.size(), result->size());
+  for (std::size_t i = 0; i < counts.size(); i++)
+  {
+    EXPECT_DOUBLE_EQ(counts[i] / 216, result->at(i));
+  }
+}
+
+TEST(Convolution, convolve_power_exact_TinyTail_IsExact)
+{
+  // P(30d6 = 30) = 6^-30, far below double precision FFT noise.
+  auto result = convolve_power_exact(std::vector<unsigned long>(6, 1), 30);
+
+  ASSERT_TRUE(result.has_value());
+  EXPECT_DOUBLE_EQ(std::pow(6.0, -30), result->front());
+  EXPECT_DOUBLE_EQ(std::pow(6.0, -30), result->back());
+}
+
+TEST(Convolution, convolve_power_exact_CountsTooLarge_ReturnsEmpty)
+{
+  auto result = convolve_power_exact(std::vector<unsigned long>(100, 1), 500);
+
+  EXPECT_FALSE(result.has_value());
+}
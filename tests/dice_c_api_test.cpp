@@ -0,0 +1,181 @@
+#include "dice_c_api.h"
+#include <cstring>
+#include <gtest/gtest.h>
+#include <vector>
+
+DiceExpression *compile_or_fail(const char *expression)
+{
+  DiceExpression *compiled = nullptr;
+  EXPECT_EQ(
+      DICE_OK,
+      dice_compile(expression, std::strlen(expression), &compiled, nullptr)
+  );
+  return compiled;
+}
+
+TEST(DiceCApi, dice_compile_InvalidExpression_ReportsStatusAndOffset)
+{
+  DiceExpression *compiled = nullptr;
+  std::size_t offset = 0;
+
+  int32_t status = dice_compile("2d6 + $", 7, &compiled, &offset);
+
+  EXPECT_EQ(DICE_UNEXPECTED_CHARACTER, status);
+  EXPECT_EQ(nullptr, compiled);
+  EXPECT_EQ(6, offset);
+  EXPECT_STREQ(
+      "The expression contains an unexpected character.",
+      dice_status_message(status)
+  );
+}
+
+TEST(DiceCApi, dice_compile_NullArguments_ReturnsInvalidArgument)
+{
+  DiceExpression *compiled = nullptr;
+
+  EXPECT_EQ(DICE_INVALID_ARGUMENT, dice_compile("d6", 2, nullptr, nullptr));
+  EXPECT_EQ(
+      DICE_INVALID_ARGUMENT, dice_compile(nullptr, 2, &compiled, nullptr)
+  );
+  EXPECT_EQ(DICE_EMPTY_INPUT, dice_compile(nullptr, 0, &compiled, nullptr));
+}
+
+TEST(DiceCApi, dice_evaluate_many_OneHandle_FillsEveryResult)
+{
+  auto *expression = compile_or_fail("4d6h3 + 1");
+  auto *generator = dice_generator_create(42);
+  std::vector<int64_t> results(1000);
+  std::vector<int32_t> statuses(1000, -1);
+
+  int32_t status = dice_evaluate_many(
+      expression, generator, results.size(), results.data(), statuses.data()
+  );
+
+  EXPECT_EQ(DICE_OK, status);
+  for (std::size_t i = 0; i < results.size(); i++)
+  {
+    EXPECT_GE(results[i], 4);
+    EXPECT_LE(results[i], 19);
+    EXPECT_EQ(DICE_OK, statuses[i]);
+  }
+  dice_generator_free(generator);
+  dice_expression_free(expression);
+}
+
+TEST(DiceCApi, dice_evaluate_many_SameSeed_SameResults)
+{
+  auto *expression = compile_or_fail("3d6");
+  auto *first = dice_generator_create(7);
+  auto *second = dice_generator_create(7);
+  std::vector<int64_t> a(100);
+  std::vector<int64_t> b(100);
+
+  dice_evaluate_many(expression, first, a.size(), a.data(), nullptr);
+  dice_evaluate_many(expression, second, b.size(), b.data(), nullptr);
+
+  EXPECT_EQ(a, b);
+  dice_generator_free(first);
+  dice_generator_free(second);
+  dice_expression_free(expression);
+}
+
+TEST(DiceCApi, dice_evaluate_many_SomeDivisionsByZero_ReportsEachFailure)
+{
+  // d2 - 1 is zero about half the time.
+  auto *expression = compile_or_fail("6 / (d2 - 1)");
+  std::vector<int64_t> results(200);
+  std::vector<int32_t> statuses(200);
+
+  int32_t status = dice_evaluate_many(
+      expression, nullptr, results.size(), results.data(), statuses.data()
+  );
+
+  EXPECT_EQ(DICE_DIVISION_BY_ZERO, status);
+  int failures = 0;
+  for (std::size_t i = 0; i < results.size(); i++)
+  {
+    if (statuses[i] == DICE_OK)
+    {
+      EXPECT_EQ(6, results[i]);
+    }
+    else
+    {
+      EXPECT_EQ(DICE_DIVISION_BY_ZERO, statuses[i]);
+      EXPECT_EQ(0, results[i]);
+      failures++;
+    }
+  }
+  EXPECT_GT(failures, 0);
+  EXPECT_LT(failures, 200);
+  dice_expression_free(expression);
+}
+
+TEST(DiceCApi, dice_evaluate_many_SomeFailures_DrawsLikeASinglePass)
+{
+  // Both draw a batch of d6 and then of d2, but only the first can fail.
+  auto *failing = compile_or_fail("d6 + 0 * (6 / (d2 - 1))");
+  auto *passing = compile_or_fail("d6 + 0 * (6 / (d2 + 1))");
+  auto *firstGenerator = dice_generator_create(11);
+  auto *secondGenerator = dice_generator_create(11);
+  std::vector<int64_t> failed(100);
+  std::vector<int64_t> passed(100);
+  std::vector<int32_t> statuses(100);
+
+  dice_evaluate_many(
+      failing, firstGenerator, 100, failed.data(), statuses.data()
+  );
+  dice_evaluate_many(passing, secondGenerator, 100, passed.data(), nullptr);
+
+  for (std::size_t i = 0; i < failed.size(); i++)
+  {
+    EXPECT_EQ(statuses[i] == DICE_OK ? passed[i] : 0, failed[i]);
+  }
+  dice_generator_free(firstGenerator);
+  dice_generator_free(secondGenerator);
+  dice_expression_free(failing);
+  dice_expression_free(passing);
+}
+
+TEST(DiceCApi, dice_evaluate_many_OverDiceLimit_FailsEverySample)
+{
+  auto *expression = compile_or_fail("1 + d6");
+  ASSERT_EQ(DICE_OK, dice_expression_set_max_dice(expression, 0));
+  int64_t results[3] = {5, 5, 5};
+  int32_t statuses[3];
+
+  int32_t status =
+      dice_evaluate_many(expression, nullptr, 3, results, statuses);
+
+  EXPECT_EQ(DICE_TOO_MANY_DICE, status);
+  for (int i = 0; i < 3; i++)
+  {
+    EXPECT_EQ(0, results[i]);
+    EXPECT_EQ(DICE_TOO_MANY_DICE, statuses[i]);
+  }
+  dice_expression_free(expression);
+}
+
+TEST(DiceCApi, dice_evaluate_batch_ManyHandles_EvaluatesEachOnce)
+{
+  auto *constant = compile_or_fail("7");
+  auto *roll = compile_or_fail("d4");
+  auto *limited = compile_or_fail("100d6");
+  ASSERT_EQ(DICE_OK, dice_expression_set_max_dice(limited, 10));
+  const DiceExpression *expressions[] = {constant, roll, limited, nullptr};
+  int64_t results[4];
+  int32_t statuses[4];
+
+  int32_t status =
+      dice_evaluate_batch(expressions, nullptr, 4, results, statuses);
+
+  EXPECT_EQ(DICE_TOO_MANY_DICE, status);
+  EXPECT_EQ(7, results[0]);
+  EXPECT_GE(results[1], 1);
+  EXPECT_LE(results[1], 4);
+  EXPECT_EQ(DICE_OK, statuses[1]);
+  EXPECT_EQ(DICE_TOO_MANY_DICE, statuses[2]);
+  EXPECT_EQ(DICE_INVALID_ARGUMENT, statuses[3]);
+  dice_expression_free(constant);
+  dice_expression_free(roll);
+  dice_expression_free(limited);
+}
@@ -0,0 +1,171 @@
+#include "dice_exception.hpp"
+#include "distribution_cache.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+std::string temporary_cache_path(const std::string &name)
+{
+  auto path = std::filesystem::temp_directory_path() /
+              (name + "_" + std::to_string(getpid()) + ".cache");
+  std::filesystem::remove(path);
+  return path.string();
+}
+
+TEST(DistributionCache, find_KeyWasNeverInserted_ReturnsEmpty)
+{
+  auto path = temporary_cache_path("cache_miss");
+  DistributionCache cache(path);
+
+  auto result = cache.find({4, 6, KeepMode::Highest, 3});
+
+  EXPECT_FALSE(result.has_value());
+  std::filesystem::remove(path);
+}
+
+TEST(DistributionCache, find_KeyInsertedByAnotherInstance_ReturnsMappedData)
+{
+  auto path = temporary_cache_path("cache_shared");
+  DistributionCache writer(path);
+  DistributionCache reader(path);
+  Distribution distribution = {
+      .offset = 2,
+      .probabilities = {0.25, 0.5, 0.25},
+  };
+
+  writer.insert({2, 2, KeepMode::None, 0}, distribution);
+  auto result = reader.find({2, 2, KeepMode::None, 0});
+
+  ASSERT_TRUE(result.has_value());
+  EXPECT_EQ(2, result->offset);
+  ASSERT_EQ(3, result->probabilities.size());
+  EXPECT_DOUBLE_EQ(0.5, result->probabilities[1]);
+  EXPECT_EQ(
+      0,
+      reinterpret_cast<std::uintptr_t>(result->probabilities.data()) % 64
+  );
+  std::filesystem::remove(path);
+}
+
+TEST(DistributionCache, find_DifferentKeepMode_ReturnsEmpty)
+{
+  auto path = temporary_cache_path("cache_keep_mode");
+  DistributionCache cache(path);
+
+  cache.insert(
+      {2, 20, KeepMode::Highest, 1}, {.offset = 1, .probabilities = {1}}
+  );
+  auto result = cache.find({2, 20, KeepMode::Lowest, 1});
+
+  EXPECT_FALSE(result.has_value());
+  std::filesystem::remove(path);
+}
+
+TEST(DistributionCache, find_ManyKeys_ReturnsEachKeysData)
+{
+  auto path = temporary_cache_path("cache_many");
+  DistributionCache cache(path);
+
+  for (unsigned long die = 1; die <= 100; die++)
+  {
+    cache.insert(
+        {die, 6, KeepMode::None, 0},
+        {.offset = static_cast<long>(die), .probabilities = {1}}
+    );
+  }
+
+  for (unsigned long die = 1; die <= 100; die++)
+  {
+    auto result = cache.find({die, 6, KeepMode::None, 0});
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(static_cast<long>(die), result->offset);
+  }
+  std::filesystem::remove(path);
+}
+
+TEST(DistributionCache, find_SlotDataPastEndOfData_ReturnsEmpty)
+{
+  auto path = temporary_cache_path("cache_damaged");
+  {
+    DistributionCache writer(path);
+    writer.insert(
+        {3, 6, KeepMode::None, 0}, {.offset = 3, .probabilities = {0.5, 0.5}}
+    );
+  }
+  // Moves the end of data in the header back to the start of the data, so
+  // that the slot's data no longer lies within it.
+  {
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    std::uint64_t dataEnd = 64 + 64 * 4096;
+    file.seekp(16);
+    file.write(reinterpret_cast<const char *>(&dataEnd), sizeof(dataEnd));
+  }
+  DistributionCache reader(path);
+
+  auto result = reader.find({3, 6, KeepMode::None, 0});
+
+  EXPECT_FALSE(result.has_value());
+  std::filesystem::remove(path);
+}
+
+TEST(DistributionCache, find_FileTruncatedAfterOpening_ReturnsEmpty)
+{
+  auto path = temporary_cache_path("cache_truncated");
+  DistributionCache cache(path);
+  Pool key = {100, 100, KeepMode::None, 0};
+  cache.insert(
+      key, {.offset = 100, .probabilities = std::vector<double>(9901, 1e-4)}
+  );
+
+  // Cuts the data off partway through its first page, and then the index.
+  for (std::uintmax_t size : {266240, 262208 + 100, 4096})
+  {
+    std::filesystem::resize_file(path, size);
+
+    EXPECT_FALSE(cache.find(key).has_value()) << size;
+  }
+  std::filesystem::remove(path);
+}
+
+TEST(DistributionCache, DistributionCache_DataPastEndOfFile_ThrowsDiceException)
+{
+  auto path = temporary_cache_path("cache_short");
+  {
+    DistributionCache writer(path);
+    writer.insert(
+        {4, 6, KeepMode::Highest, 3}, {.offset = 3, .probabilities = {1, 1}}
+    );
+  }
+  std::filesystem::resize_file(path, 262208 + 8);
+
+  EXPECT_THROW(DistributionCache reader(path), DiceException);
+  std::filesystem::remove(path);
+}
+
+TEST(DistributionCache, DistributionCache_OlderVersion_ThrowsDiceException)
+{
+  auto path = temporary_cache_path("cache_old");
+  {
+    DistributionCache writer(path);
+  }
+  {
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    std::uint32_t version = 1;
+    file.seekp(8);
+    file.write(reinterpret_cast<const char *>(&version), sizeof(version));
+  }
+
+  EXPECT_THROW(DistributionCache reader(path), DiceException);
+  std::filesystem::remove(path);
+}
+
+TEST(DistributionCache, DistributionCache_FileIsNotACache_ThrowsDiceException)
+{
+  auto path = temporary_cache_path("cache_invalid");
+  std::ofstream(path) << "not a distribution cache";
+
+  EXPECT_THROW(DistributionCache cache(path), DiceException);
+  std::filesystem::remove(path);
+}
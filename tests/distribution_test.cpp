@@ -0,0 +1,291 @@
+#include "analysis.hpp"
+#include "dice_exception.hpp"
+#include "distribution.hpp"
+#include <algorithm>
+#include <climits>
+#include <gtest/gtest.h>
+
+double probability_at(const Distribution &distribution, long value)
+{
+  long index = value - distribution.offset;
+  if (index < 0 ||
+      index >= static_cast<long>(distribution.probabilities.size()))
+  {
+    return 0;
+  }
+
+  return distribution.probabilities.at(index);
+}
+
+TEST(Distribution, uniform_pool_distribution_TwoD6_ReturnsTriangle)
+{
+  auto result = uniform_pool_distribution(2, 6);
+
+  EXPECT_EQ(2, result.offset);
+  EXPECT_EQ(11, result.probabilities.size());
+  EXPECT_DOUBLE_EQ(1.0 / 36, probability_at(result, 2));
+  EXPECT_DOUBLE_EQ(6.0 / 36, probability_at(result, 7));
+  EXPECT_DOUBLE_EQ(1.0 / 36, probability_at(result, 12));
+}
+
+TEST(Distribution, uniform_pool_distribution_0Die_ReturnsPoint0)
+{
+  auto result = uniform_pool_distribution(0, 6);
+
+  EXPECT_EQ(0, result.offset);
+  EXPECT_EQ(std::vector<double>{1.0}, result.probabilities);
+}
+
+TEST(Distribution, keep_pool_distribution_Advantage_ReturnsMaxDistribution)
+{
+  auto result = keep_pool_distribution(2, 20, 1, true);
+
+  for (long value = 1; value <= 20; value++)
+  {
+    EXPECT_NEAR((2.0 * value - 1) / 400, probability_at(result, value), 1e-12);
+  }
+}
+
+TEST(Distribution, keep_pool_distribution_Disadvantage_ReturnsMinDistribution)
+{
+  auto result = keep_pool_distribution(2, 20, 1, false);
+
+  for (long value = 1; value <= 20; value++)
+  {
+    EXPECT_NEAR(
+        (41.0 - 2 * value) / 400, probability_at(result, value), 1e-12
+    );
+  }
+}
+
+TEST(Distribution, exploding_distribution_D6_ReturnsGeometricLevels)
+{
+  auto result = exploding_distribution(6);
+
+  EXPECT_NEAR(1.0 / 6, probability_at(result, 5), 1e-15);
+  EXPECT_NEAR(0, probability_at(result, 6), 1e-15);
+  EXPECT_NEAR(1.0 / 36, probability_at(result, 7), 1e-15);
+  EXPECT_NEAR(1.0 / 216, probability_at(result, 17), 1e-15);
+
+  double total = 0;
+  double mean = 0;
+  for (std::size_t i = 0; i < result.probabilities.size(); i++)
+  {
+    total += result.probabilities[i];
+    mean += result.probabilities[i] * static_cast<double>(result.offset + i);
+  }
+  EXPECT_NEAR(1, total, 1e-12);
+  EXPECT_NEAR(4.2, mean, 1e-12);
+}
+
+TEST(Distribution, exploding_pool_distribution_2d2_MatchesEnumeration)
+{
+  auto result = exploding_pool_distribution(2, 2);
+
+  // Each die is odd with probability 1/2, 1/4, 1/8, ... for 1, 3, 5, ...
+  EXPECT_NEAR(1.0 / 4, probability_at(result, 2), 1e-12);
+  EXPECT_NEAR(0, probability_at(result, 3), 1e-12);
+  EXPECT_NEAR(2.0 / 8, probability_at(result, 4), 1e-12);
+  EXPECT_NEAR(3.0 / 16, probability_at(result, 6), 1e-12);
+}
+
+TEST(Distribution, success_count_distribution_3Dice_IsBinomial)
+{
+  auto result = success_count_distribution(3, 0.4);
+
+  EXPECT_NEAR(0.216, probability_at(result, 0), 1e-12);
+  EXPECT_NEAR(0.432, probability_at(result, 1), 1e-12);
+  EXPECT_NEAR(0.288, probability_at(result, 2), 1e-12);
+  EXPECT_NEAR(0.064, probability_at(result, 3), 1e-12);
+}
+
+TEST(Distribution, difference_distribution_D6MinusD6_IsSymmetric)
+{
+  auto die = uniform_distribution(6);
+
+  auto result = difference_distribution(die, die);
+
+  EXPECT_EQ(-5, result.offset);
+  EXPECT_DOUBLE_EQ(6.0 / 36, probability_at(result, 0));
+  EXPECT_DOUBLE_EQ(probability_at(result, -3), probability_at(result, 3));
+}
+
+TEST(Distribution, difference_within_distribution_D6VersusD6_SumsJointMass)
+{
+  auto die = uniform_distribution(6);
+
+  auto greater = difference_within_distribution(die, die, 1, LONG_MAX);
+  auto equal = difference_within_distribution(die, die, 0, 0);
+  auto atMost = difference_within_distribution(die, die, LONG_MIN, 0);
+
+  EXPECT_EQ(0, greater.offset);
+  EXPECT_DOUBLE_EQ(15.0 / 36, probability_at(greater, 1));
+  EXPECT_DOUBLE_EQ(21.0 / 36, probability_at(greater, 0));
+  EXPECT_DOUBLE_EQ(6.0 / 36, probability_at(equal, 1));
+  EXPECT_DOUBLE_EQ(21.0 / 36, probability_at(atMost, 1));
+}
+
+TEST(Distribution, difference_within_distribution_DisjointRanges_IsCertain)
+{
+  auto low = uniform_distribution(6);
+  auto high = point_distribution(10);
+
+  EXPECT_DOUBLE_EQ(
+      1, probability_at(difference_within_distribution(high, low, 1, 9), 1)
+  );
+  EXPECT_DOUBLE_EQ(
+      0, probability_at(difference_within_distribution(low, high, 0, 0), 1)
+  );
+}
+
+TEST(Distribution, product_distribution_D2TimesD2_CombinesEqualProducts)
+{
+  auto die = uniform_distribution(2);
+
+  auto result = product_distribution(die, die);
+
+  EXPECT_DOUBLE_EQ(0.25, probability_at(result, 1));
+  EXPECT_DOUBLE_EQ(0.5, probability_at(result, 2));
+  EXPECT_DOUBLE_EQ(0, probability_at(result, 3));
+  EXPECT_DOUBLE_EQ(0.25, probability_at(result, 4));
+}
+
+TEST(Distribution, quotient_distribution_DivisorRangeSpansZero_SkipsZero)
+{
+  Distribution divisor = {
+      .offset = -1,
+      .probabilities = {0.5, 0, 0.5},
+  };
+
+  auto result = quotient_distribution(point_distribution(5), divisor);
+
+  EXPECT_DOUBLE_EQ(0.5, probability_at(result, -5));
+  EXPECT_DOUBLE_EQ(0.5, probability_at(result, 5));
+}
+
+TEST(Distribution, quotient_distribution_DivisorCanBeZero_ThrowsDiceException)
+{
+  try
+  {
+    quotient_distribution(
+        point_distribution(5), uniform_pool_distribution(0, 6)
+    );
+  }
+  catch (DiceException &e)
+  {
+    EXPECT_STREQ("Division by zero is not allowed.", e.what());
+    return;
+  }
+
+  FAIL() << "Expected DiceException.";
+}
+
+// Computes a keep pool's distribution by enumerating every roll.
+std::vector<double> enumerate_keep_pool_distribution(
+    unsigned long die,
+    unsigned long faces,
+    unsigned long keep,
+    bool keepHighest
+)
+{
+  std::vector<unsigned long> rolls(die, 1);
+  std::vector<double> counts(keep * (faces - 1) + 1, 0.0);
+  double outcomes = 0;
+
+  while (true)
+  {
+    auto sorted = rolls;
+    std::sort(sorted.begin(), sorted.end());
+    if (keepHighest)
+    {
+      std::reverse(sorted.begin(), sorted.end());
+    }
+
+    unsigned long sum = 0;
+    for (unsigned long i = 0; i < keep; i++)
+    {
+      sum += sorted.at(i);
+    }
+    counts.at(sum - keep)++;
+    outcomes++;
+
+    unsigned long i = 0;
+    while (i < die && rolls.at(i) == faces)
+    {
+      rolls.at(i) = 1;
+      i++;
+    }
+    if (i == die)
+    {
+      break;
+    }
+    rolls.at(i)++;
+  }
+
+  for (auto &count : counts)
+  {
+    count /= outcomes;
+  }
+
+  return counts;
+}
+
+TEST(Distribution, keep_pool_distribution_KeepHighest_MatchesEnumeration)
+{
+  auto result = keep_pool_distribution(5, 6, 2, true);
+  auto expected = enumerate_keep_pool_distribution(5, 6, 2, true);
+
+  EXPECT_EQ(2, result.offset);
+  ASSERT_EQ(expected.size(), result.probabilities.size());
+  for (std::size_t i = 0; i < expected.size(); i++)
+  {
+    EXPECT_NEAR(expected.at(i), result.probabilities.at(i), 1e-12);
+  }
+}
+
+TEST(Distribution, keep_pool_distribution_KeepLowest_MatchesEnumeration)
+{
+  auto result = keep_pool_distribution(4, 5, 3, false);
+  auto expected = enumerate_keep_pool_distribution(4, 5, 3, false);
+
+  EXPECT_EQ(3, result.offset);
+  ASSERT_EQ(expected.size(), result.probabilities.size());
+  for (std::size_t i = 0; i < expected.size(); i++)
+  {
+    EXPECT_NEAR(expected.at(i), result.probabilities.at(i), 1e-12);
+  }
+}
+
+TEST(
+    Distribution,
+    keep_pool_distribution_PoolTooLargeToEnumerate_MatchesMoments
+)
+{
+  // 20^10 rolls is far too many to enumerate.
+  auto result = keep_pool_distribution(10, 20, 3, true);
+  auto expected = analyze_keep_pool(10, 20, 3, true);
+
+  double total = 0;
+  double mean = 0;
+  double secondMoment = 0;
+  for (std::size_t i = 0; i < result.probabilities.size(); i++)
+  {
+    double value = static_cast<double>(result.offset + static_cast<long>(i));
+    total += result.probabilities.at(i);
+    mean += result.probabilities.at(i) * value;
+    secondMoment += result.probabilities.at(i) * value * value;
+  }
+  EXPECT_NEAR(1, total, 1e-12);
+  EXPECT_NEAR(expected.mean, mean, 1e-9);
+  EXPECT_NEAR(expected.variance, secondMoment - mean * mean, 1e-7);
+}
+
+TEST(
+    Distribution,
+    keep_pool_distribution_HugePoolKeepOne_ReturnsMaxDistribution
+)
+{
+  auto result = keep_pool_distribution(1000000000, 6, 1, true);
+
+  EXPECT_NEAR(1, result.probabilities.at(5), 1e-12);
+}
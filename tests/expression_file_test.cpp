@@ -0,0 +1,98 @@
+#include "dice_exception.hpp"
+#include "expression_file.hpp"
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <sstream>
+#include <unistd.h>
+
+std::string write_expression_file(
+    const std::string &name,
+    const std::string &contents
+)
+{
+  auto path = std::filesystem::temp_directory_path() /
+              (name + "_" + std::to_string(getpid()) + ".txt");
+  std::ofstream(path, std::ios::binary) << contents;
+  return path.string();
+}
+
+TEST(ExpressionFile, evaluate_expression_file_MixedLines_WritesOneLineEach)
+{
+  auto path = write_expression_file(
+      "expressions_mixed", "1 + 2\r\n\n3d1 * 2\n4 / (d1 - 1)\n2 x\n(5"
+  );
+  std::ostringstream out;
+
+  evaluate_expression_file(path, out);
+
+  EXPECT_EQ(
+      out.str(),
+      "3\n"
+      "Error: Empty input.\n"
+      "6\n"
+      "Error: Division by zero is not allowed.\n"
+      "Error: Unexpected character in input: 'x'\n"
+      "Error: Expression contains an unclosed parenthetical.\n"
+  );
+  std::filesystem::remove(path);
+}
+
+TEST(ExpressionFile, evaluate_expression_file_ManySmallChunks_KeepsInputOrder)
+{
+  std::string contents;
+  std::string expected;
+  for (int i = 0; i < 5000; i++)
+  {
+    contents += std::to_string(i) + " * d1\n";
+    expected += std::to_string(i) + "\n";
+  }
+  auto path = write_expression_file("expressions_ordered", contents);
+  std::ostringstream out;
+
+  evaluate_expression_file(path, out, 16);
+
+  EXPECT_EQ(out.str(), expected);
+  std::filesystem::remove(path);
+}
+
+TEST(ExpressionFile, evaluate_expression_file_ParallelRollLines_Finish)
+{
+  // Pools this large are rolled with a nested parallelFor on the same pool
+  // which evaluates the chunks.
+  std::string contents;
+  std::string expected;
+  for (int i = 0; i < 16; i++)
+  {
+    contents += "1100000d1\n";
+    expected += "1100000\n";
+  }
+  auto path = write_expression_file("expressions_parallel", contents);
+  std::ostringstream out;
+
+  evaluate_expression_file(path, out, 16);
+
+  EXPECT_EQ(out.str(), expected);
+  std::filesystem::remove(path);
+}
+
+TEST(ExpressionFile, evaluate_expression_file_EmptyFile_WritesNothing)
+{
+  auto path = write_expression_file("expressions_empty", "");
+  std::ostringstream out;
+
+  evaluate_expression_file(path, out);
+
+  EXPECT_EQ(out.str(), "");
+  std::filesystem::remove(path);
+}
+
+TEST(ExpressionFile, evaluate_expression_file_MissingFile_ThrowsDiceException)
+{
+  std::ostringstream out;
+
+  EXPECT_THROW(
+      evaluate_expression_file("/nonexistent/expressions.txt", out),
+      DiceException
+  );
+}
@@ -0,0 +1,94 @@
+#include "histogram.hpp"
+#include <gtest/gtest.h>
+#include <limits>
+#include <sstream>
+
+using HistogramCounts = std::vector<std::pair<long, unsigned long>>;
+
+TEST(Histogram, counts_NarrowRange_ReturnsSortedCounts)
+{
+  Histogram histogram(-2, 10);
+  std::vector<long> results = {3, -2, 3, 10, 3};
+
+  histogram.add(results);
+
+  EXPECT_EQ(histogram.total(), 5);
+  EXPECT_EQ(histogram.counts(), (HistogramCounts{{-2, 1}, {3, 3}, {10, 1}}));
+}
+
+TEST(Histogram, counts_WideRange_ReturnsSortedCounts)
+{
+  Histogram histogram(
+      std::numeric_limits<long>::min(), std::numeric_limits<long>::max()
+  );
+  std::vector<long> results = {1000000000000, -5, 1000000000000};
+
+  histogram.add(results);
+
+  EXPECT_EQ(histogram.counts(), (HistogramCounts{{-5, 1}, {1000000000000, 2}}));
+}
+
+TEST(Histogram, counts_ResultsOutsideBounds_CountsThemToo)
+{
+  Histogram histogram(0, 10);
+  std::vector<long> results = {5, -3, 5, std::numeric_limits<long>::min(), 11};
+
+  histogram.add(results);
+
+  EXPECT_EQ(histogram.total(), 5);
+  EXPECT_EQ(
+      histogram.counts(),
+      (HistogramCounts{
+          {std::numeric_limits<long>::min(), 1}, {-3, 1}, {5, 2}, {11, 1}
+      })
+  );
+}
+
+TEST(Histogram, fill_histogram_SamplesMoreThanOneBatch_AddsEverySample)
+{
+  Histogram histogram(0, 1);
+  long next = 0;
+
+  fill_histogram(histogram, 100001, [&](std::span<long> results) {
+    for (long &result : results)
+    {
+      result = next++ % 2;
+    }
+  });
+
+  EXPECT_EQ(histogram.counts(), (HistogramCounts{{0, 50001}, {1, 50000}}));
+}
+
+TEST(Histogram, print_histogram_csv_PrintsCumulativePercentages)
+{
+  Histogram histogram(1, 4);
+  std::vector<long> results = {1, 4, 4, 4};
+  histogram.add(results);
+  std::ostringstream out;
+
+  print_histogram_csv(out, histogram);
+
+  EXPECT_EQ(
+      out.str(),
+      "result,count,percent,cumulative_percent\n"
+      "1,1,25.000000,25.000000\n"
+      "4,3,75.000000,100.000000\n"
+  );
+}
+
+TEST(Histogram, print_histogram_text_ScalesBarsToMostFrequent)
+{
+  Histogram histogram(1, 10);
+  std::vector<long> results = {1, 10, 10};
+  histogram.add(results);
+  std::ostringstream out;
+
+  print_histogram_text(out, histogram);
+
+  EXPECT_EQ(
+      out.str(),
+      "\n"
+      " 1: 1   33.3333%   33.3333% " + std::string(25, '#') + "\n"
+      "10: 2   66.6667%  100.0000% " + std::string(50, '#') + "\n"
+  );
+}
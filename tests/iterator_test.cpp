@@ -79,3 +79,24 @@ TEST(
   EXPECT_TRUE(peekResult.has_value());
   EXPECT_EQ(2, peekResult.value());
 }
+
+TEST(Iterator, Last_Empty_ReturnsEmpty)
+{
+  std::vector<int> vec = {};
+  auto iterator = Iterator<int>(vec);
+
+  auto result = iterator.last();
+
+  EXPECT_FALSE(result.has_value());
+}
+
+TEST(Iterator, Last_NotYetReachedEnd_ReturnsFinalElement)
+{
+  std::vector<int> vec = {1, 2, 3};
+  auto iterator = Iterator<int>(vec);
+
+  auto result = iterator.last();
+
+  EXPECT_TRUE(result.has_value());
+  EXPECT_EQ(3, result.value());
+}
@@ -0,0 +1,91 @@
+#include "latency.hpp"
+#include <gtest/gtest.h>
+#include <memory>
+#include <thread>
+
+TEST(Latency, bucketIndex_AnyValue_FallsWithinOneSixtyFourthOfItsBound)
+{
+  for (std::uint64_t value :
+       {0UL, 1UL, 127UL, 128UL, 129UL, 1000UL, 123456789UL, UINT64_MAX})
+  {
+    auto index = LatencyHistogram::bucketIndex(value);
+    auto upper = LatencyHistogram::bucketUpperBound(index);
+
+    ASSERT_LT(index, LatencyHistogram::bucketCount);
+    EXPECT_GE(upper, value);
+    EXPECT_LE(upper - value, value / 64);
+  }
+}
+
+TEST(Latency, valueAtFraction_UniformSamples_ReturnsPercentiles)
+{
+  auto histogram = std::make_unique<LatencyHistogram>();
+  for (std::uint64_t value = 1; value <= 1000; value++)
+  {
+    histogram->record(value * 1000);
+  }
+
+  EXPECT_EQ(1000, histogram->count());
+  EXPECT_EQ(1000000, histogram->max());
+  EXPECT_NEAR(500000, histogram->valueAtFraction(0.5), 500000 / 64);
+  EXPECT_NEAR(990000, histogram->valueAtFraction(0.99), 990000 / 64);
+  EXPECT_EQ(1000000, histogram->valueAtFraction(1));
+}
+
+TEST(Latency, merge_TwoHistograms_CombinesCountsAndMax)
+{
+  auto merged = std::make_unique<LatencyHistogram>();
+  auto fast = std::make_unique<LatencyHistogram>();
+  auto slow = std::make_unique<LatencyHistogram>();
+  for (int i = 0; i < 999; i++)
+  {
+    fast->record(100);
+  }
+  slow->record(5000000);
+
+  merged->merge(*fast);
+  merged->merge(*slow);
+
+  EXPECT_EQ(1000, merged->count());
+  EXPECT_EQ(100, merged->valueAtFraction(0.99));
+  EXPECT_EQ(5000000, merged->max());
+}
+
+TEST(Latency, latency_percentiles_SamplesOnSeveralThreads_MergesThem)
+{
+  auto before = latency_percentiles().count;
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++)
+  {
+    threads.emplace_back([] {
+      for (int i = 0; i < 100; i++)
+      {
+        record_latency(std::chrono::microseconds(10));
+      }
+    });
+  }
+  for (auto &thread : threads)
+  {
+    thread.join();
+  }
+
+  EXPECT_EQ(before + 400, latency_percentiles().count);
+}
+
+TEST(Latency, format_latency_percentiles_MixedMagnitudes_PicksUnits)
+{
+  LatencyPercentiles percentiles = {
+      .count = 5,
+      .p50 = 850,
+      .p90 = 12300,
+      .p99 = 4560000,
+      .p999 = 4560000,
+      .max = 2000000000,
+  };
+
+  EXPECT_EQ(
+      "latency: n=5 p50=850ns p90=12.3us p99=4.56ms p99.9=4.56ms max=2.00s",
+      format_latency_percentiles(percentiles)
+  );
+}
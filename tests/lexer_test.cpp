@@ -83,13 +83,123 @@ TEST(Lexer, tokenize_InputContainsInvalidToken_ThrowsDiceException)
   // is fine for now.
   try
   {
-    auto result = tokenize("s");
+    auto result = tokenize("x");
   }
   catch (DiceException e)
   {
-    EXPECT_STREQ("Unexpected character in input: 's'", e.what());
+    EXPECT_STREQ("Unexpected character in input: 'x'", e.what());
     return;
   }
 
   FAIL();
 }
+
+TEST(Lexer, tokenize_InputContainsExclamationMark_ReturnsExplodeToken)
+{
+  auto result = tokenize("4d6!");
+
+  std::vector<Token> expected = {
+      Token{.tokenType = TokenType::Integer, .integerValue = 4},
+      Token{.tokenType = TokenType::D, .integerValue = 0},
+      Token{.tokenType = TokenType::Integer, .integerValue = 6},
+      Token{.tokenType = TokenType::Explode, .integerValue = 0},
+  };
+  EXPECT_THAT(result, testing::Pointwise(TokenEq(), expected));
+}
+
+TEST(Lexer, tokenize_GreaterThanFollowedByEquals_ReturnsGreaterEqualToken)
+{
+  auto result = tokenize("5d10>=7");
+
+  std::vector<Token> expected = {
+      Token{.tokenType = TokenType::Integer, .integerValue = 5},
+      Token{.tokenType = TokenType::D, .integerValue = 0},
+      Token{.tokenType = TokenType::Integer, .integerValue = 10},
+      Token{.tokenType = TokenType::GreaterEqual, .integerValue = 0},
+      Token{.tokenType = TokenType::Integer, .integerValue = 7},
+  };
+  EXPECT_THAT(result, testing::Pointwise(TokenEq(), expected));
+}
+
+TEST(Lexer, tokenize_SuccessTarget_ReturnsSuccessesToken)
+{
+  auto result = tokenize("5d10s>=7S>=1");
+
+  std::vector<Token> expected = {
+      Token{.tokenType = TokenType::Integer, .integerValue = 5},
+      Token{.tokenType = TokenType::D, .integerValue = 0},
+      Token{.tokenType = TokenType::Integer, .integerValue = 10},
+      Token{.tokenType = TokenType::Successes, .integerValue = 0},
+      Token{.tokenType = TokenType::GreaterEqual, .integerValue = 0},
+      Token{.tokenType = TokenType::Integer, .integerValue = 7},
+      Token{.tokenType = TokenType::Successes, .integerValue = 0},
+      Token{.tokenType = TokenType::GreaterEqual, .integerValue = 0},
+      Token{.tokenType = TokenType::Integer, .integerValue = 1},
+  };
+  EXPECT_THAT(result, testing::Pointwise(TokenEq(), expected));
+}
+
+TEST(Lexer, tokenize_ComparisonOperators_ReturnsComparisonTokens)
+{
+  auto result = tokenize("1>=2<=3>4<5=6");
+
+  std::vector<Token> expected = {
+      Token{.tokenType = TokenType::Integer, .integerValue = 1},
+      Token{.tokenType = TokenType::GreaterEqual, .integerValue = 0},
+      Token{.tokenType = TokenType::Integer, .integerValue = 2},
+      Token{.tokenType = TokenType::LessEqual, .integerValue = 0},
+      Token{.tokenType = TokenType::Integer, .integerValue = 3},
+      Token{.tokenType = TokenType::Greater, .integerValue = 0},
+      Token{.tokenType = TokenType::Integer, .integerValue = 4},
+      Token{.tokenType = TokenType::Less, .integerValue = 0},
+      Token{.tokenType = TokenType::Integer, .integerValue = 5},
+      Token{.tokenType = TokenType::Equal, .integerValue = 0},
+      Token{.tokenType = TokenType::Integer, .integerValue = 6},
+  };
+  EXPECT_THAT(result, testing::Pointwise(TokenEq(), expected));
+}
+
+TEST(Lexer, try_tokenize_ValidInput_RecordsByteOffsets)
+{
+  auto result = try_tokenize(" 12d6 +3");
+
+  ASSERT_TRUE(result.has_value());
+  ASSERT_EQ(5, result->size());
+  EXPECT_EQ(1, result->at(0).offset);
+  EXPECT_EQ(3, result->at(1).offset);
+  EXPECT_EQ(4, result->at(2).offset);
+  EXPECT_EQ(6, result->at(3).offset);
+  EXPECT_EQ(7, result->at(4).offset);
+}
+
+TEST(Lexer, try_tokenize_WhitespaceBetweenDigits_ReadsOneInteger)
+{
+  auto result = try_tokenize("1 0d 6\t0");
+
+  ASSERT_TRUE(result.has_value());
+  ASSERT_EQ(3, result->size());
+  EXPECT_EQ(10, result->at(0).integerValue);
+  EXPECT_EQ(0, result->at(0).offset);
+  EXPECT_EQ(TokenType::D, result->at(1).tokenType);
+  EXPECT_EQ(60, result->at(2).integerValue);
+  EXPECT_EQ(5, result->at(2).offset);
+}
+
+TEST(Lexer, try_tokenize_InvalidCharacter_ReturnsErrorAtCharacter)
+{
+  auto result = try_tokenize("2d6 + x");
+
+  ASSERT_FALSE(result.has_value());
+  EXPECT_EQ(DiceErrorCode::UnexpectedCharacter, result.error().code);
+  EXPECT_EQ("Unexpected character in input: 'x'", result.error().message);
+  EXPECT_EQ(6, result.error().offset);
+}
+
+TEST(Lexer, try_tokenize_IntegerTooLarge_ReturnsErrorAtInteger)
+{
+  auto result = try_tokenize("1 + 99999999999999999999999");
+
+  ASSERT_FALSE(result.has_value());
+  EXPECT_EQ(DiceErrorCode::IntegerTooLarge, result.error().code);
+  EXPECT_EQ(4, result.error().offset);
+}
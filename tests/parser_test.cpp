@@ -1,7 +1,9 @@
 #include "dice_exception.hpp"
+#include "lexer.hpp"
 #include "parser.hpp"
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include <thread>
 
 void parse_and_expect_dice_exception(
     std::vector<Token> input, const char *expectedErrMsg
@@ -679,3 +681,460 @@ TEST(Parser, parse_NestedParentheticals_DeeperParentheticalsGoFirst)
   std::string expectedDescription = "";
   EXPECT_EQ(expectedDescription, executeResult.description);
 }
+
+TEST(Parser, parse_MathOnRolls_AnalyzeReturnsPropagatedMoments)
+{
+  // (2d20h1 + 5) * 2
+  std::vector<Token> input = {
+      Token{.tokenType = TokenType::OpenParenthesis, .integerValue = 0},
+      Token{.tokenType = TokenType::Integer, .integerValue = 2},
+      Token{.tokenType = TokenType::D, .integerValue = 0},
+      Token{.tokenType = TokenType::Integer, .integerValue = 20},
+      Token{.tokenType = TokenType::H, .integerValue = 0},
+      Token{.tokenType = TokenType::Integer, .integerValue = 1},
+      Token{.tokenType = TokenType::Add, .integerValue = 0},
+      Token{.tokenType = TokenType::Integer, .integerValue = 5},
+      Token{.tokenType = TokenType::CloseParenthesis, .integerValue = 0},
+      Token{.tokenType = TokenType::Multiply, .integerValue = 0},
+      Token{.tokenType = TokenType::Integer, .integerValue = 2},
+  };
+
+  auto parseResult = parse(input);
+  auto analysis = parseResult->analyze();
+
+  EXPECT_NEAR(37.65, analysis.mean, 1e-9);
+  EXPECT_EQ(12, analysis.min);
+  EXPECT_EQ(50, analysis.max);
+  EXPECT_TRUE(analysis.exact);
+}
+
+TEST(Parser, parse_SumOfRolls_DistributionConvolvesOperands)
+{
+  // 2d6 - 1
+  std::vector<Token> input = {
+      Token{.tokenType = TokenType::Integer, .integerValue = 2},
+      Token{.tokenType = TokenType::D, .integerValue = 0},
+      Token{.tokenType = TokenType::Integer, .integerValue = 6},
+      Token{.tokenType = TokenType::Subtract, .integerValue = 0},
+      Token{.tokenType = TokenType::Integer, .integerValue = 1},
+  };
+
+  auto parseResult = parse(input);
+  auto distribution = parseResult->distribution();
+
+  EXPECT_EQ(1, distribution.offset);
+  ASSERT_EQ(11, distribution.probabilities.size());
+  EXPECT_DOUBLE_EQ(6.0 / 36, distribution.probabilities.at(5));
+}
+
+TEST(Parser, parse_MathOnRolls_ExecuteManyFillsEverySample)
+{
+  // 3d1 * 2 - d1
+  std::vector<Token> input = {
+      Token{.tokenType = TokenType::Integer, .integerValue = 3},
+      Token{.tokenType = TokenType::D, .integerValue = 0},
+      Token{.tokenType = TokenType::Integer, .integerValue = 1},
+      Token{.tokenType = TokenType::Multiply, .integerValue = 0},
+      Token{.tokenType = TokenType::Integer, .integerValue = 2},
+      Token{.tokenType = TokenType::Subtract, .integerValue = 0},
+      Token{.tokenType = TokenType::D, .integerValue = 0},
+      Token{.tokenType = TokenType::Integer, .integerValue = 1},
+  };
+
+  auto parseResult = parse(input);
+  std::vector<long> results(100, -1);
+  std::mt19937 rng(1);
+  parseResult->executeMany({.rng = rng}, results);
+
+  EXPECT_THAT(results, testing::Each(5));
+}
+
+TEST(Parser, parse_KeepHighest_ExecuteManyStaysInBounds)
+{
+  // 4d6h3
+  std::vector<Token> input = {
+      Token{.tokenType = TokenType::Integer, .integerValue = 4},
+      Token{.tokenType = TokenType::D, .integerValue = 0},
+      Token{.tokenType = TokenType::Integer, .integerValue = 6},
+      Token{.tokenType = TokenType::H, .integerValue = 0},
+      Token{.tokenType = TokenType::Integer, .integerValue = 3},
+  };
+
+  auto parseResult = parse(input);
+  std::vector<long> results(1000);
+  std::mt19937 rng(1);
+  parseResult->executeMany({.rng = rng}, results);
+
+  EXPECT_THAT(
+      results, testing::Each(testing::AllOf(testing::Ge(3), testing::Le(18)))
+  );
+}
+
+TEST(Parser, parse_DivideByZero_ExecuteManyThrowsDiceException)
+{
+  // 1 / (d1 - 1)
+  std::vector<Token> input = {
+      Token{.tokenType = TokenType::Integer, .integerValue = 1},
+      Token{.tokenType = TokenType::Divide, .integerValue = 0},
+      Token{.tokenType = TokenType::OpenParenthesis, .integerValue = 0},
+      Token{.tokenType = TokenType::D, .integerValue = 0},
+      Token{.tokenType = TokenType::Integer, .integerValue = 1},
+      Token{.tokenType = TokenType::Subtract, .integerValue = 0},
+      Token{.tokenType = TokenType::Integer, .integerValue = 1},
+      Token{.tokenType = TokenType::CloseParenthesis, .integerValue = 0},
+  };
+
+  auto parseResult = parse(input);
+  std::vector<long> results(10);
+  std::mt19937 rng(1);
+
+  EXPECT_THROW(
+      parseResult->executeMany({.rng = rng}, results), DiceException
+  );
+}
+
+TEST(Parser, parse_MillionTermSum_ExecutesWithoutRecursing)
+{
+  std::vector<Token> input = {
+      Token{.tokenType = TokenType::Integer, .integerValue = 1},
+  };
+  for (int i = 1; i < 1000000; i++)
+  {
+    input.push_back(Token{.tokenType = TokenType::Add, .integerValue = 0});
+    input.push_back(Token{.tokenType = TokenType::Integer, .integerValue = 1});
+  }
+
+  auto parseResult = parse(input);
+
+  EXPECT_EQ(1000000, parseResult->execute().result);
+}
+
+TEST(Parser, parse_NestedPastMaxDepth_ThrowsDiceException)
+{
+  std::vector<Token> input(
+      200000, Token{.tokenType = TokenType::OpenParenthesis, .integerValue = 0}
+  );
+  input.push_back(Token{.tokenType = TokenType::Integer, .integerValue = 1});
+  input.insert(
+      input.end(),
+      200000,
+      Token{.tokenType = TokenType::CloseParenthesis, .integerValue = 0}
+  );
+
+  parse_and_expect_dice_exception(input, "Expression is nested too deeply.");
+}
+
+TEST(Parser, parse_NestedToMaxDepth_ReturnsCorrectResult)
+{
+  // ((2)) * 3
+  std::vector<Token> input = {
+      Token{.tokenType = TokenType::OpenParenthesis, .integerValue = 0},
+      Token{.tokenType = TokenType::OpenParenthesis, .integerValue = 0},
+      Token{.tokenType = TokenType::Integer, .integerValue = 2},
+      Token{.tokenType = TokenType::CloseParenthesis, .integerValue = 0},
+      Token{.tokenType = TokenType::CloseParenthesis, .integerValue = 0},
+      Token{.tokenType = TokenType::Multiply, .integerValue = 0},
+      Token{.tokenType = TokenType::Integer, .integerValue = 3},
+  };
+
+  auto parseResult = parse(input, {.maxDepth = 2});
+
+  EXPECT_EQ(6, parseResult->execute().result);
+  EXPECT_THROW(parse(input, {.maxDepth = 1}), DiceException);
+}
+
+TEST(Parser, parse_MoreThanMaxTokens_ThrowsDiceException)
+{
+  // 1 + 1
+  std::vector<Token> input = {
+      Token{.tokenType = TokenType::Integer, .integerValue = 1},
+      Token{.tokenType = TokenType::Add, .integerValue = 0},
+      Token{.tokenType = TokenType::Integer, .integerValue = 1},
+  };
+
+  EXPECT_THROW(parse(input, {.maxTokens = 2}), DiceException);
+}
+
+TEST(Parser, parse_TrailingOperand_ThrowsDiceException)
+{
+  // (1) 2
+  std::vector<Token> input = {
+      Token{.tokenType = TokenType::OpenParenthesis, .integerValue = 0},
+      Token{.tokenType = TokenType::Integer, .integerValue = 1},
+      Token{.tokenType = TokenType::CloseParenthesis, .integerValue = 0},
+      Token{.tokenType = TokenType::Integer, .integerValue = 2},
+  };
+
+  parse_and_expect_dice_exception(input, "Input expression is not valid.");
+}
+
+TEST(Parser, try_parse_MissingOperand_ReturnsErrorAtLastToken)
+{
+  auto result = try_parse(tokenize("(2d6 + 1) *"));
+
+  ASSERT_FALSE(result.has_value());
+  EXPECT_EQ(DiceErrorCode::InvalidExpression, result.error().code);
+  EXPECT_EQ("Input expression is not valid.", result.error().message);
+  EXPECT_EQ(10, result.error().offset);
+}
+
+TEST(Parser, try_parse_UnclosedParenthesis_ReturnsErrorAtParenthesis)
+{
+  auto result = try_parse(tokenize("1 + ((2)"));
+
+  ASSERT_FALSE(result.has_value());
+  EXPECT_EQ(DiceErrorCode::UnclosedParenthetical, result.error().code);
+  EXPECT_EQ(4, result.error().offset);
+}
+
+TEST(Parser, try_parse_MisplacedToken_ReturnsErrorAtToken)
+{
+  auto result = try_parse(tokenize("2d6 (2)"));
+
+  ASSERT_FALSE(result.has_value());
+  EXPECT_EQ(DiceErrorCode::InvalidExpression, result.error().code);
+  EXPECT_EQ(4, result.error().offset);
+}
+
+TEST(Parser, tryExecute_DivisionByZero_ReturnsErrorAtOperator)
+{
+  auto tree = parse(tokenize("6 / (d1 - 1)"));
+
+  std::mt19937 rng(1);
+  auto result = tree->tryExecute({.rng = rng});
+
+  ASSERT_FALSE(result.has_value());
+  EXPECT_EQ(DiceErrorCode::DivisionByZero, result.error().code);
+  EXPECT_EQ(2, result.error().offset);
+}
+
+TEST(Parser, parse_ExplodingLongRoll_AnalyzeReturnsExplodingMoments)
+{
+  auto tree = parse(tokenize("2d6!"));
+
+  auto result = tree->analyze();
+
+  EXPECT_NEAR(8.4, result.mean, 1e-9);
+  EXPECT_EQ(2, result.min);
+}
+
+TEST(Parser, parse_ExplodingShortRoll_ExecutesAsPoolOfOne)
+{
+  auto tree = parse(tokenize("d2!"));
+
+  auto result = tree->execute();
+
+  EXPECT_EQ(1, result.result % 2);
+  EXPECT_NE(std::string::npos, result.description.find("Rolling 1d2!..."));
+}
+
+TEST(Parser, try_parse_ExplodingSingleFacedDie_ReturnsErrorAtExclamationMark)
+{
+  auto result = try_parse(tokenize("3d1! + 1"));
+
+  ASSERT_FALSE(result.has_value());
+  EXPECT_EQ(DiceErrorCode::InvalidExpression, result.error().code);
+  EXPECT_EQ(3, result.error().offset);
+}
+
+TEST(Parser, parse_SuccessCount_AnalyzeReturnsBinomialMoments)
+{
+  auto tree = parse(tokenize("50d10s>=7"));
+
+  auto result = tree->analyze();
+
+  EXPECT_NEAR(20, result.mean, 1e-9);
+  EXPECT_NEAR(12, result.variance, 1e-9);
+  EXPECT_EQ(0, result.min);
+  EXPECT_EQ(50, result.max);
+}
+
+TEST(Parser, parse_SuccessCountOfShortRoll_DistributionIsBernoulli)
+{
+  auto tree = parse(tokenize("d20s>=15 + 1"));
+
+  auto result = tree->distribution();
+
+  EXPECT_EQ(1, result.offset);
+  ASSERT_EQ(2, result.probabilities.size());
+  EXPECT_NEAR(0.3, result.probabilities[1], 1e-12);
+}
+
+TEST(Parser, parse_GreaterEqualAfterKeptDice_ComparesTheKeptSum)
+{
+  // Pools either keep dice or count successes, so this is a comparison.
+  auto tree = parse(tokenize("4d6h3>=5"));
+
+  auto result = tree->distribution();
+
+  ASSERT_EQ(2, result.probabilities.size());
+  // The kept sum is below 5 only for 3 (1 of 1296 rolls) and 4 (4 of them).
+  EXPECT_NEAR(1 - 5.0 / 1296, result.probabilities[1], 1e-12);
+}
+
+TEST(Parser, parse_Comparisons_ExecuteToZeroOrOne)
+{
+  EXPECT_EQ(1, parse(tokenize("2 + 3 >= 5"))->execute().result);
+  EXPECT_EQ(0, parse(tokenize("2 + 3 > 5"))->execute().result);
+  EXPECT_EQ(1, parse(tokenize("4 <= 2 * 2"))->execute().result);
+  EXPECT_EQ(0, parse(tokenize("4 < 4"))->execute().result);
+  EXPECT_EQ(1, parse(tokenize("(1 = 1) + (2 = 3) * 5 = 1"))->execute().result);
+}
+
+TEST(Parser, parse_Comparison_DistributionSumsJointMass)
+{
+  auto tree = parse(tokenize("2d20h1 + 5 >= 15"));
+
+  auto result = tree->distribution();
+
+  EXPECT_EQ(0, result.offset);
+  ASSERT_EQ(2, result.probabilities.size());
+  // The higher of two d20 is at least 10 unless both are below it.
+  EXPECT_NEAR(1 - 0.45 * 0.45, result.probabilities[1], 1e-12);
+  EXPECT_NEAR(0.45 * 0.45, result.probabilities[0], 1e-12);
+}
+
+TEST(Parser, parse_ComparisonOfRolls_ExecuteManyMatchesDistribution)
+{
+  auto tree = parse(tokenize("d6 < d6"));
+  std::mt19937 rng(3);
+  std::vector<long> results(60000);
+
+  tree->executeMany({.rng = rng}, results);
+
+  double hits = 0;
+  for (long result : results)
+  {
+    ASSERT_TRUE(result == 0 || result == 1);
+    hits += static_cast<double>(result);
+  }
+  EXPECT_NEAR(15.0 / 36, hits / results.size(), 0.01);
+  EXPECT_NEAR(15.0 / 36, tree->distribution().probabilities[1], 1e-12);
+}
+
+TEST(Parser, parse_Comparison_AnalyzeApproximatesChance)
+{
+  auto undecided = parse(tokenize("3d6 + 0 > 10"))->analyze();
+  auto decided = parse(tokenize("3d6 + 0 >= 3"))->analyze();
+
+  EXPECT_NEAR(0.5, undecided.mean, 0.02);
+  EXPECT_EQ(0, undecided.min);
+  EXPECT_EQ(1, undecided.max);
+  EXPECT_FALSE(undecided.exact);
+  EXPECT_EQ(1, decided.min);
+  EXPECT_EQ(1, decided.max);
+  EXPECT_TRUE(decided.exact);
+}
+
+TEST(Parser, parse_GreaterEqualDirectlyAfterRoll_IsAComparison)
+{
+  for (const char *expression :
+       {"1d20 >= 15", "d20>=15", "5 + 1d20 >= 15", "2d6! >= 4"})
+  {
+    auto tree = try_parse(tokenize(expression));
+    std::mt19937 rng(1);
+
+    ASSERT_TRUE(tree.has_value()) << expression;
+    for (int i = 0; i < 20; i++)
+    {
+      auto result = tree.value()->execute({.rng = rng});
+      EXPECT_TRUE(result == 0 || result == 1) << expression;
+    }
+  }
+}
+
+TEST(Parser, distribution_RollAtLeastTarget_IsChanceOfReachingIt)
+{
+  auto plain = parse(tokenize("1d20 >= 15"))->distribution();
+  auto modified = parse(tokenize("1d20 + 5 >= 15"))->distribution();
+
+  ASSERT_EQ(2, plain.probabilities.size());
+  EXPECT_NEAR(6.0 / 20, plain.probabilities[1], 1e-12);
+  ASSERT_EQ(2, modified.probabilities.size());
+  EXPECT_NEAR(11.0 / 20, modified.probabilities[1], 1e-12);
+}
+
+TEST(Parser, parse_ParenthesizedRoll_ComparesWithGreaterEqual)
+{
+  auto tree = parse(tokenize("(3d6) >= 10"));
+
+  EXPECT_NEAR(0.625, tree->distribution().probabilities[1], 1e-12);
+}
+
+TEST(Parser, try_parse_SuccessesWithoutGreaterEqual_ReturnsErrorAtToken)
+{
+  auto result = try_parse(tokenize("3d6s5"));
+
+  ASSERT_FALSE(result.has_value());
+  EXPECT_EQ(DiceErrorCode::InvalidExpression, result.error().code);
+  EXPECT_EQ(4, result.error().offset);
+}
+
+TEST(Parser, try_parse_ChainedComparison_ReturnsErrorAtSecondComparison)
+{
+  auto result = try_parse(tokenize("1 < 2 < 3"));
+
+  ASSERT_FALSE(result.has_value());
+  EXPECT_EQ(DiceErrorCode::InvalidExpression, result.error().code);
+  EXPECT_EQ(6, result.error().offset);
+}
+
+TEST(Parser, tryExecute_SameSeedOnManyThreads_SharesOneTree)
+{
+  const std::unique_ptr<Tree> tree = parse(tokenize("4d6h3 + 2d20 * d8!"));
+  std::mt19937 reference(41);
+  long expected = tree->execute({.rng = reference});
+
+  std::vector<long> results(8);
+  std::vector<std::thread> threads;
+  for (std::size_t i = 0; i < results.size(); i++)
+  {
+    threads.emplace_back([&, i] {
+      std::mt19937 rng(41);
+      results[i] = tree->execute({.rng = rng});
+    });
+  }
+  for (auto &thread : threads)
+  {
+    thread.join();
+  }
+
+  EXPECT_THAT(results, testing::Each(expected));
+}
+
+TEST(Parser, tryExecute_RollOverDiceLimit_ReturnsErrorAtRoll)
+{
+  auto tree = parse(tokenize("1 + 100d6"));
+  std::mt19937 rng(1);
+
+  auto result =
+      tree->tryExecute({.rng = rng, .limits = {.maxDicePerRoll = 99}});
+
+  ASSERT_FALSE(result.has_value());
+  EXPECT_EQ(DiceErrorCode::TooManyDice, result.error().code);
+  EXPECT_EQ("Cannot roll 100 dice at once.", result.error().message);
+  EXPECT_EQ(4, result.error().offset);
+  EXPECT_TRUE(
+      tree->tryExecute({.rng = rng, .limits = {.maxDicePerRoll = 100}})
+          .has_value()
+  );
+}
+
+TEST(Parser, tryExecute_ShortRollOverDiceLimit_ReturnsErrorAtRoll)
+{
+  auto tree = parse(tokenize("2 * d6"));
+  std::mt19937 rng(1);
+  std::vector<long> results(4);
+
+  auto result =
+      tree->tryExecute({.rng = rng, .limits = {.maxDicePerRoll = 0}});
+
+  ASSERT_FALSE(result.has_value());
+  EXPECT_EQ(DiceErrorCode::TooManyDice, result.error().code);
+  EXPECT_EQ("Cannot roll 1 die at once.", result.error().message);
+  EXPECT_EQ(4, result.error().offset);
+  EXPECT_THROW(
+      tree->executeMany({.rng = rng, .limits = {.maxDicePerRoll = 0}}, results),
+      DiceException
+  );
+}
@@ -0,0 +1,101 @@
+#include "dice_exception.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "planner.hpp"
+#include <gtest/gtest.h>
+
+ExecutionPlan
+plan_expression(const std::string &expression, PlanOptions options)
+{
+  return plan_execution(*parse(tokenize(expression)), options);
+}
+
+TEST(Planner, plan_execution_Expression_HasStepPerNode)
+{
+  auto plan = plan_expression("4d6h3 + 2 * d8", {});
+
+  ASSERT_EQ(5, plan.steps.size());
+  EXPECT_EQ("math (+)", plan.steps[0].node);
+  EXPECT_EQ(0, plan.steps[0].depth);
+  EXPECT_EQ("4d6h3", plan.steps[1].node);
+  EXPECT_EQ(1, plan.steps[1].depth);
+  EXPECT_EQ("math (*)", plan.steps[2].node);
+  EXPECT_EQ("2", plan.steps[3].node);
+  EXPECT_EQ("constant", plan.steps[3].strategy);
+  EXPECT_EQ("d8", plan.steps[4].node);
+  EXPECT_EQ(2, plan.steps[4].depth);
+  EXPECT_FALSE(plan.aliasTable);
+}
+
+TEST(Planner, plan_execution_Traced_RollsTracedDice)
+{
+  auto plan = plan_expression("4d6h3", {.traced = true});
+
+  EXPECT_EQ("traced dice", plan.steps[0].strategy);
+}
+
+TEST(Planner, plan_execution_RollStrategies_FollowPoolShape)
+{
+  EXPECT_EQ("sum", plan_expression("10d6", {}).steps[0].strategy);
+  EXPECT_EQ("face counts", plan_expression("100d6h50", {}).steps[0].strategy);
+  EXPECT_EQ(
+      "heap selection", plan_expression("20d100000h1", {}).steps[0].strategy
+  );
+  EXPECT_EQ("sorting network", plan_expression("4d6h3", {}).steps[0].strategy);
+  EXPECT_EQ(
+      "binomial draw", plan_expression("50d10s>=7", {}).steps[0].strategy
+  );
+  EXPECT_EQ(
+      "negative binomial draw", plan_expression("5d6!", {}).steps[0].strategy
+  );
+}
+
+TEST(Planner, plan_execution_ManySamples_ChoosesAliasTable)
+{
+  auto plan =
+      plan_expression("4d6h3", {.samples = 1000000, .aliasBudget = 1 << 20});
+
+  EXPECT_TRUE(plan.aliasTable);
+}
+
+TEST(Planner, plan_execution_FewSamplesOfWideExpression_EvaluatesTree)
+{
+  auto plan =
+      plan_expression("10d1000", {.samples = 10, .aliasBudget = 1 << 20});
+
+  EXPECT_FALSE(plan.aliasTable);
+}
+
+TEST(Planner, plan_execution_AliasTableOverMemoryBudget_EvaluatesTree)
+{
+  auto plan = plan_expression(
+      "4d6h3", {.samples = 1000000, .aliasBudget = 1 << 20, .maxBytes = 64}
+  );
+
+  EXPECT_FALSE(plan.aliasTable);
+}
+
+TEST(Planner, plan_execution_OverTimeBudget_ThrowsException)
+{
+  EXPECT_THROW(
+      plan_expression("1000000d6", {.samples = 1000000, .maxSeconds = 1}),
+      DiceException
+  );
+}
+
+TEST(Planner, plan_execution_OverMemoryBudget_ThrowsException)
+{
+  EXPECT_THROW(
+      plan_expression("1000d60000h500", {.maxBytes = 1024}), DiceException
+  );
+}
+
+TEST(Planner, explain_plan_Plan_DescribesEachNode)
+{
+  auto explanation = explain_plan(plan_expression("3d6 + 1", {}));
+
+  EXPECT_NE(std::string::npos, explanation.find("Evaluate each node"));
+  EXPECT_NE(std::string::npos, explanation.find("  math (+): arithmetic"));
+  EXPECT_NE(std::string::npos, explanation.find("    3d6: sum"));
+  EXPECT_NE(std::string::npos, explanation.find("    1: constant"));
+}
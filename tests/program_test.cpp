@@ -0,0 +1,152 @@
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "program.hpp"
+#include <gtest/gtest.h>
+
+std::vector<CompiledNode> compile_expression(const std::string &expression)
+{
+  std::vector<CompiledNode> program;
+  parse(tokenize(expression))->compile(program);
+  return program;
+}
+
+CompiledNode compiled_integer(std::uint64_t value)
+{
+  return {CompiledNodeKind::Integer, KeepMode::None, value, 0, 0, 0};
+}
+
+CompiledNode compiled_operation(CompiledNodeKind kind)
+{
+  return {kind, KeepMode::None, 0, 0, 0, 0};
+}
+
+TEST(Program, compile_MixedPrecedence_EmitsPostfixOrder)
+{
+  auto program = compile_expression("1 + 2 * 3 - 4");
+
+  std::vector<CompiledNodeKind> kinds;
+  for (const auto &node : program)
+  {
+    kinds.push_back(node.kind);
+  }
+
+  EXPECT_EQ(
+      kinds,
+      (std::vector<CompiledNodeKind>{
+          CompiledNodeKind::Integer,
+          CompiledNodeKind::Integer,
+          CompiledNodeKind::Integer,
+          CompiledNodeKind::Multiply,
+          CompiledNodeKind::Add,
+          CompiledNodeKind::Integer,
+          CompiledNodeKind::Subtract,
+      })
+  );
+}
+
+TEST(Program, evaluate_program_CompiledExpression_MatchesTree)
+{
+  auto program = compile_expression("(4d1h3 + d1) * 10 / (2 - 0) - 3d1l1");
+  auto depth = validate_program(program);
+
+  ASSERT_TRUE(depth.has_value());
+  EXPECT_EQ(3, depth.value());
+  std::mt19937 rng(1);
+  auto result = evaluate_program(program, depth.value(), {.rng = rng});
+  EXPECT_EQ(19, result.value());
+}
+
+TEST(Program, evaluate_program_SuccessCounts_CountTheTargetedDice)
+{
+  auto program = compile_expression("10d6s>=7 + 5d6s>=1 + 3d6!s>=1");
+
+  std::mt19937 rng(1);
+  auto depth = validate_program(program).value();
+  auto result = evaluate_program(program, depth, {.rng = rng});
+
+  EXPECT_EQ(8, result.value());
+}
+
+TEST(Program, evaluate_program_Comparisons_LeaveZeroOrOne)
+{
+  auto program = compile_expression("(3 >= 3) + (3 <= 2) * 2 + (4 > 1) * 4 + "
+                                    "(1 < 1) * 8 + (d1 = 1) * 16");
+
+  std::mt19937 rng(1);
+  auto depth = validate_program(program).value();
+  auto result = evaluate_program(program, depth, {.rng = rng});
+
+  EXPECT_EQ(21, result.value());
+}
+
+TEST(Program, evaluate_program_RollOverDiceLimit_ReturnsError)
+{
+  auto program = compile_expression("2 * 50d6");
+  std::mt19937 rng(1);
+
+  auto depth = validate_program(program).value();
+  auto result = evaluate_program(
+      program, depth, {.rng = rng, .limits = {.maxDicePerRoll = 49}}
+  );
+
+  ASSERT_FALSE(result.has_value());
+  EXPECT_EQ(DiceErrorCode::TooManyDice, result.error().code);
+  EXPECT_EQ(4, result.error().offset);
+}
+
+TEST(Program, evaluate_program_ShortRollOverDiceLimit_ReturnsErrorAtRoll)
+{
+  auto program = compile_expression("1 + d6");
+  std::mt19937 rng(1);
+
+  auto depth = validate_program(program).value();
+  auto result = evaluate_program(
+      program, depth, {.rng = rng, .limits = {.maxDicePerRoll = 0}}
+  );
+
+  ASSERT_FALSE(result.has_value());
+  EXPECT_EQ(DiceErrorCode::TooManyDice, result.error().code);
+  EXPECT_EQ("Cannot roll 1 die at once.", result.error().message);
+  EXPECT_EQ(4, result.error().offset);
+}
+
+TEST(Program, evaluate_program_DivisionByZero_ReturnsErrorAtOperator)
+{
+  auto program = compile_expression("1 + 2 / 0");
+  std::mt19937 rng(1);
+  auto depth = validate_program(program).value();
+  auto result = evaluate_program(program, depth, {.rng = rng});
+
+  ASSERT_FALSE(result.has_value());
+  EXPECT_EQ(DiceErrorCode::DivisionByZero, result.error().code);
+  EXPECT_EQ(6, result.error().offset);
+}
+
+TEST(Program, validate_program_MissingOperand_ReturnsError)
+{
+  std::vector<CompiledNode> program = {
+      compiled_integer(1),
+      compiled_operation(CompiledNodeKind::Add),
+  };
+
+  EXPECT_FALSE(validate_program(program).has_value());
+}
+
+TEST(Program, validate_program_LeftoverOperand_ReturnsError)
+{
+  std::vector<CompiledNode> program = {
+      compiled_integer(1),
+      compiled_integer(2),
+  };
+
+  EXPECT_FALSE(validate_program(program).has_value());
+}
+
+TEST(Program, validate_program_UnknownKind_ReturnsError)
+{
+  std::vector<CompiledNode> program = {
+      compiled_operation(static_cast<CompiledNodeKind>(99))
+  };
+
+  EXPECT_FALSE(validate_program(program).has_value());
+}
@@ -0,0 +1,124 @@
+#include "quantile_sketch.hpp"
+#include <algorithm>
+#include <atomic>
+#include <gtest/gtest.h>
+#include <numeric>
+#include <random>
+
+// Rank of `value` among 0 ... n - 1 as a fraction of n.
+double uniform_rank(long value, long n)
+{
+  return static_cast<double>(value) / static_cast<double>(n);
+}
+
+TEST(QuantileSketch, quantile_FewerValuesThanSize_IsExact)
+{
+  QuantileSketch sketch;
+  for (long value = 1; value <= 100; value++)
+  {
+    sketch.add(value);
+  }
+
+  EXPECT_EQ(100, sketch.count());
+  EXPECT_EQ(100, sketch.retained());
+  EXPECT_EQ(1, sketch.quantile(0));
+  EXPECT_EQ(50, sketch.quantile(0.5));
+  EXPECT_EQ(99, sketch.quantile(0.99));
+  EXPECT_EQ(100, sketch.quantile(1));
+}
+
+TEST(QuantileSketch, quantile_ShuffledStream_WithinRankError)
+{
+  constexpr long n = 1000000;
+  std::vector<long> values(n);
+  std::iota(values.begin(), values.end(), 0);
+  std::shuffle(values.begin(), values.end(), std::mt19937(1));
+
+  QuantileSketch sketch;
+  sketch.add(values);
+
+  double error = quantile_rank_error(defaultQuantileSketchSize);
+  for (double fraction : {0.01, 0.1, 0.25, 0.5, 0.75, 0.9, 0.99})
+  {
+    EXPECT_NEAR(fraction, uniform_rank(sketch.quantile(fraction), n), error)
+        << fraction;
+  }
+  EXPECT_EQ(0, sketch.quantile(0));
+  EXPECT_EQ(n - 1, sketch.quantile(1));
+}
+
+TEST(QuantileSketch, retained_ManyWideRangingValues_StaysBounded)
+{
+  QuantileSketch sketch;
+  std::mt19937_64 rng(2);
+  std::uniform_int_distribution<long> wide(-(1L << 60), 1L << 60);
+
+  std::size_t mostRetained = 0;
+  for (int i = 0; i < 4000000; i++)
+  {
+    sketch.add(wide(rng));
+    mostRetained = std::max(mostRetained, sketch.retained());
+  }
+
+  EXPECT_LT(mostRetained, 4 * defaultQuantileSketchSize);
+}
+
+TEST(QuantileSketch, merge_ShardedStream_WithinRankErrorOfWhole)
+{
+  constexpr long n = 400000;
+  std::vector<QuantileSketch> shards;
+  for (std::uint64_t seed = 0; seed < 8; seed++)
+  {
+    shards.emplace_back(defaultQuantileSketchSize, seed);
+  }
+  for (long value = 0; value < n; value++)
+  {
+    shards[static_cast<std::size_t>(value * 7919 % 8)].add(value);
+  }
+
+  QuantileSketch merged;
+  for (const auto &shard : shards)
+  {
+    merged.merge(shard);
+  }
+
+  EXPECT_EQ(n, merged.count());
+  double error = quantile_rank_error(defaultQuantileSketchSize);
+  for (double fraction : {0.05, 0.5, 0.95})
+  {
+    EXPECT_NEAR(fraction, uniform_rank(merged.quantile(fraction), n), error);
+  }
+  EXPECT_LT(merged.retained(), 4 * defaultQuantileSketchSize);
+}
+
+TEST(QuantileSketch, merge_EmptySketch_ChangesNothing)
+{
+  QuantileSketch sketch;
+  sketch.add(std::vector<long>{5, 3, 9});
+
+  sketch.merge(QuantileSketch());
+
+  EXPECT_EQ(3, sketch.count());
+  EXPECT_EQ(3, sketch.quantile(0));
+  EXPECT_EQ(9, sketch.quantile(1));
+}
+
+TEST(QuantileSketch, quantile_rank_error_LargerSize_IsSmaller)
+{
+  EXPECT_NEAR(0.0133, quantile_rank_error(200), 0.0005);
+  EXPECT_LT(quantile_rank_error(1000), quantile_rank_error(200));
+}
+
+TEST(QuantileSketch, sketch_samples_SamplesOnPool_CountsEverySample)
+{
+  std::atomic<unsigned long> sampled = 0;
+
+  auto sketch = sketch_samples(123457, 100, [&](std::span<long> results) {
+    std::fill(results.begin(), results.end(), 7);
+    sampled += results.size();
+  });
+
+  EXPECT_EQ(123457, sampled.load());
+  EXPECT_EQ(123457, sketch.count());
+  EXPECT_EQ(7, sketch.quantile(0.5));
+}
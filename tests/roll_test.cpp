@@ -0,0 +1,263 @@
+#include "roll.hpp"
+#include <algorithm>
+#include <cmath>
+#include <gtest/gtest.h>
+
+KeptDiceAccumulator
+accumulate(const Pool &pool, const std::vector<unsigned long> &rolls)
+{
+  KeptDiceAccumulator accumulator(pool);
+  for (unsigned long roll : rolls)
+  {
+    accumulator.add(roll);
+  }
+  return accumulator;
+}
+
+TEST(Roll, sum_NoKeep_ReturnsTotal)
+{
+  auto accumulator = accumulate({4, 6, KeepMode::None, 0}, {1, 6, 3, 2});
+
+  EXPECT_EQ(accumulator.sum(), 12);
+}
+
+TEST(Roll, sum_KeepHighest_ReturnsHighestDice)
+{
+  auto accumulator = accumulate({5, 6, KeepMode::Highest, 2}, {1, 6, 3, 2, 5});
+
+  EXPECT_EQ(accumulator.sum(), 11);
+}
+
+TEST(Roll, sum_KeepLowest_ReturnsLowestDice)
+{
+  auto accumulator = accumulate({5, 6, KeepMode::Lowest, 2}, {4, 6, 3, 2, 5});
+
+  EXPECT_EQ(accumulator.sum(), 5);
+}
+
+TEST(Roll, sum_KeepMoreThanRolled_ReturnsTotal)
+{
+  auto accumulator = accumulate({2, 6, KeepMode::Highest, 3}, {4, 6});
+
+  EXPECT_EQ(accumulator.sum(), 10);
+}
+
+TEST(Roll, sum_ManyFacesKeepFew_ReturnsHighestDice)
+{
+  auto accumulator = accumulate(
+      {5, 1000000, KeepMode::Highest, 2}, {10, 999999, 300, 20, 500000}
+  );
+
+  EXPECT_EQ(accumulator.sum(), 1499999);
+}
+
+TEST(Roll, sum_ManyFacesKeepMost_ReturnsLowestDice)
+{
+  auto accumulator = accumulate(
+      {5, 1000000, KeepMode::Lowest, 4}, {10, 999999, 300, 20, 500000}
+  );
+
+  EXPECT_EQ(accumulator.sum(), 500330);
+}
+
+TEST(Roll, merge_SplitRolls_MatchesSingleAccumulator)
+{
+  Pool pool = {6, 1000000, KeepMode::Highest, 3};
+  auto whole = accumulate(pool, {7, 8000, 3, 999, 123456, 42});
+  auto merged = accumulate(pool, {7, 8000, 3});
+  merged.merge(accumulate(pool, {999, 123456, 42}));
+
+  EXPECT_EQ(merged.sum(), whole.sum());
+}
+
+TEST(Roll, roll_pool_ParallelPool_SumsEveryDie)
+{
+  std::mt19937 rng(1);
+
+  long result =
+      roll_pool({3000000, 1, KeepMode::Lowest, 2000000}, rng, nullptr);
+
+  EXPECT_EQ(result, 2000000);
+}
+
+TEST(Roll, roll_pool_SameSeed_SameResult)
+{
+  Pool pool = {2000000, 20, KeepMode::Highest, 1000};
+  std::mt19937 first(7);
+  std::mt19937 second(7);
+
+  EXPECT_EQ(roll_pool(pool, first, nullptr), roll_pool(pool, second, nullptr));
+}
+
+TEST(Roll, roll_pool_Trace_WritesEachDieInOrder)
+{
+  std::mt19937 rng(3);
+  StringTraceSink trace;
+
+  long result = roll_pool({3, 1, KeepMode::Highest, 2}, rng, &trace);
+
+  EXPECT_EQ(result, 2);
+  EXPECT_EQ(trace.str(), "You rolled: 1\nYou rolled: 1\nYou rolled: 1\n");
+}
+
+TEST(Roll, roll_pool_many_KeepLowest_ClearsBetweenSamples)
+{
+  std::mt19937 rng(5);
+  std::vector<long> results(50);
+
+  roll_pool_many({10, 1, KeepMode::Lowest, 4}, rng, results);
+
+  EXPECT_EQ(std::count(results.begin(), results.end(), 4), 50);
+}
+
+TEST(Roll, roll_pool_Exploding_NeverRollsTheHighestFaceLast)
+{
+  std::mt19937 rng(11);
+  StringTraceSink trace;
+
+  roll_pool({200, 4, KeepMode::None, 0, true}, rng, &trace);
+
+  // Every die is at least 1, and no die can end on a multiple of its faces.
+  EXPECT_EQ(trace.str().find("You rolled: 0\n"), std::string::npos);
+  EXPECT_EQ(trace.str().find("You rolled: 4\n"), std::string::npos);
+  EXPECT_EQ(trace.str().find("You rolled: 8\n"), std::string::npos);
+}
+
+TEST(Roll, roll_pool_many_ExplodingPool_MatchesExpectedMean)
+{
+  std::mt19937 rng(13);
+  std::vector<long> results(20000);
+
+  roll_pool_many({10, 6, KeepMode::None, 0, true}, rng, results);
+
+  double mean = 0;
+  for (long result : results)
+  {
+    EXPECT_GE(result, 10);
+    mean += static_cast<double>(result) / results.size();
+  }
+  // 10 dice of mean 4.2 and standard deviation 3.5 per die.
+  EXPECT_NEAR(mean, 42, 0.3);
+}
+
+TEST(Roll, roll_pool_ExplodingKeepHighest_StaysAtOrAboveKeptDice)
+{
+  std::mt19937 rng(17);
+
+  for (int i = 0; i < 100; i++)
+  {
+    EXPECT_GE(roll_pool({4, 2, KeepMode::Highest, 3, true}, rng, nullptr), 3);
+  }
+}
+
+TEST(Roll, success_probability_ExplodingTarget_CountsExplosions)
+{
+  EXPECT_DOUBLE_EQ(1, success_probability({1, 10, KeepMode::None, 0}));
+  EXPECT_DOUBLE_EQ(
+      0.4, success_probability({1, 10, KeepMode::None, 0, false, 7})
+  );
+  EXPECT_DOUBLE_EQ(
+      0, success_probability({1, 10, KeepMode::None, 0, false, 11})
+  );
+  // 11 or more needs one explosion and then anything.
+  EXPECT_DOUBLE_EQ(
+      0.1, success_probability({1, 10, KeepMode::None, 0, true, 11})
+  );
+  EXPECT_DOUBLE_EQ(
+      0.01 * 0.5, success_probability({1, 10, KeepMode::None, 0, true, 26})
+  );
+}
+
+TEST(Roll, roll_pool_SuccessCountWithTrace_CountsTracedDice)
+{
+  std::mt19937 rng(19);
+  StringTraceSink trace;
+
+  long result = roll_pool({50, 2, KeepMode::None, 0, false, 2}, rng, &trace);
+
+  long traced = 0;
+  for (std::size_t at = trace.str().find("You rolled: 2\n");
+       at != std::string::npos;
+       at = trace.str().find("You rolled: 2\n", at + 1))
+  {
+    traced++;
+  }
+  EXPECT_EQ(traced, result);
+}
+
+TEST(Roll, roll_pool_many_HugeSuccessCount_MatchesBinomialMean)
+{
+  std::mt19937 rng(23);
+  std::vector<long> results(1000);
+
+  roll_pool_many({1000000000, 10, KeepMode::None, 0, false, 7}, rng, results);
+
+  double mean = 0;
+  for (long result : results)
+  {
+    mean += static_cast<double>(result) / results.size();
+  }
+  // Binomial(1e9, 0.4) has a standard deviation of about 15500.
+  EXPECT_NEAR(mean, 4e8, 2000);
+}
+
+TEST(Roll, plan_roll_KeepNone_PlansConstantZero)
+{
+  for (unsigned long die : {1UL, 16UL, 2000000UL})
+  {
+    Pool pool = {die, 6, KeepMode::Highest, 0};
+    std::mt19937 rng(23);
+    std::vector<long> results(3, -1);
+
+    auto plan = plan_roll(pool, false);
+    roll_pool_many(pool, rng, results);
+
+    EXPECT_EQ(RollStrategy::Constant, plan.strategy);
+    EXPECT_EQ(0, plan.nanoseconds);
+    EXPECT_EQ(0, roll_pool(pool, rng, nullptr));
+    EXPECT_EQ(std::vector<long>(3, 0), results);
+    EXPECT_TRUE(std::isfinite(plan_roll(pool, true).nanoseconds));
+  }
+}
+
+TEST(Roll, roll_pool_SmallPools_KeepSortedDice)
+{
+  std::vector<Pool> pools = {
+      {2, 20, KeepMode::Highest, 1},
+      {2, 20, KeepMode::Lowest, 1},
+      {4, 6, KeepMode::Highest, 3},
+      {4, 6, KeepMode::Lowest, 2},
+      {5, 10, KeepMode::Highest, 3},
+      {9, 100, KeepMode::Lowest, 4},
+      {16, 8, KeepMode::Highest, 7},
+      {16, 8, KeepMode::Lowest, 1},
+  };
+
+  for (const auto &pool : pools)
+  {
+    ASSERT_EQ(RollStrategy::SortingNetwork, plan_roll(pool, false).strategy);
+    std::mt19937 rng(19);
+    for (int i = 0; i < 100; i++)
+    {
+      // The same dice, rolled from a copy of the generator.
+      std::mt19937 copy = rng;
+      std::uniform_int_distribution<unsigned long> distribution(1, pool.faces);
+      std::vector<unsigned long> dice(pool.die);
+      std::generate(dice.begin(), dice.end(), [&] {
+        return distribution(copy);
+      });
+      std::sort(dice.begin(), dice.end());
+      if (pool.keepMode == KeepMode::Highest)
+      {
+        std::reverse(dice.begin(), dice.end());
+      }
+      unsigned long expected = 0;
+      for (unsigned long j = 0; j < pool.keepCount; j++)
+      {
+        expected += dice[j];
+      }
+
+      EXPECT_EQ(static_cast<long>(expected), roll_pool(pool, rng, nullptr));
+    }
+  }
+}
@@ -0,0 +1,285 @@
+#include "alias_table.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <gtest/gtest.h>
+#include <random>
+
+// Each test samples with a fixed seed, so a given build always sees the same
+// samples and passes or fails deterministically. The thresholds are at a
+// significance level of 1e-4, loose enough that a correct sampler is
+// unlikely to fail for any seed and tight enough to catch a bias of a
+// fraction of a percent at these sample counts.
+constexpr unsigned long statisticalSamples = 200000;
+// Standard normal quantile for the 1 - 1e-4 chi-squared threshold.
+constexpr double chiSquaredZ = 3.719;
+// Kolmogorov distribution quantile at 1 - 1e-4.
+constexpr double kolmogorovQuantile = 2.1;
+// Outcomes expected fewer times than this are pooled with their neighbours.
+constexpr double minExpectedCount = 20;
+
+std::vector<long> sample_expression(
+    const std::string &expression,
+    unsigned long samples,
+    std::uint32_t seed
+)
+{
+  auto tree = parse(tokenize(expression));
+  std::mt19937 rng(seed);
+  std::vector<long> results(samples);
+  tree->executeMany({.rng = rng}, results);
+  return results;
+}
+
+// Wilson-Hilferty approximation of the chi-squared quantile.
+double chi_squared_threshold(double degrees)
+{
+  double scale = 2 / (9 * degrees);
+  return degrees * std::pow(1 - scale + chiSquaredZ * std::sqrt(scale), 3);
+}
+
+struct ChiSquaredResult
+{
+  double statistic;
+  double degrees;
+};
+
+// Pearson's statistic of `samples` against `reference`, pooling runs of
+// unlikely outcomes (and samples outside the reference's support) so that
+// every cell expects at least minExpectedCount samples.
+ChiSquaredResult
+chi_squared(const std::vector<long> &samples, const Distribution &reference)
+{
+  std::vector<double> observed(reference.probabilities.size(), 0);
+  double outside = 0;
+  for (long sample : samples)
+  {
+    long index = sample - reference.offset;
+    if (index < 0 || index >= static_cast<long>(observed.size()))
+    {
+      outside++;
+      continue;
+    }
+    observed[index]++;
+  }
+
+  double n = static_cast<double>(samples.size());
+  double statistic = 0;
+  double cells = 0;
+  double cellExpected = 0;
+  double cellObserved = outside;
+  for (std::size_t i = 0; i < observed.size(); i++)
+  {
+    cellExpected += reference.probabilities[i] * n;
+    cellObserved += observed[i];
+    if (cellExpected >= minExpectedCount)
+    {
+      double difference = cellObserved - cellExpected;
+      statistic += difference * difference / cellExpected;
+      cells++;
+      cellExpected = 0;
+      cellObserved = 0;
+    }
+  }
+  // Whatever is left over (the upper tail) is its own cell, since even a
+  // small expectation there must not be observed much more often.
+  if (cellExpected > 0 || cellObserved > 0)
+  {
+    double difference = cellObserved - cellExpected;
+    statistic += difference * difference / std::max(cellExpected, 1.0);
+    cells++;
+  }
+
+  return {.statistic = statistic, .degrees = std::max(1.0, cells - 1)};
+}
+
+// Largest distance between the empirical CDF of `samples` and `cdf`, checked
+// just below and at every distinct sample.
+double
+kolmogorov_smirnov(std::vector<long> samples, std::function<double(long)> cdf)
+{
+  std::sort(samples.begin(), samples.end());
+  double n = static_cast<double>(samples.size());
+  double distance = 0;
+
+  for (std::size_t i = 0; i < samples.size();)
+  {
+    std::size_t next = i;
+    while (next < samples.size() && samples[next] == samples[i])
+    {
+      next++;
+    }
+
+    double below = static_cast<double>(i) / n;
+    double atOrBelow = static_cast<double>(next) / n;
+    distance = std::max(distance, std::abs(below - cdf(samples[i] - 1)));
+    distance = std::max(distance, std::abs(atOrBelow - cdf(samples[i])));
+    i = next;
+  }
+
+  return distance;
+}
+
+std::function<double(long)> distribution_cdf(const Distribution &reference)
+{
+  std::vector<double> cumulative(reference.probabilities.size());
+  double total = 0;
+  for (std::size_t i = 0; i < cumulative.size(); i++)
+  {
+    total += reference.probabilities[i];
+    cumulative[i] = total;
+  }
+
+  return [offset = reference.offset, cumulative](long value) {
+    long index = value - offset;
+    if (index < 0)
+    {
+      return 0.0;
+    }
+    if (index >= static_cast<long>(cumulative.size()))
+    {
+      return 1.0;
+    }
+    return cumulative[index];
+  };
+}
+
+void expect_matches_distribution(
+    const std::string &expression,
+    const std::vector<long> &samples
+)
+{
+  auto reference = parse(tokenize(expression))->distribution();
+
+  auto chi = chi_squared(samples, reference);
+  EXPECT_LT(chi.statistic, chi_squared_threshold(chi.degrees))
+      << expression << " with " << chi.degrees << " degrees of freedom";
+
+  double ks = kolmogorov_smirnov(samples, distribution_cdf(reference));
+  EXPECT_LT(ks, kolmogorovQuantile / std::sqrt(samples.size())) << expression;
+}
+
+void expect_samples_match_distribution(
+    const std::string &expression,
+    std::uint32_t seed
+)
+{
+  expect_matches_distribution(
+      expression, sample_expression(expression, statisticalSamples, seed)
+  );
+}
+
+TEST(Statistical, executeMany_ShortRolls_MatchUniform)
+{
+  expect_samples_match_distribution("d6", 1);
+  expect_samples_match_distribution("d20", 2);
+  expect_samples_match_distribution("d1000", 3);
+}
+
+TEST(Statistical, executeMany_LongRolls_MatchConvolution)
+{
+  expect_samples_match_distribution("3d6", 4);
+  expect_samples_match_distribution("10d10", 5);
+  expect_samples_match_distribution("100d6", 6);
+}
+
+TEST(Statistical, executeMany_KeepHighest_MatchesOrderStatistics)
+{
+  expect_samples_match_distribution("4d6h3", 7);
+  expect_samples_match_distribution("2d20h1", 8);
+  expect_samples_match_distribution("20d6h5", 9);
+  expect_samples_match_distribution("5d10h3", 21);
+}
+
+TEST(Statistical, executeMany_KeepLowest_MatchesOrderStatistics)
+{
+  expect_samples_match_distribution("2d20l1", 10);
+  expect_samples_match_distribution("10d10l3", 11);
+  expect_samples_match_distribution("16d8l7", 22);
+}
+
+TEST(Statistical, executeMany_ExplodingDice_MatchTruncatedDistribution)
+{
+  expect_samples_match_distribution("d6!", 12);
+  expect_samples_match_distribution("5d6!", 13);
+  expect_samples_match_distribution("4d6!h3", 14);
+}
+
+TEST(Statistical, executeMany_SuccessCounts_MatchBinomial)
+{
+  expect_samples_match_distribution("50d10s>=7", 15);
+  expect_samples_match_distribution("5d6!s>=8", 16);
+}
+
+TEST(Statistical, executeMany_MathOnRolls_MatchesCombinedDistribution)
+{
+  expect_samples_match_distribution("2d6 * d4 - d8", 17);
+  expect_samples_match_distribution("(4d6h3 + 3) / 2", 18);
+  expect_samples_match_distribution("(2d20h1 + 5 >= 15) + (d6 < d8)", 23);
+}
+
+TEST(Statistical, execute_TracedRolls_MatchUntracedDistribution)
+{
+  // The traced path rolls dice one by one rather than in batches.
+  auto tree = parse(tokenize("4d6h3 + 3d6!"));
+  std::mt19937 rng(19);
+  StringTraceSink trace;
+  std::vector<long> samples(statisticalSamples / 4);
+  for (long &sample : samples)
+  {
+    sample = tree->execute({.rng = rng, .trace = &trace});
+  }
+
+  expect_matches_distribution("4d6h3 + 3d6!", samples);
+}
+
+TEST(Statistical, execute_KeepFromManyFaces_MatchesMaximumCdf)
+{
+  // Dice with this many faces are kept with a heap rather than face counts,
+  // and too many to compute the exact distribution, so the maximum of two
+  // dice is checked against its closed form CDF (x / faces)^2.
+  constexpr double faces = 1000000;
+  auto samples = sample_expression("2d1000000h1", statisticalSamples, 20);
+
+  double ks = kolmogorov_smirnov(samples, [faces](long value) {
+    double x = std::clamp(static_cast<double>(value), 0.0, faces);
+    return x / faces * (x / faces);
+  });
+
+  EXPECT_LT(ks, kolmogorovQuantile / std::sqrt(samples.size()));
+}
+
+TEST(Statistical, sampleMany_AliasTable_MatchesDistribution)
+{
+  for (const char *expression : {"4d6h3", "2d20h1", "3d6!"})
+  {
+    auto tree = parse(tokenize(expression));
+    auto table = build_alias_table(*tree, defaultAliasTableBudget);
+    ASSERT_TRUE(table.has_value()) << expression;
+
+    std::mt19937 rng(21);
+    std::vector<long> samples(statisticalSamples);
+    table->sampleMany(rng, samples);
+
+    expect_matches_distribution(expression, samples);
+  }
+}
+
+TEST(Statistical, chi_squared_BiasedDie_ExceedsThreshold)
+{
+  // The gate itself has to be able to fail: a d6 which rolls 6 one percent
+  // too often.
+  std::mt19937 rng(22);
+  std::discrete_distribution<long> biased({1, 1, 1, 1, 1, 1.06});
+  std::vector<long> samples(statisticalSamples);
+  for (long &sample : samples)
+  {
+    sample = biased(rng) + 1;
+  }
+
+  auto chi = chi_squared(samples, uniform_distribution(6));
+
+  EXPECT_GT(chi.statistic, chi_squared_threshold(chi.degrees));
+}
@@ -0,0 +1,113 @@
+#include "dice_exception.hpp"
+#include "summary.hpp"
+#include <gtest/gtest.h>
+#include <vector>
+
+SimulationSummary summary_of(std::vector<long> results)
+{
+  Histogram histogram(-100, 100);
+  histogram.add(results);
+  return summarize_simulation("2d6 - 7", histogram, Moments::of(results));
+}
+
+TEST(Summary, of_Results_ComputesMeanAndSquaredDeviations)
+{
+  std::vector<long> results = {2, 4, 4, 4, 5, 5, 7, 9};
+
+  auto moments = Moments::of(results);
+
+  EXPECT_EQ(8, moments.count);
+  EXPECT_DOUBLE_EQ(5, moments.mean);
+  EXPECT_DOUBLE_EQ(32, moments.m2);
+  EXPECT_DOUBLE_EQ(4, moments.variance());
+}
+
+TEST(Summary, merge_SplitResults_MatchesMomentsOfWhole)
+{
+  std::vector<long> whole = {1, 2, 3, 4, 5, 6, 7, 8, 9, 100};
+  std::span<const long> results(whole);
+
+  auto merged = Moments::of(results.subspan(0, 3));
+  merged.merge(Moments::of(results.subspan(3)));
+  auto expected = Moments::of(results);
+
+  EXPECT_EQ(expected.count, merged.count);
+  EXPECT_DOUBLE_EQ(expected.mean, merged.mean);
+  EXPECT_DOUBLE_EQ(expected.m2, merged.m2);
+}
+
+TEST(Summary, merge_LargeOffset_KeepsPrecision)
+{
+  // Summing squares would lose every digit of the variance here.
+  std::vector<long> first = {1000000000001, 1000000000003};
+  std::vector<long> second = {1000000000005, 1000000000007};
+
+  auto merged = Moments::of(first);
+  merged.merge(Moments::of(second));
+
+  EXPECT_DOUBLE_EQ(5, merged.variance());
+}
+
+TEST(Summary, merge_summaries_AnyGrouping_GivesSameSummary)
+{
+  auto a = summary_of({-5, 0, 3, 3});
+  auto b = summary_of({0, 1, 5});
+  auto c = summary_of({-5, 4, 4, 4, 5, 9});
+
+  auto left = merge_summaries(merge_summaries(a, b), c);
+  auto right = merge_summaries(a, merge_summaries(c, b));
+
+  EXPECT_EQ(left.counts, right.counts);
+  EXPECT_EQ(13, left.moments.count);
+  EXPECT_EQ(left.moments.count, right.moments.count);
+  EXPECT_NEAR(left.moments.mean, right.moments.mean, 1e-12);
+  EXPECT_NEAR(left.moments.m2, right.moments.m2, 1e-9);
+  std::vector<std::pair<long, unsigned long>> expected = {
+      {-5, 2}, {0, 2}, {1, 1}, {3, 2}, {4, 3}, {5, 2}, {9, 1}};
+  EXPECT_EQ(expected, left.counts);
+}
+
+TEST(Summary, merge_summaries_DifferentExpressions_ThrowsException)
+{
+  auto a = summary_of({1, 2});
+  auto b = summary_of({3});
+  b.expressionHash = expression_hash("2d6 - 6");
+
+  EXPECT_THROW(merge_summaries(a, b), DiceException);
+}
+
+TEST(Summary, expression_hash_Whitespace_IsIgnored)
+{
+  EXPECT_EQ(expression_hash("4d6h3 + 2"), expression_hash(" 4d6h3+2 "));
+  EXPECT_NE(expression_hash("4d6h3 + 2"), expression_hash("4d6l3 + 2"));
+}
+
+TEST(Summary, deserialize_summary_SerializedSummary_RoundTrips)
+{
+  auto summary = summary_of({-7, -2, 0, 0, 5, 5, 5});
+
+  auto parsed = deserialize_summary(serialize_summary(summary));
+
+  EXPECT_EQ(summary.expressionHash, parsed.expressionHash);
+  EXPECT_EQ(summary.moments.count, parsed.moments.count);
+  EXPECT_EQ(summary.moments.mean, parsed.moments.mean);
+  EXPECT_EQ(summary.moments.m2, parsed.moments.m2);
+  EXPECT_EQ(summary.counts, parsed.counts);
+}
+
+TEST(Summary, deserialize_summary_CorruptBytes_ThrowsException)
+{
+  std::string bytes = serialize_summary(summary_of({1, 2, 2, 3}));
+
+  std::string truncated = bytes.substr(0, bytes.size() - 1);
+  std::string badMagic = bytes;
+  badMagic[0] = 'X';
+  // The count of the last result no longer adds up to the sample count.
+  std::string badCount = bytes;
+  badCount[bytes.size() - 8]++;
+
+  EXPECT_THROW(deserialize_summary(truncated), DiceException);
+  EXPECT_THROW(deserialize_summary(badMagic), DiceException);
+  EXPECT_THROW(deserialize_summary(badCount), DiceException);
+  EXPECT_THROW(deserialize_summary(""), DiceException);
+}
@@ -0,0 +1,51 @@
+#include "thread_pool.hpp"
+#include <atomic>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <vector>
+
+TEST(ThreadPool, parallelFor_ManyTasks_RunsEachIndexOnce)
+{
+  ThreadPool pool(4);
+  std::vector<std::atomic<int>> calls(1000);
+
+  pool.parallelFor(calls.size(), [&](std::size_t i) { calls[i]++; });
+
+  for (auto &count : calls)
+  {
+    EXPECT_EQ(count.load(), 1);
+  }
+}
+
+TEST(ThreadPool, parallelFor_NestedCall_Completes)
+{
+  ThreadPool pool(2);
+  std::atomic<int> calls = 0;
+
+  pool.parallelFor(4, [&](std::size_t) {
+    pool.parallelFor(4, [&](std::size_t) { calls++; });
+  });
+
+  EXPECT_EQ(calls.load(), 16);
+}
+
+TEST(ThreadPool, parallelFor_TaskThrows_RethrowsAfterAllFinish)
+{
+  ThreadPool pool(4);
+  std::atomic<int> calls = 0;
+
+  EXPECT_THROW(
+      pool.parallelFor(
+          100,
+          [&](std::size_t i) {
+            calls++;
+            if (i == 7)
+            {
+              throw std::runtime_error("failed");
+            }
+          }
+      ),
+      std::runtime_error
+  );
+  EXPECT_EQ(calls.load(), 100);
+}
@@ -0,0 +1,39 @@
+#include "trace.hpp"
+#include <gtest/gtest.h>
+#include <sstream>
+
+TEST(Trace, write_BelowCapacity_BuffersUntilFlush)
+{
+  std::ostringstream stream;
+  StreamTraceSink trace(stream, 16);
+
+  trace.write("abc");
+  trace.write("def");
+
+  EXPECT_EQ(stream.str(), "");
+  trace.flush();
+  EXPECT_EQ(stream.str(), "abcdef");
+}
+
+TEST(Trace, write_PastCapacity_FlushesInOrder)
+{
+  std::ostringstream stream;
+  StreamTraceSink trace(stream, 4);
+
+  trace.write("abc");
+  trace.write("de");
+  trace.write("fghij");
+
+  EXPECT_EQ(stream.str(), "abcdefghij");
+}
+
+TEST(Trace, destructor_PendingText_IsFlushed)
+{
+  std::ostringstream stream;
+  {
+    StreamTraceSink trace(stream);
+    trace.write("abc");
+  }
+
+  EXPECT_EQ(stream.str(), "abc");
+}